@@ -2,6 +2,7 @@
 
 #include "AffineTransform.h"
 #include "Line.h"
+#include "BatchTransform.h"
 
 using namespace _3DMath;
 
@@ -62,8 +63,17 @@ void AffineTransform::Transform( const Vector& vectorA, Vector& vectorB ) const
 
 void AffineTransform::Transform( Vector* vectorArray, int arraySize ) const
 {
-	for( int i = 0; i < arraySize; i++ )
-		Transform( vectorArray[i] );
+	// Setting up a batch costs about as much as transforming a handful of points one at a time.
+	if( arraySize < 8 )
+	{
+		for( int i = 0; i < arraySize; i++ )
+			Transform( vectorArray[i] );
+		return;
+	}
+
+	BatchTransform batchTransform;
+	batchTransform.SetPointTransform( *this );
+	batchTransform.TransformPoints( vectorArray, arraySize );
 }
 
 void AffineTransform::Transform( Vertex& vertex, const LinearTransform* normalTransform /*= nullptr*/ ) const
@@ -83,20 +93,20 @@ void AffineTransform::Transform( Vertex& vertex, const LinearTransform* normalTr
 
 bool AffineTransform::Transform( VertexArray& vertexArray ) const
 {
-	LinearTransform normalTransform;
-	if( !linearTransform.GetNormalTransform( normalTransform ) )
+	BatchTransform batchTransform;
+	if( !batchTransform.SetTransform( *this ) )
 		return false;
 
-	for( int i = 0; i < ( signed )vertexArray.size(); i++ )
-		Transform( vertexArray[i], &normalTransform );
+	if( vertexArray.size() > 0 )
+		batchTransform.TransformVertices( &vertexArray[0], ( int )vertexArray.size() );
 
 	return true;
 }
 
 bool AffineTransform::Transform( VectorArray& vectorArray ) const
 {
-	for( int i = 0; i < ( signed )vectorArray.size(); i++ )
-		Transform( vectorArray[i] );
+	if( vectorArray.size() > 0 )
+		Transform( &vectorArray[0], ( int )vectorArray.size() );
 
 	return true;
 }
@@ -3,12 +3,19 @@
 #include "AxisAlignedBox.h"
 #include "Triangle.h"
 #include "LineSegment.h"
-#include "Line.h"
 #include "Plane.h"
+#include "Ray.h"
 #include "Renderer.h"
+#include "BatchTransform.h"
+#include "Simd.h"
 
 using namespace _3DMath;
 
+static inline bool UseAVX2( void )
+{
+	return BatchTransform::GetSupportedInstructions() == BatchTransform::INSTRUCTIONS_AVX2;
+}
+
 AxisAlignedBox::AxisAlignedBox( void )
 {
 	negCorner.Set( 0.0, 0.0, 0.0 );
@@ -54,13 +61,23 @@ void AxisAlignedBox::SetCenterAndDimensions( const Vector& center, const Vector&
 
 bool AxisAlignedBox::Intersect( const AxisAlignedBox& boxA, const AxisAlignedBox& boxB )
 {
-	return false;
+	negCorner.Max( boxA.negCorner, boxB.negCorner );
+	posCorner.Min( boxA.posCorner, boxB.posCorner );
+
+	return negCorner.x <= posCorner.x && negCorner.y <= posCorner.y && negCorner.z <= posCorner.z;
 }
 
 void AxisAlignedBox::Combine( const AxisAlignedBox& boxA, const AxisAlignedBox& boxB )
 {
 	negCorner.Min( boxA.negCorner, boxB.negCorner );
-	posCorner.Max( boxA.posCorner, boxA.posCorner );
+	posCorner.Max( boxA.posCorner, boxB.posCorner );
+}
+
+bool AxisAlignedBox::OverlapsWith( const AxisAlignedBox& box, double eps /*= EPSILON*/ ) const
+{
+	return	negCorner.x <= box.posCorner.x + eps && box.negCorner.x <= posCorner.x + eps &&
+			negCorner.y <= box.posCorner.y + eps && box.negCorner.y <= posCorner.y + eps &&
+			negCorner.z <= box.posCorner.z + eps && box.negCorner.z <= posCorner.z + eps;
 }
 
 void AxisAlignedBox::GetCenter( Vector& center ) const
@@ -202,59 +219,137 @@ bool AxisAlignedBox::ContainsLineSegment( const LineSegment& lineSegment, double
 
 bool AxisAlignedBox::IntersectsWithLineSegment( const LineSegment& lineSegment, double eps /*= EPSILON*/ ) const
 {
-	for( int i = 0; i < 2; i++ )
-		if( ContainsPoint( lineSegment.vertex[i], eps ) )
-			return true;
+	AxisAlignedBox box( *this );
+	box.negCorner.Subtract( Vector( eps, eps, eps ) );
+	box.posCorner.Add( Vector( eps, eps, eps ) );
+
+	double tEntry, tExit;
+	return box.IntersectRay( Ray( lineSegment ), tEntry, tExit, 0.0, 1.0 );
+}
+
+// The sign of each direction component says which corner's slab plane the ray crosses first, so no
+// comparison is needed to order the two.  A ray lying in a slab plane gives a NaN, which the
+// comparisons below ignore.
+bool AxisAlignedBox::IntersectRay( const Ray& ray, double& tEntry, double& tExit, double tMin /*= 0.0*/, double tMax /*= HUGE_VAL*/ ) const
+{
+	const Vector* corner[2] = { &negCorner, &posCorner };
+
+	double tx0 = ( corner[ ray.sign[0] ]->x - ray.origin.x ) * ray.inverseDirection.x;
+	double tx1 = ( corner[ 1 - ray.sign[0] ]->x - ray.origin.x ) * ray.inverseDirection.x;
+	double ty0 = ( corner[ ray.sign[1] ]->y - ray.origin.y ) * ray.inverseDirection.y;
+	double ty1 = ( corner[ 1 - ray.sign[1] ]->y - ray.origin.y ) * ray.inverseDirection.y;
+	double tz0 = ( corner[ ray.sign[2] ]->z - ray.origin.z ) * ray.inverseDirection.z;
+	double tz1 = ( corner[ 1 - ray.sign[2] ]->z - ray.origin.z ) * ray.inverseDirection.z;
+
+	tEntry = tMin;
+	tEntry = ( tx0 > tEntry ) ? tx0 : tEntry;
+	tEntry = ( ty0 > tEntry ) ? ty0 : tEntry;
+	tEntry = ( tz0 > tEntry ) ? tz0 : tEntry;
+
+	tExit = tMax;
+	tExit = ( tx1 < tExit ) ? tx1 : tExit;
+	tExit = ( ty1 < tExit ) ? ty1 : tExit;
+	tExit = ( tz1 < tExit ) ? tz1 : tExit;
+
+	return tEntry <= tExit;
+}
 
-	Line line( lineSegment );
+//---------------------------------------------------------------------
+//                         AxisAlignedBoxBlock
+//---------------------------------------------------------------------
 
-	for( int i = 0; i < 6; i++ )
+#if defined _3DMATH_X86
+
+// The ray's signs are the same for every lane, so the near and far corners are picked once per axis.
+_3DMATH_TARGET_AVX2 static int IntersectRayAVX2( const AxisAlignedBoxBlock& block, const Ray& ray, double* tEntryArray, double* tExitArray, double tMin, double tMax )
+{
+	const double origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const double inverseDirection[3] = { ray.inverseDirection.x, ray.inverseDirection.y, ray.inverseDirection.z };
+
+	__m256d tEntry = _mm256_set1_pd( tMin );
+	__m256d tExit = _mm256_set1_pd( tMax );
+
+	for( int i = 0; i < 3; i++ )
 	{
-		Plane plane;
+		const double* nearCorner = ray.sign[i] ? block.posCorner[i] : block.negCorner[i];
+		const double* farCorner = ray.sign[i] ? block.negCorner[i] : block.posCorner[i];
 
-		switch(i)
-		{
-			case 0:
-			{
-				plane.SetCenterAndNormal( Vector( negCorner ), Vector( -1.0, 0.0, 0.0 ) );
-				break;
-			}
-			case 1:
-			{
-				plane.SetCenterAndNormal( Vector( negCorner ), Vector( 0.0, -1.0, 0.0 ) );
-				break;
-			}
-			case 2:
-			{
-				plane.SetCenterAndNormal( Vector( negCorner ), Vector( 0.0, 0.0, -1.0 ) );
-				break;
-			}
-			case 3:
-			{
-				plane.SetCenterAndNormal( Vector( posCorner ), Vector( 1.0, 0.0, 0.0 ) );
-				break;
-			}
-			case 4:
-			{
-				plane.SetCenterAndNormal( Vector( posCorner ), Vector( 0.0, 1.0, 0.0 ) );
-				break;
-			}
-			case 5:
-			{
-				plane.SetCenterAndNormal( Vector( posCorner ), Vector( 0.0, 0.0, 1.0 ) );
-				break;
-			}
-		}
+		__m256d rayOrigin = _mm256_set1_pd( origin[i] );
+		__m256d rayInverseDirection = _mm256_set1_pd( inverseDirection[i] );
+
+		__m256d t0 = _mm256_mul_pd( _mm256_sub_pd( _mm256_loadu_pd( nearCorner ), rayOrigin ), rayInverseDirection );
+		__m256d t1 = _mm256_mul_pd( _mm256_sub_pd( _mm256_loadu_pd( farCorner ), rayOrigin ), rayInverseDirection );
+
+		// With a NaN in either operand, these return the second, the running interval.
+		tEntry = _mm256_max_pd( t0, tEntry );
+		tExit = _mm256_min_pd( t1, tExit );
+	}
+
+	_mm256_storeu_pd( tEntryArray, tEntry );
+	_mm256_storeu_pd( tExitArray, tExit );
+
+	return _mm256_movemask_pd( _mm256_cmp_pd( tEntry, tExit, _CMP_LE_OQ ) ) & ( ( 1 << block.count ) - 1 );
+}
 
-		Vector intersectionPoint;
-		if( plane.Intersect( line, intersectionPoint, eps ) && ContainsPoint( intersectionPoint, eps ) )
+#endif //_3DMATH_X86
+
+AxisAlignedBoxBlock::AxisAlignedBoxBlock( void )
+{
+	Clear();
+}
+
+AxisAlignedBoxBlock::~AxisAlignedBoxBlock( void )
+{
+}
+
+void AxisAlignedBoxBlock::Clear( void )
+{
+	for( int i = 0; i < 3; i++ )
+	{
+		for( int j = 0; j < SIZE; j++ )
 		{
-			if( lineSegment.ContainsPoint( intersectionPoint, eps ) )
-				return true;
+			negCorner[i][j] = 0.0;
+			posCorner[i][j] = 0.0;
 		}
 	}
 
-	return false;
+	count = 0;
+}
+
+bool AxisAlignedBoxBlock::Add( const AxisAlignedBox& box )
+{
+	if( count == SIZE )
+		return false;
+
+	negCorner[0][ count ] = box.negCorner.x;
+	negCorner[1][ count ] = box.negCorner.y;
+	negCorner[2][ count ] = box.negCorner.z;
+
+	posCorner[0][ count ] = box.posCorner.x;
+	posCorner[1][ count ] = box.posCorner.y;
+	posCorner[2][ count ] = box.posCorner.z;
+
+	count++;
+	return true;
+}
+
+int AxisAlignedBoxBlock::IntersectRay( const Ray& ray, double* tEntryArray, double* tExitArray, double tMin /*= 0.0*/, double tMax /*= HUGE_VAL*/ ) const
+{
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		return IntersectRayAVX2( *this, ray, tEntryArray, tExitArray, tMin, tMax );
+#endif
+
+	int hitMask = 0;
+
+	for( int i = 0; i < count; i++ )
+	{
+		AxisAlignedBox box( Vector( negCorner[0][i], negCorner[1][i], negCorner[2][i] ), Vector( posCorner[0][i], posCorner[1][i], posCorner[2][i] ) );
+		if( box.IntersectRay( ray, tEntryArray[i], tExitArray[i], tMin, tMax ) )
+			hitMask |= 1 << i;
+	}
+
+	return hitMask;
 }
 
 // AxisAlignedBox.cpp
\ No newline at end of file
@@ -8,6 +8,8 @@
 namespace _3DMath
 {
 	class AxisAlignedBox;
+	class AxisAlignedBoxBlock;
+	class Ray;
 	class Triangle;
 	class LineSegment;
 	class Plane;
@@ -26,8 +28,10 @@ public:
 	void GrowToIncludePoint( const Vector& point );
 	void SetCenterAndDimensions( const Vector& center, const Vector& dimensions );
 
+	// This becomes the overlap of the given boxes; false is returned if they don't overlap.
 	bool Intersect( const AxisAlignedBox& boxA, const AxisAlignedBox& boxB );
 	void Combine( const AxisAlignedBox& boxA, const AxisAlignedBox& boxB );
+	bool OverlapsWith( const AxisAlignedBox& box, double eps = EPSILON ) const;
 
 	void GetCenter( Vector& center ) const;
 	void SplitInTwo( AxisAlignedBox& boxA, AxisAlignedBox& boxB, Plane* plane = nullptr, int split = -1 ) const;
@@ -37,6 +41,10 @@ public:
 	bool ContainsLineSegment( const LineSegment& lineSegment, double eps = EPSILON ) const;
 	bool IntersectsWithLineSegment( const LineSegment& lineSegment, double eps = EPSILON ) const;
 
+	// This is the slab test.  If the ray meets the box within [tMin,tMax], true is returned, and
+	// the ray is inside the box from tEntry to tExit.
+	bool IntersectRay( const Ray& ray, double& tEntry, double& tExit, double tMin = 0.0, double tMax = HUGE_VAL ) const;
+
 	static void ExpandInterval( double& min, double& max, double value );
 	static bool InInterval( double min, double max, double value, double eps = EPSILON );
 
@@ -45,4 +53,29 @@ public:
 	Vector negCorner, posCorner;
 };
 
+// This holds up to SIZE boxes, one component per array, so that one ray can be tested against all
+// of them at once with AVX2, as with the children of a wide tree node.
+class _3DMATH_API _3DMath::AxisAlignedBoxBlock
+{
+public:
+
+	enum { SIZE = 4 };
+
+	AxisAlignedBoxBlock( void );
+	~AxisAlignedBoxBlock( void );
+
+	void Clear( void );
+
+	// False is returned if the block is full.
+	bool Add( const AxisAlignedBox& box );
+
+	// Bit i of the result is set if the ray meets box i within [tMin,tMax], in which case
+	// tEntryArray[i] and tExitArray[i] give where.
+	int IntersectRay( const Ray& ray, double* tEntryArray, double* tExitArray, double tMin = 0.0, double tMax = HUGE_VAL ) const;
+
+	double negCorner[3][SIZE];
+	double posCorner[3][SIZE];
+	int count;
+};
+
 // AxisAlignedBox.h
\ No newline at end of file
@@ -0,0 +1,388 @@
+// BatchTransform.cpp
+
+#include "BatchTransform.h"
+#include "AffineTransform.h"
+#include "LinearTransform.h"
+#include "Simd.h"
+#include <stddef.h>
+#include <thread>
+
+using namespace _3DMath;
+
+// The kernels treat a Vector as three packed doubles.
+static_assert( sizeof( Vector ) == 3 * sizeof( double ), "Vector must be three packed doubles." );
+static_assert( sizeof( Vertex ) % sizeof( double ) == 0, "Vertex must be a whole number of doubles." );
+
+static const int vertexStride = sizeof( Vertex ) / sizeof( double );
+static const int positionOffset = offsetof( Vertex, position ) / sizeof( double );
+static const int normalOffset = offsetof( Vertex, normal ) / sizeof( double );
+
+//---------------------------------------------------------------------
+//                                Scalar
+//---------------------------------------------------------------------
+
+static inline void TransformScalar( const double* matrix, double* vector, bool translate )
+{
+	double x = vector[0];
+	double y = vector[1];
+	double z = vector[2];
+
+	for( int i = 0; i < 3; i++ )
+		vector[i] = matrix[i] * x + matrix[ 4 + i ] * y + matrix[ 8 + i ] * z + ( translate ? matrix[ 12 + i ] : 0.0 );
+}
+
+static inline void NormalizeScalar( double* vector )
+{
+	double length = sqrt( vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2] );
+	if( length != 0.0 )
+	{
+		double scale = 1.0 / length;
+		for( int i = 0; i < 3; i++ )
+			vector[i] *= scale;
+	}
+}
+
+static void TransformArrayScalar( const double* matrix, double* data, int count, int stride, bool translate )
+{
+	for( int i = 0; i < count; i++, data += stride )
+		TransformScalar( matrix, data, translate );
+}
+
+static void TransformVerticesScalar( const double* pointMatrix, const double* normalMatrix, double* data, int count )
+{
+	for( int i = 0; i < count; i++, data += vertexStride )
+	{
+		TransformScalar( pointMatrix, data + positionOffset, true );
+		TransformScalar( normalMatrix, data + normalOffset, false );
+		NormalizeScalar( data + normalOffset );
+	}
+}
+
+#if defined _3DMATH_X86
+
+//---------------------------------------------------------------------
+//                                 SSE2
+//---------------------------------------------------------------------
+
+// The x and y components are carried in one register and z in the low half of another.
+_3DMATH_TARGET_SSE2 static inline void TransformSSE2( const double* matrix, double* vector, bool translate, bool normalize )
+{
+	__m128d x = _mm_set1_pd( vector[0] );
+	__m128d y = _mm_set1_pd( vector[1] );
+	__m128d z = _mm_set1_pd( vector[2] );
+
+	__m128d resultXY = _mm_add_pd( _mm_add_pd( _mm_mul_pd( _mm_loadu_pd( matrix ), x ), _mm_mul_pd( _mm_loadu_pd( matrix + 4 ), y ) ), _mm_mul_pd( _mm_loadu_pd( matrix + 8 ), z ) );
+	__m128d resultZ = _mm_add_sd( _mm_add_sd( _mm_mul_sd( _mm_load_sd( matrix + 2 ), x ), _mm_mul_sd( _mm_load_sd( matrix + 6 ), y ) ), _mm_mul_sd( _mm_load_sd( matrix + 10 ), z ) );
+
+	if( translate )
+	{
+		resultXY = _mm_add_pd( resultXY, _mm_loadu_pd( matrix + 12 ) );
+		resultZ = _mm_add_sd( resultZ, _mm_load_sd( matrix + 14 ) );
+	}
+
+	if( normalize )
+	{
+		__m128d squareXY = _mm_mul_pd( resultXY, resultXY );
+		__m128d lengthSquared = _mm_add_sd( _mm_add_sd( squareXY, _mm_unpackhi_pd( squareXY, squareXY ) ), _mm_mul_sd( resultZ, resultZ ) );
+		double length = _mm_cvtsd_f64( _mm_sqrt_sd( lengthSquared, lengthSquared ) );
+		if( length != 0.0 )
+		{
+			__m128d scale = _mm_set1_pd( 1.0 / length );
+			resultXY = _mm_mul_pd( resultXY, scale );
+			resultZ = _mm_mul_sd( resultZ, scale );
+		}
+	}
+
+	_mm_storeu_pd( vector, resultXY );
+	_mm_store_sd( vector + 2, resultZ );
+}
+
+_3DMATH_TARGET_SSE2 static void TransformArraySSE2( const double* matrix, double* data, int count, int stride, bool translate )
+{
+	for( int i = 0; i < count; i++, data += stride )
+		TransformSSE2( matrix, data, translate, false );
+}
+
+_3DMATH_TARGET_SSE2 static void TransformVerticesSSE2( const double* pointMatrix, const double* normalMatrix, double* data, int count )
+{
+	for( int i = 0; i < count; i++, data += vertexStride )
+	{
+		TransformSSE2( pointMatrix, data + positionOffset, true, false );
+		TransformSSE2( normalMatrix, data + normalOffset, false, true );
+	}
+}
+
+//---------------------------------------------------------------------
+//                                 AVX2
+//---------------------------------------------------------------------
+
+// One vector per call, with all three components in one register.  This serves strided data.
+_3DMATH_TARGET_AVX2 static inline void TransformAVX2( const __m256d* columns, double* vector, bool translate, bool normalize )
+{
+	__m256d result = translate ? columns[3] : _mm256_setzero_pd();
+	result = _mm256_fmadd_pd( columns[0], _mm256_broadcast_sd( vector ), result );
+	result = _mm256_fmadd_pd( columns[1], _mm256_broadcast_sd( vector + 1 ), result );
+	result = _mm256_fmadd_pd( columns[2], _mm256_broadcast_sd( vector + 2 ), result );
+
+	__m128d resultXY = _mm256_castpd256_pd128( result );
+	__m128d resultZ = _mm256_extractf128_pd( result, 1 );
+
+	if( normalize )
+	{
+		__m256d square = _mm256_mul_pd( result, result );
+		__m128d sum = _mm_add_pd( _mm256_castpd256_pd128( square ), _mm256_extractf128_pd( square, 1 ) );
+		sum = _mm_add_sd( sum, _mm_unpackhi_pd( sum, sum ) );
+		double length = _mm_cvtsd_f64( _mm_sqrt_sd( sum, sum ) );
+		if( length != 0.0 )
+		{
+			__m128d scale = _mm_set1_pd( 1.0 / length );
+			resultXY = _mm_mul_pd( resultXY, scale );
+			resultZ = _mm_mul_sd( resultZ, scale );
+		}
+	}
+
+	_mm_storeu_pd( vector, resultXY );
+	_mm_store_sd( vector + 2, resultZ );
+}
+
+// Four packed vectors at a time.  The twelve doubles are transposed into x, y and z registers,
+// transformed as structure-of-arrays, and transposed back.
+_3DMATH_TARGET_AVX2 static void TransformPackedAVX2( const double* matrix, double* data, int count, bool translate )
+{
+	__m256d row[3][4];
+	for( int i = 0; i < 3; i++ )
+		for( int j = 0; j < 4; j++ )
+			row[i][j] = _mm256_set1_pd( ( j < 3 || translate ) ? matrix[ j * 4 + i ] : 0.0 );
+
+	int i = 0;
+	for( ; i + 4 <= count; i += 4, data += 12 )
+	{
+		__m256d x, y, z;
+		LoadPackedVectors( data, x, y, z );
+
+		__m256d result[3];
+		for( int j = 0; j < 3; j++ )
+			result[j] = _mm256_fmadd_pd( row[j][0], x, _mm256_fmadd_pd( row[j][1], y, _mm256_fmadd_pd( row[j][2], z, row[j][3] ) ) );
+
+		StorePackedVectors( data, result[0], result[1], result[2] );
+	}
+
+	__m256d columns[4];
+	for( int j = 0; j < 4; j++ )
+		columns[j] = _mm256_loadu_pd( matrix + j * 4 );
+
+	for( ; i < count; i++, data += 3 )
+		TransformAVX2( columns, data, translate, false );
+}
+
+_3DMATH_TARGET_AVX2 static void TransformVerticesAVX2( const double* pointMatrix, const double* normalMatrix, double* data, int count )
+{
+	__m256d pointColumns[4], normalColumns[4];
+	for( int j = 0; j < 4; j++ )
+	{
+		pointColumns[j] = _mm256_loadu_pd( pointMatrix + j * 4 );
+		normalColumns[j] = _mm256_loadu_pd( normalMatrix + j * 4 );
+	}
+
+	for( int i = 0; i < count; i++, data += vertexStride )
+	{
+		TransformAVX2( pointColumns, data + positionOffset, true, false );
+		TransformAVX2( normalColumns, data + normalOffset, false, true );
+	}
+}
+
+#endif //_3DMATH_X86
+
+static BatchTransform::Instructions DetectInstructions( void )
+{
+	BatchTransform::Instructions supported = BatchTransform::INSTRUCTIONS_SCALAR;
+
+#if defined( _3DMATH_X86 ) && defined( __GNUC__ )
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "sse2" ) )
+		supported = BatchTransform::INSTRUCTIONS_SSE2;
+	if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+		supported = BatchTransform::INSTRUCTIONS_AVX2;
+#elif defined( _3DMATH_X86 ) && defined( _MSC_VER )
+	int info[4];
+	__cpuid( info, 1 );
+	bool sse2 = ( info[3] & ( 1 << 26 ) ) != 0;
+	bool fma = ( info[2] & ( 1 << 12 ) ) != 0;
+	bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+	bool avx = ( info[2] & ( 1 << 28 ) ) != 0;
+	__cpuidex( info, 7, 0 );
+	bool avx2 = ( info[1] & ( 1 << 5 ) ) != 0;
+
+	if( sse2 )
+		supported = BatchTransform::INSTRUCTIONS_SSE2;
+	if( osxsave && avx && avx2 && fma && ( _xgetbv( 0 ) & 6 ) == 6 )
+		supported = BatchTransform::INSTRUCTIONS_AVX2;
+#endif
+
+	return supported;
+}
+
+//---------------------------------------------------------------------
+//                              BatchTransform
+//---------------------------------------------------------------------
+
+BatchTransform::BatchTransform( void )
+{
+	instructions = GetSupportedInstructions();
+	threadCount = 1;
+	minElementsPerThread = 1 << 16;
+
+	// The identity is its own normal transform, so there's nothing to derive.
+	for( int i = 0; i < 16; i++ )
+		pointMatrix[i] = normalMatrix[i] = ( i % 5 == 0 && i < 15 ) ? 1.0 : 0.0;
+}
+
+BatchTransform::BatchTransform( const AffineTransform& affineTransform )
+{
+	instructions = GetSupportedInstructions();
+	threadCount = 1;
+	minElementsPerThread = 1 << 16;
+
+	SetTransform( affineTransform );
+}
+
+BatchTransform::~BatchTransform( void )
+{
+}
+
+bool BatchTransform::SetTransform( const AffineTransform& affineTransform, const LinearTransform* normalTransform /*= nullptr*/ )
+{
+	bool success = true;
+
+	LinearTransform normalTransformStorage;
+	if( !normalTransform )
+	{
+		success = affineTransform.linearTransform.GetNormalTransform( normalTransformStorage );
+		normalTransform = &normalTransformStorage;
+	}
+
+	SetPointTransform( affineTransform );
+
+	const Vector* normalColumns[3] = { &normalTransform->xAxis, &normalTransform->yAxis, &normalTransform->zAxis };
+
+	for( int j = 0; j < 4; j++ )
+	{
+		if( j < 3 )
+			normalColumns[j]->Get( normalMatrix[ j * 4 ], normalMatrix[ j * 4 + 1 ], normalMatrix[ j * 4 + 2 ] );
+		else
+			normalMatrix[ j * 4 ] = normalMatrix[ j * 4 + 1 ] = normalMatrix[ j * 4 + 2 ] = 0.0;
+		normalMatrix[ j * 4 + 3 ] = 0.0;
+	}
+
+	return success;
+}
+
+void BatchTransform::SetPointTransform( const AffineTransform& affineTransform )
+{
+	const Vector* pointColumns[4] = { &affineTransform.linearTransform.xAxis, &affineTransform.linearTransform.yAxis, &affineTransform.linearTransform.zAxis, &affineTransform.translation };
+
+	for( int j = 0; j < 4; j++ )
+	{
+		pointColumns[j]->Get( pointMatrix[ j * 4 ], pointMatrix[ j * 4 + 1 ], pointMatrix[ j * 4 + 2 ] );
+		pointMatrix[ j * 4 + 3 ] = 0.0;
+	}
+}
+
+void BatchTransform::TransformPoints( Vector* vectorArray, int arraySize ) const
+{
+	Dispatch( KIND_POINTS, vectorArray, arraySize );
+}
+
+void BatchTransform::TransformVectors( Vector* vectorArray, int arraySize ) const
+{
+	Dispatch( KIND_VECTORS, vectorArray, arraySize );
+}
+
+void BatchTransform::TransformVertices( Vertex* vertexArray, int arraySize ) const
+{
+	Dispatch( KIND_VERTICES, vertexArray, arraySize );
+}
+
+/*static*/ BatchTransform::Instructions BatchTransform::GetSupportedInstructions( void )
+{
+	static Instructions supported = DetectInstructions();
+	return supported;
+}
+
+void BatchTransform::Dispatch( Kind kind, void* array, int arraySize ) const
+{
+	int threads = threadCount;
+	if( threads <= 0 )
+		threads = ( int )std::thread::hardware_concurrency();
+
+	threads = MIN( threads, arraySize / MAX( minElementsPerThread, 1 ) );
+	if( threads < 2 )
+	{
+		Run( kind, array, 0, arraySize );
+		return;
+	}
+
+	std::vector< std::thread > threadArray;
+	int begin = 0;
+	for( int i = 0; i < threads; i++ )
+	{
+		int end = ( int )( int64_t( arraySize ) * ( i + 1 ) / threads );
+		if( i == threads - 1 )
+			Run( kind, array, begin, end );
+		else
+			threadArray.push_back( std::thread( &BatchTransform::Run, this, kind, array, begin, end ) );
+		begin = end;
+	}
+
+	for( int i = 0; i < ( signed )threadArray.size(); i++ )
+		threadArray[i].join();
+}
+
+void BatchTransform::Run( Kind kind, void* array, int begin, int end ) const
+{
+	int count = end - begin;
+	if( count <= 0 )
+		return;
+
+	Instructions usable = MIN( instructions, GetSupportedInstructions() );
+
+	if( kind == KIND_VERTICES )
+	{
+		double* data = ( double* )( ( Vertex* )array + begin );
+
+		switch( usable )
+		{
+#if defined _3DMATH_X86
+			case INSTRUCTIONS_AVX2:
+				TransformVerticesAVX2( pointMatrix, normalMatrix, data, count );
+				return;
+			case INSTRUCTIONS_SSE2:
+				TransformVerticesSSE2( pointMatrix, normalMatrix, data, count );
+				return;
+#endif
+			default:
+				TransformVerticesScalar( pointMatrix, normalMatrix, data, count );
+				return;
+		}
+	}
+
+	double* data = ( double* )( ( Vector* )array + begin );
+	bool translate = ( kind == KIND_POINTS );
+
+	switch( usable )
+	{
+#if defined _3DMATH_X86
+		case INSTRUCTIONS_AVX2:
+			TransformPackedAVX2( pointMatrix, data, count, translate );
+			return;
+		case INSTRUCTIONS_SSE2:
+			TransformArraySSE2( pointMatrix, data, count, 3, translate );
+			return;
+#endif
+		default:
+			TransformArrayScalar( pointMatrix, data, count, 3, translate );
+			return;
+	}
+}
+
+// BatchTransform.cpp
@@ -0,0 +1,72 @@
+// BatchTransform.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+#include "Vertex.h"
+
+namespace _3DMath
+{
+	class BatchTransform;
+	class AffineTransform;
+	class LinearTransform;
+}
+
+// This applies one affine transform to whole arrays of points, vectors or vertices using the
+// widest instruction set the processor supports, chosen at run-time.  Large batches can
+// optionally be split across threads.  Results can differ from the one-at-a-time Transform
+// methods in the last bit, since the wider kernels use fused multiply-adds.
+class _3DMATH_API _3DMath::BatchTransform
+{
+public:
+
+	BatchTransform( void );
+	BatchTransform( const AffineTransform& affineTransform );
+	~BatchTransform( void );
+
+	// If no normal transform is given, it is derived from the linear part of the given transform,
+	// and false is returned if that's singular.  Points and vectors can still be transformed then.
+	bool SetTransform( const AffineTransform& affineTransform, const LinearTransform* normalTransform = nullptr );
+
+	// This skips deriving the normal transform, which costs an inversion, and leaves the one used for
+	// vertices as it was.  Use it when only points and vectors are to be transformed.
+	void SetPointTransform( const AffineTransform& affineTransform );
+
+	void TransformPoints( Vector* vectorArray, int arraySize ) const;
+	void TransformVectors( Vector* vectorArray, int arraySize ) const;
+
+	// Positions are transformed as points and normals by the normal transform, then re-normalized.
+	void TransformVertices( Vertex* vertexArray, int arraySize ) const;
+
+	enum Instructions
+	{
+		INSTRUCTIONS_SCALAR,
+		INSTRUCTIONS_SSE2,
+		INSTRUCTIONS_AVX2,
+	};
+
+	static Instructions GetSupportedInstructions( void );
+
+	Instructions instructions;		// Defaults to the best supported; it may be lowered, but never raised.
+	int threadCount;				// Zero means use the hardware concurrency.
+	int minElementsPerThread;		// Batches smaller than twice this are never split.
+
+private:
+
+	enum Kind
+	{
+		KIND_POINTS,
+		KIND_VECTORS,
+		KIND_VERTICES,
+	};
+
+	void Dispatch( Kind kind, void* array, int arraySize ) const;
+	void Run( Kind kind, void* array, int begin, int end ) const;
+
+	// Each matrix is stored as four padded columns: the images of the x, y and z axes, then the translation.
+	double pointMatrix[16];
+	double normalMatrix[16];
+};
+
+// BatchTransform.h
@@ -2,9 +2,21 @@
 
 #include "BoundingBoxTree.h"
 #include "LineSegment.h"
+#include "Ray.h"
 
 using namespace _3DMath;
 
+// Triangles are let into a node when they're within EPSILON of its box, so the box is grown by as much for the ray.
+static bool IntersectNodeBox( const AxisAlignedBox& boundingBox, const Ray& ray, double tMin, double tMax, double& tEntry )
+{
+	AxisAlignedBox grownBox( boundingBox );
+	grownBox.negCorner.Set( grownBox.negCorner.x - EPSILON, grownBox.negCorner.y - EPSILON, grownBox.negCorner.z - EPSILON );
+	grownBox.posCorner.Set( grownBox.posCorner.x + EPSILON, grownBox.posCorner.y + EPSILON, grownBox.posCorner.z + EPSILON );
+
+	double tExit;
+	return grownBox.IntersectRay( ray, tEntry, tExit, tMin, tMax );
+}
+
 //-----------------------------------------------------------------------------------------------------------
 //                                           BoundingBoxTree
 //-----------------------------------------------------------------------------------------------------------
@@ -87,7 +99,24 @@ bool BoundingBoxTree::FindIntersection( const LineSegment& lineSegment, const Tr
 	if( !rootNode )
 		return false;
 
-	return rootNode->FindIntersection( lineSegment, intersectedTriangle, intersectionPoint );
+	Ray ray( lineSegment );
+	double lambda = 1.0;
+	if( !FindFirstIntersection( ray, 0.0, lambda, intersectedTriangle ) )
+		return false;
+
+	lineSegment.Lerp( lambda, intersectionPoint );
+	return true;
+}
+
+bool BoundingBoxTree::FindFirstIntersection( const Ray& ray, double tMin, double& tMax, const Triangle*& intersectedTriangle ) const
+{
+	intersectedTriangle = nullptr;
+
+	double tEntry;
+	if( !rootNode || !IntersectNodeBox( rootNode->boundingBox, ray, tMin, tMax, tEntry ) )
+		return false;
+
+	return rootNode->FindFirstIntersection( ray, tMin, tMax, intersectedTriangle );
 }
 
 bool BoundingBoxTree::FindNearestTriangle( const Vector& point, const Triangle*& nearestTriangle, double maxDistance ) const
@@ -98,6 +127,15 @@ bool BoundingBoxTree::FindNearestTriangle( const Vector& point, const Triangle*&
 	return rootNode->FindNearestTriangle( point, nearestTriangle, maxDistance );
 }
 
+bool BoundingBoxTree::GetBoundingBox( AxisAlignedBox& boundingBox ) const
+{
+	if( !rootNode )
+		return false;
+
+	boundingBox = rootNode->boundingBox;
+	return true;
+}
+
 //-----------------------------------------------------------------------------------------------------------
 //                                                   Node
 //-----------------------------------------------------------------------------------------------------------
@@ -153,18 +191,27 @@ BoundingBoxTree::BranchNode::BranchNode( void )
 	return true;
 }
 
-/*virtual*/ bool BoundingBoxTree::BranchNode::FindIntersection( const LineSegment& lineSegment, const Triangle*& intersectedTriangle, Vector& intersectionPoint ) const
+// The caller has already found that the ray meets this node's box.
+/*virtual*/ bool BoundingBoxTree::BranchNode::FindFirstIntersection( const Ray& ray, double tMin, double& tMax, const Triangle*& intersectedTriangle ) const
 {
-	if( boundingBox.IntersectsWithLineSegment( lineSegment ) )
-	{
-		if( backNode->FindIntersection( lineSegment, intersectedTriangle, intersectionPoint ) )
-			return true;
+	Node* childNode[2] = { backNode, frontNode };
+	double tEntry[2];
+	bool hit[2];
 
-		if( frontNode->FindIntersection( lineSegment, intersectedTriangle, intersectionPoint ) )
-			return true;
+	for( int i = 0; i < 2; i++ )
+		hit[i] = IntersectNodeBox( childNode[i]->boundingBox, ray, tMin, tMax, tEntry[i] );
+
+	int first = ( hit[0] && hit[1] && tEntry[1] < tEntry[0] ) ? 1 : 0;
+	bool found = false;
+
+	for( int i = 0; i < 2; i++ )
+	{
+		int j = first ^ i;
+		if( hit[j] && tEntry[j] <= tMax && childNode[j]->FindFirstIntersection( ray, tMin, tMax, intersectedTriangle ) )
+			found = true;
 	}
 
-	return false;
+	return found;
 }
 
 /*virtual*/ bool BoundingBoxTree::BranchNode::FindNearestTriangle( const Vector& point, const Triangle*& nearestTriangle, double maxDistance ) const
@@ -188,11 +235,15 @@ BoundingBoxTree::BranchNode::BranchNode( void )
 BoundingBoxTree::LeafNode::LeafNode( void )
 {
 	triangleList = new TriangleList();
+	blockArray = new std::vector< PrecomputedTriangleBlock >();
+	blockTriangleArray = new std::vector< const Triangle* >();
 }
 
 /*virtual*/ BoundingBoxTree::LeafNode::~LeafNode( void )
 {
 	delete triangleList;
+	delete blockArray;
+	delete blockTriangleArray;
 }
 
 /*virtual*/ bool BoundingBoxTree::LeafNode::InsertTriangle( const Triangle& triangle )
@@ -200,51 +251,54 @@ BoundingBoxTree::LeafNode::LeafNode( void )
 	if( boundingBox.ContainsTriangle( triangle ) )
 	{
 		triangleList->push_back( triangle );
+
+		if( blockArray->size() == 0 || !blockArray->back().Add( triangle ) )
+		{
+			blockArray->push_back( PrecomputedTriangleBlock() );
+			blockArray->back().Add( triangle );
+		}
+
+		blockTriangleArray->push_back( &triangleList->back() );
 		return true;
 	}
 
 	return false;
 }
 
-/*virtual*/ bool BoundingBoxTree::LeafNode::FindIntersection( const LineSegment& lineSegment, const Triangle*& intersectedTriangle, Vector& intersectionPoint ) const
+// Each block is tested with the nearest hit so far as the far limit, so the result is the hit nearest the segment's start.
+/*virtual*/ bool BoundingBoxTree::LeafNode::FindFirstIntersection( const Ray& ray, double tMin, double& tMax, const Triangle*& intersectedTriangle ) const
 {
-	intersectedTriangle = nullptr;
-	double smallestLambda = 2.0;
+	bool found = false;
 
-	for( TriangleList::const_iterator iter = triangleList->cbegin(); iter != triangleList->cend(); iter++ )
+	for( int i = 0; i < ( signed )blockArray->size(); i++ )
 	{
-		const Triangle& triangle = *iter;
-		if( triangle.Intersect( lineSegment, intersectionPoint ) )
+		double t, u, v;
+		int j = ( *blockArray )[i].IntersectRay( ray.origin, ray.direction, t, u, v, tMin, tMax );
+		if( j >= 0 )
 		{
-			double lambda;
-			if( lineSegment.LerpInverse( lambda, intersectionPoint ) )
-			{
-				if( lambda < smallestLambda )
-				{
-					smallestLambda = lambda;
-					intersectedTriangle = &triangle;
-				}
-			}
+			tMax = t;
+			intersectedTriangle = ( *blockTriangleArray )[ i * PrecomputedTriangleBlock::SIZE + j ];
+			found = true;
 		}
 	}
 
-	return( intersectedTriangle ? true : false );
+	return found;
 }
 
 /*virtual*/ bool BoundingBoxTree::LeafNode::FindNearestTriangle( const Vector& point, const Triangle*& nearestTriangle, double maxDistance ) const
 {
-	double smallestDistance = maxDistance;
+	double smallestDistanceSquared = maxDistance * maxDistance;
 	nearestTriangle = nullptr;
 
-	for( TriangleList::const_iterator iter = triangleList->cbegin(); iter != triangleList->cend(); iter++ )
+	for( int i = 0; i < ( signed )blockArray->size(); i++ )
 	{
-		const Triangle& triangle = *iter;
-
-		double distance = triangle.DistanceToPoint( point );
-		if( distance <= smallestDistance )
+		Vector closestPoint;
+		double distanceSquared, u, v;
+		int j = ( *blockArray )[i].ClosestPoint( point, closestPoint, distanceSquared, u, v );
+		if( j >= 0 && distanceSquared <= smallestDistanceSquared )
 		{
-			smallestDistance = distance;
-			nearestTriangle = &triangle;
+			smallestDistanceSquared = distanceSquared;
+			nearestTriangle = ( *blockTriangleArray )[ i * PrecomputedTriangleBlock::SIZE + j ];
 		}
 	}
 
@@ -6,11 +6,13 @@
 #include "AxisAlignedBox.h"
 #include "Triangle.h"
 #include "Plane.h"
+#include "PrecomputedTriangle.h"
 
 namespace _3DMath
 {
 	class BoundingBoxTree;
 	class LineSegment;
+	class Ray;
 	class Renderer;
 }
 
@@ -28,9 +30,17 @@ public:
 	bool InsertTriangle( const Triangle& triangle );
 	bool InsertTriangleList( const TriangleList& triangleList, const Vector* normalFilter = nullptr, double angleFilter = 0.0 );
 
+	// This finds the intersection nearest the segment's first vertex.
 	bool FindIntersection( const LineSegment& lineSegment, const Triangle*& intersectedTriangle, Vector& intersectionPoint ) const;
+
+	// This finds the earliest point at which the ray meets a triangle within [tMin,tMax], where tMax
+	// is then left.  The nodes are visited nearest first, and those beyond the best hit so far skipped.
+	bool FindFirstIntersection( const Ray& ray, double tMin, double& tMax, const Triangle*& intersectedTriangle ) const;
 	bool FindNearestTriangle( const Vector& point, const Triangle*& nearestTriangle, double maxDistance ) const;
 
+	// Every triangle in the tree lies in this box; false is returned if the tree has no nodes.
+	bool GetBoundingBox( AxisAlignedBox& boundingBox ) const;
+
 	class _3DMATH_API Node
 	{
 	public:
@@ -39,7 +49,7 @@ public:
 		virtual ~Node( void );
 
 		virtual bool InsertTriangle( const Triangle& triangle ) = 0;
-		virtual bool FindIntersection( const LineSegment& lineSegment, const Triangle*& intersectedTriangle, Vector& intersectionPoint ) const = 0;
+		virtual bool FindFirstIntersection( const Ray& ray, double tMin, double& tMax, const Triangle*& intersectedTriangle ) const = 0;
 		virtual bool FindNearestTriangle( const Vector& point, const Triangle*& nearestTriangle, double maxDistance ) const = 0;
 
 		AxisAlignedBox boundingBox;
@@ -53,7 +63,7 @@ public:
 		virtual ~BranchNode( void );
 
 		virtual bool InsertTriangle( const Triangle& triangle ) override;
-		virtual bool FindIntersection( const LineSegment& lineSegment, const Triangle*& intersectedTriangle, Vector& intersectionPoint ) const override;
+		virtual bool FindFirstIntersection( const Ray& ray, double tMin, double& tMax, const Triangle*& intersectedTriangle ) const override;
 		virtual bool FindNearestTriangle( const Vector& point, const Triangle*& nearestTriangle, double maxDistance ) const override;
 
 		Plane plane;
@@ -69,10 +79,15 @@ public:
 		virtual ~LeafNode( void );
 
 		virtual bool InsertTriangle( const Triangle& triangle ) override;
-		virtual bool FindIntersection( const LineSegment& lineSegment, const Triangle*& intersectedTriangle, Vector& intersectionPoint ) const override;
+		virtual bool FindFirstIntersection( const Ray& ray, double tMin, double& tMax, const Triangle*& intersectedTriangle ) const override;
 		virtual bool FindNearestTriangle( const Vector& point, const Triangle*& nearestTriangle, double maxDistance ) const override;
 
 		TriangleList* triangleList;
+
+		// The same triangles, packed for the ray test.  The i-th slot of the j-th block is the
+		// triangle at blockTriangleArray[ j * PrecomputedTriangleBlock::SIZE + i ].
+		std::vector< PrecomputedTriangleBlock >* blockArray;
+		std::vector< const Triangle* >* blockTriangleArray;
 	};
 
 private:
@@ -0,0 +1,154 @@
+// BoundingVolumeHierarchy.cpp
+
+#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+
+using namespace _3DMath;
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy( void )
+{
+	nodeArray = new std::vector< Node >;
+	boxIndexArray = new std::vector< int >;
+	sortedBoxArray = new std::vector< AxisAlignedBox >;
+	centerArray = new VectorArray;
+}
+
+/*virtual*/ BoundingVolumeHierarchy::~BoundingVolumeHierarchy( void )
+{
+	delete nodeArray;
+	delete boxIndexArray;
+	delete sortedBoxArray;
+	delete centerArray;
+}
+
+void BoundingVolumeHierarchy::Clear( void )
+{
+	nodeArray->clear();
+	boxIndexArray->clear();
+	sortedBoxArray->clear();
+	centerArray->clear();
+}
+
+void BoundingVolumeHierarchy::Build( const AxisAlignedBox* boxArray, int boxCount )
+{
+	Clear();
+
+	if( boxCount <= 0 )
+		return;
+
+	boxIndexArray->resize( boxCount );
+	centerArray->resize( boxCount );
+
+	for( int i = 0; i < boxCount; i++ )
+	{
+		( *boxIndexArray )[i] = i;
+		boxArray[i].GetCenter( ( *centerArray )[i] );
+	}
+
+	// A binary tree with at least one box per leaf has fewer than twice as many nodes as boxes.
+	nodeArray->reserve( 2 * boxCount );
+	nodeArray->push_back( Node() );
+	BuildNode( boxArray, 0, boxCount, 0 );
+
+	// The leaves' boxes are copied out in tree order so that a query never leaves the tree's own memory.
+	sortedBoxArray->resize( boxCount );
+	for( int i = 0; i < boxCount; i++ )
+		( *sortedBoxArray )[i] = boxArray[ ( *boxIndexArray )[i] ];
+}
+
+// A branch is split at the median center along the longest axis of its centers' extent, which keeps
+// the tree balanced.
+void BoundingVolumeHierarchy::BuildNode( const AxisAlignedBox* boxArray, int begin, int end, int nodeIndex )
+{
+	int* boxIndex = &( *boxIndexArray )[0];
+	const Vector* center = &( *centerArray )[0];
+
+	AxisAlignedBox boundingBox( boxArray[ boxIndex[ begin ] ] );
+	AxisAlignedBox centerBox( center[ boxIndex[ begin ] ], center[ boxIndex[ begin ] ] );
+	for( int i = begin + 1; i < end; i++ )
+	{
+		boundingBox.Combine( boundingBox, boxArray[ boxIndex[i] ] );
+		centerBox.GrowToIncludePoint( center[ boxIndex[i] ] );
+	}
+
+	( *nodeArray )[ nodeIndex ].boundingBox = ToVecBox< float >( boundingBox );
+
+	if( end - begin <= MAX_LEAF_SIZE )
+	{
+		( *nodeArray )[ nodeIndex ].first = begin;
+		( *nodeArray )[ nodeIndex ].count = end - begin;
+		return;
+	}
+
+	Vector extent;
+	extent.Subtract( centerBox.posCorner, centerBox.negCorner );
+
+	int axis = 0;
+	if( extent.y > extent.x )
+		axis = 1;
+	if( extent.z > ( axis == 0 ? extent.x : extent.y ) )
+		axis = 2;
+
+	int middle = ( begin + end ) / 2;
+	std::nth_element( boxIndex + begin, boxIndex + middle, boxIndex + end, [ center, axis ]( int i, int j ) {
+		return ( &center[i].x )[ axis ] < ( &center[j].x )[ axis ];
+	} );
+
+	// The children are made adjacent so that a branch need only know the first.
+	int firstChild = ( int )nodeArray->size();
+	( *nodeArray )[ nodeIndex ].first = firstChild;
+	( *nodeArray )[ nodeIndex ].count = 0;
+
+	nodeArray->push_back( Node() );
+	nodeArray->push_back( Node() );
+
+	BuildNode( boxArray, begin, middle, firstChild );
+	BuildNode( boxArray, middle, end, firstChild + 1 );
+}
+
+int BoundingVolumeHierarchy::FindOverlaps( const AxisAlignedBox& box, std::vector< int >& indexArray ) const
+{
+	if( nodeArray->size() == 0 )
+		return 0;
+
+	const Node* node = &( *nodeArray )[0];
+	const int* boxIndex = &( *boxIndexArray )[0];
+	const AxisAlignedBox* sortedBox = &( *sortedBoxArray )[0];
+	int foundCount = 0;
+
+	// Both this and the nodes' boxes are rounded outward, so no overlap is missed in the descent.
+	VecBoxf queryBox = ToVecBox< float >( box );
+
+	// A balanced tree over any number of boxes an int can count is well under this deep.
+	int nodeStack[64];
+	int stackSize = 0;
+	nodeStack[ stackSize++ ] = 0;
+
+	while( stackSize > 0 )
+	{
+		const Node& currentNode = node[ nodeStack[ --stackSize ] ];
+		if( !BoxOverlapsBox( currentNode.boundingBox, queryBox ) )
+			continue;
+
+		if( currentNode.count > 0 )
+		{
+			for( int i = currentNode.first; i < currentNode.first + currentNode.count; i++ )
+			{
+				if( sortedBox[i].OverlapsWith( box, 0.0 ) )
+				{
+					indexArray.push_back( boxIndex[i] );
+					foundCount++;
+				}
+			}
+		}
+		else
+		{
+			nodeStack[ stackSize++ ] = currentNode.first + 1;
+			nodeStack[ stackSize++ ] = currentNode.first;
+		}
+	}
+
+	return foundCount;
+}
+
+// BoundingVolumeHierarchy.cpp
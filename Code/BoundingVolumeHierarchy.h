@@ -0,0 +1,53 @@
+// BoundingVolumeHierarchy.h
+
+#pragma once
+
+#include "Defines.h"
+#include "AxisAlignedBox.h"
+#include "VecGeometry.h"
+
+namespace _3DMath
+{
+	class BoundingVolumeHierarchy;
+}
+
+// This is a binary tree of boxes over a set of boxes, each known by its index in the given array,
+// for finding those that overlap a query box without looking at them all.  Unlike BoundingBoxTree,
+// whose cells are fixed up front and which owns the triangles put in it, this is fit to the boxes
+// each time it's built, which is cheap enough to do every step for a few hundred moving objects.
+// Branches keep single-precision boxes, rounded outward, so that descending the tree touches half
+// the memory; only the boxes at the leaves are tested at full precision, so the results are exact.
+class _3DMATH_API _3DMath::BoundingVolumeHierarchy
+{
+public:
+
+	BoundingVolumeHierarchy( void );
+	virtual ~BoundingVolumeHierarchy( void );
+
+	void Build( const AxisAlignedBox* boxArray, int boxCount );
+	void Clear( void );
+
+	// The indices of the boxes overlapping the given box are appended to the given array, in no
+	// particular order; the number appended is returned.
+	int FindOverlaps( const AxisAlignedBox& box, std::vector< int >& indexArray ) const;
+
+	enum { MAX_LEAF_SIZE = 2 };
+
+	struct Node
+	{
+		VecBoxf boundingBox;
+		int first;		// A leaf's boxes are [first,first+count) of the index array; a branch's children are nodes first and first+1.
+		int count;		// This is zero for a branch.
+	};
+
+private:
+
+	void BuildNode( const AxisAlignedBox* boxArray, int begin, int end, int nodeIndex );
+
+	std::vector< Node >* nodeArray;
+	std::vector< int >* boxIndexArray;
+	std::vector< AxisAlignedBox >* sortedBoxArray;
+	VectorArray* centerArray;
+};
+
+// BoundingVolumeHierarchy.h
@@ -5,6 +5,7 @@
 #include "Exception.h"
 #include "AffineTransform.h"
 #include "IndexTriangle.h"
+#include "Predicates.h"
 
 using namespace _3DMath;
 
@@ -32,7 +33,7 @@ void BspTree::Clear( void )
 	vertexArray = nullptr;
 }
 
-bool BspTree::Generate( const TriangleMesh& triangleMesh )
+bool BspTree::Generate( const TriangleMesh& triangleMesh, bool robust /*= false*/ )
 {
 	Clear();
 
@@ -47,7 +48,7 @@ bool BspTree::Generate( const TriangleMesh& triangleMesh )
 	try
 	{
 		rootNode = new Node();
-		rootNode->Generate( triangleList, *vertexArray );
+		rootNode->Generate( triangleList, *vertexArray, robust );
 	}
 	catch( Exception* exception )
 	{
@@ -196,13 +197,17 @@ void BspTree::Node::Render( Renderer& renderer, RenderMode renderMode, const Vec
 		lastNode->Render( renderer, renderMode, eye, bspTree, transform, normalTransform, vertexFlags );
 }
 
-void BspTree::Node::Generate( IndexTriangleList& givenTriangleList, std::vector< Vertex >& vertexArray )
+void BspTree::Node::Generate( IndexTriangleList& givenTriangleList, std::vector< Vertex >& vertexArray, bool robust /*= false*/ )
 {
 	IndexTriangleList::iterator iter = ChooseBestPartitioningTriangle( givenTriangleList, vertexArray );
 	IndexTriangle indexTriangle = *iter;
+	givenTriangleList.erase( iter );
 	indexTriangle.GetPlane( partitioningPlane, &vertexArray );
 	triangleList->push_back( indexTriangle );
 
+	Triangle partitioningTriangle;
+	indexTriangle.GetTriangle( partitioningTriangle, &vertexArray );
+
 	IndexTriangleList frontIndexTriangleList, backIndexTriangleList;
 
 	while( givenTriangleList.size() > 0 )
@@ -217,10 +222,19 @@ void BspTree::Node::Generate( IndexTriangleList& givenTriangleList, std::vector<
 		int frontCount = 0;
 		int backCount = 0;
 		int neitherCount = 0;
+		double orientation[3];
 
 		for( int i = 0; i < 3; i++ )
 		{
-			Plane::Side side = partitioningPlane.GetSide( triangle.vertex[i] );
+			Plane::Side side;
+			if( robust )
+			{
+				orientation[i] = Predicates::Orient3D( partitioningTriangle.vertex[0], partitioningTriangle.vertex[1], partitioningTriangle.vertex[2], triangle.vertex[i] );
+				side = ( orientation[i] > 0.0 ) ? Plane::SIDE_FRONT : ( ( orientation[i] < 0.0 ) ? Plane::SIDE_BACK : Plane::SIDE_NEITHER );
+			}
+			else
+				side = partitioningPlane.GetSide( triangle.vertex[i] );
+
 			if( side == Plane::SIDE_FRONT )
 				frontCount++;
 			else if( side == Plane::SIDE_BACK )
@@ -235,10 +249,23 @@ void BspTree::Node::Generate( IndexTriangleList& givenTriangleList, std::vector<
 			frontIndexTriangleList.push_back( indexTriangle );
 		else if( frontCount == 0 )
 			backIndexTriangleList.push_back( indexTriangle );
+		else if( robust )
+			SplitTriangleExactly( indexTriangle, orientation, vertexArray, frontIndexTriangleList, backIndexTriangleList );
 		else
 		{
+			// The split works to EPSILON, so it can fail on a triangle that only just straddles the plane.
+			// Rather than lose the triangle, put it whole on the side most of it is on.
 			TriangleList frontList, backList;
-			partitioningPlane.SplitTriangle( triangle, frontList, backList );
+			if( !partitioningPlane.SplitTriangle( triangle, frontList, backList ) )
+			{
+				frontList.clear();
+				backList.clear();
+
+				if( frontCount >= backCount )
+					frontList.push_back( triangle );
+				else
+					backList.push_back( triangle );
+			}
 
 			AddSubTriangles( frontIndexTriangleList, vertexArray, indexTriangle, frontList );
 			AddSubTriangles( backIndexTriangleList, vertexArray, indexTriangle, backList );
@@ -248,13 +275,13 @@ void BspTree::Node::Generate( IndexTriangleList& givenTriangleList, std::vector<
 	if( frontIndexTriangleList.size() > 0 )
 	{
 		frontNode = new Node();
-		frontNode->Generate( frontIndexTriangleList, vertexArray );
+		frontNode->Generate( frontIndexTriangleList, vertexArray, robust );
 	}
 
 	if( backIndexTriangleList.size() > 0 )
 	{
 		backNode = new Node();
-		backNode->Generate( backIndexTriangleList, vertexArray );
+		backNode->Generate( backIndexTriangleList, vertexArray, robust );
 	}
 }
 
@@ -321,6 +348,53 @@ void BspTree::Node::AddSubTriangles( IndexTriangleList& triangleList, std::vecto
 	}
 }
 
+void BspTree::Node::SplitTriangleExactly( const IndexTriangle& indexTriangle, const double* orientation, std::vector< Vertex >& vertexArray, IndexTriangleList& frontTriangleList, IndexTriangleList& backTriangleList )
+{
+	// A triangle cut by a plane leaves at most a quadrilateral on either side.
+	int frontPolygon[4], backPolygon[4];
+	int frontCount = 0, backCount = 0;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		int j = ( i + 1 ) % 3;
+
+		if( orientation[i] >= 0.0 )
+			frontPolygon[ frontCount++ ] = indexTriangle.vertex[i];
+		if( orientation[i] <= 0.0 )
+			backPolygon[ backCount++ ] = indexTriangle.vertex[i];
+
+		if( ( orientation[i] > 0.0 && orientation[j] < 0.0 ) || ( orientation[i] < 0.0 && orientation[j] > 0.0 ) )
+		{
+			// The orientation is linear in the point, so the ratio of its values at the ends of the edge
+			// says where the edge meets the plane; with the signs opposite, this is strictly inside (0,1).
+			double lambda = orientation[i] / ( orientation[i] - orientation[j] );
+
+			Vertex vertexA = vertexArray[ indexTriangle.vertex[i] ];
+			Vertex vertexB = vertexArray[ indexTriangle.vertex[j] ];
+
+			Vertex newVertex;
+			newVertex.position.Lerp( vertexA.position, vertexB.position, lambda );
+			newVertex.texCoords.Lerp( vertexA.texCoords, vertexB.texCoords, lambda );
+			newVertex.color.Lerp( vertexA.color, vertexB.color, lambda );
+			newVertex.alpha = ( 1.0 - lambda ) * vertexA.alpha + lambda * vertexB.alpha;
+			newVertex.normal.Slerp( vertexA.normal, vertexB.normal, lambda );
+
+			vertexArray.push_back( newVertex );
+			int newIndex = signed( vertexArray.size() ) - 1;
+
+			frontPolygon[ frontCount++ ] = newIndex;
+			backPolygon[ backCount++ ] = newIndex;
+		}
+	}
+
+	// The polygons keep the triangle's winding, so fanning them does too.
+	for( int i = 1; i < frontCount - 1; i++ )
+		frontTriangleList.push_back( IndexTriangle( frontPolygon[0], frontPolygon[i], frontPolygon[ i + 1 ] ) );
+
+	for( int i = 1; i < backCount - 1; i++ )
+		backTriangleList.push_back( IndexTriangle( backPolygon[0], backPolygon[i], backPolygon[ i + 1 ] ) );
+}
+
 IndexTriangleList::iterator BspTree::Node::ChooseBestPartitioningTriangle( IndexTriangleList& givenTriangleList, std::vector< Vertex >& vertexArray )
 {
 	IndexTriangleList::iterator iter = givenTriangleList.begin();
@@ -24,7 +24,9 @@ public:
 	BspTree( void );
 	virtual ~BspTree( void );
 
-	bool Generate( const TriangleMesh& triangleMesh );
+	// The robust mode classifies vertices against partitioning planes with exact predicates instead of
+	// EPSILON tests, and splits the triangles that straddle a plane by those same classifications.
+	bool Generate( const TriangleMesh& triangleMesh, bool robust = false );
 	void Clear( void );
 
 	enum RenderMode
@@ -48,13 +50,18 @@ public:
 		Node* backNode;
 		IndexTriangleList* triangleList;
 
-		void Generate( IndexTriangleList& givenTriangleList, std::vector< Vertex >& vertexArray );
+		void Generate( IndexTriangleList& givenTriangleList, std::vector< Vertex >& vertexArray, bool robust = false );
 		void Render( Renderer& renderer, RenderMode renderMode, const Vector& eye, const BspTree* bspTree, const AffineTransform& transform, const LinearTransform& normalTransform, int vertexFlags ) const;
 		void Transform( const AffineTransform& transform );
 
 		IndexTriangleList::iterator ChooseBestPartitioningTriangle( IndexTriangleList& givenTriangleList, std::vector< Vertex >& vertexArray );
 
 		void AddSubTriangles( IndexTriangleList& triangleList, std::vector< Vertex >& vertexArray, const IndexTriangle& indexTriangle, const TriangleList& subTriangleList );
+
+		// The triangle's vertices are on the sides given by the signs of their exact orientations to the
+		// partitioning plane.  Only edges with ends strictly on opposite sides are cut, and vertices on
+		// the plane go to both sides, so that no sub-triangle has to be classified again.
+		void SplitTriangleExactly( const IndexTriangle& indexTriangle, const double* orientation, std::vector< Vertex >& vertexArray, IndexTriangleList& frontTriangleList, IndexTriangleList& backTriangleList );
 	};
 
 	virtual bool FrontSpaceVisible( const Node* node ) const;
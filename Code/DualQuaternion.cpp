@@ -0,0 +1,224 @@
+// DualQuaternion.cpp
+
+#include "DualQuaternion.h"
+#include "AffineTransform.h"
+#include "BatchTransform.h"
+
+using namespace _3DMath;
+
+DualQuaternion::DualQuaternion( void )
+{
+	Identity();
+}
+
+DualQuaternion::DualQuaternion( const DualQuaternion& dualQuaternion )
+{
+	real = dualQuaternion.real;
+	dual = dualQuaternion.dual;
+}
+
+DualQuaternion::DualQuaternion( const Quaternion& real, const Quaternion& dual )
+{
+	this->real = real;
+	this->dual = dual;
+}
+
+DualQuaternion::DualQuaternion( const Quaternion& unitRotation, const Vector& translation )
+{
+	SetRigidBodyMotion( unitRotation, translation );
+}
+
+DualQuaternion::~DualQuaternion( void )
+{
+}
+
+DualQuaternion& DualQuaternion::operator=( const DualQuaternion& dualQuaternion )
+{
+	real = dualQuaternion.real;
+	dual = dualQuaternion.dual;
+	return *this;
+}
+
+void DualQuaternion::Identity( void )
+{
+	real.Identity();
+	dual.Set( 0.0, 0.0, 0.0, 0.0 );
+}
+
+// The dual part is t r / 2, where t is the translation taken as a pure quaternion.
+void DualQuaternion::SetRigidBodyMotion( const Quaternion& unitRotation, const Vector& translation )
+{
+	real = unitRotation;
+	dual.Multiply( Quaternion( 0.0, translation.x, translation.y, translation.z ), unitRotation );
+	dual.Scale( 0.5 );
+}
+
+void DualQuaternion::SetRigidBodyMotion( const Vector& unitAxis, double angle, const Vector& translation )
+{
+	SetRigidBodyMotion( Quaternion( unitAxis, angle ), translation );
+}
+
+void DualQuaternion::GetRigidBodyMotion( Quaternion& unitRotation, Vector& translation ) const
+{
+	unitRotation = real;
+	GetTranslation( translation );
+}
+
+void DualQuaternion::GetTranslation( Vector& translation ) const
+{
+	Quaternion realConjugate;
+	real.GetConjugate( realConjugate );
+
+	Quaternion product;
+	product.Multiply( dual, realConjugate );
+	translation.Set( 2.0 * product.x, 2.0 * product.y, 2.0 * product.z );
+}
+
+void DualQuaternion::SetFromAffineTransform( const AffineTransform& affineTransform )
+{
+	Quaternion unitRotation;
+	unitRotation.SetFromLinearTransform( affineTransform.linearTransform );
+	SetRigidBodyMotion( unitRotation, affineTransform.translation );
+}
+
+void DualQuaternion::GetAffineTransform( AffineTransform& affineTransform ) const
+{
+	real.GetLinearTransform( affineTransform.linearTransform );
+	GetTranslation( affineTransform.translation );
+}
+
+void DualQuaternion::Multiply( const DualQuaternion& dualQuaternion )
+{
+	DualQuaternion product;
+	product.Multiply( *this, dualQuaternion );
+	*this = product;
+}
+
+void DualQuaternion::Multiply( const DualQuaternion& dualQuaternionA, const DualQuaternion& dualQuaternionB )
+{
+	Quaternion dualA, dualB;
+	dualA.Multiply( dualQuaternionA.real, dualQuaternionB.dual );
+	dualB.Multiply( dualQuaternionA.dual, dualQuaternionB.real );
+
+	real.Multiply( dualQuaternionA.real, dualQuaternionB.real );
+	dual = dualA;
+	dual.Add( dualB );
+}
+
+void DualQuaternion::Concatinate( const DualQuaternion& dualQuaternion )
+{
+	Concatinate( DualQuaternion( *this ), dualQuaternion );
+}
+
+void DualQuaternion::Concatinate( const DualQuaternion& dualQuaternionA, const DualQuaternion& dualQuaternionB )
+{
+	Multiply( dualQuaternionB, dualQuaternionA );
+}
+
+void DualQuaternion::Invert( void )
+{
+	GetInverse( *this );
+}
+
+void DualQuaternion::GetInverse( DualQuaternion& dualQuaternion ) const
+{
+	real.GetConjugate( dualQuaternion.real );
+	dual.GetConjugate( dualQuaternion.dual );
+}
+
+void DualQuaternion::SetInverse( const DualQuaternion& dualQuaternion )
+{
+	dualQuaternion.GetInverse( *this );
+}
+
+bool DualQuaternion::Normalize( void )
+{
+	double length = real.Length();
+	if( length == 0.0 )
+		return false;
+
+	real.Scale( 1.0 / length );
+	dual.Scale( 1.0 / length );
+
+	Quaternion correction( real );
+	correction.Scale( -real.Dot( dual ) );
+	dual.Add( correction );
+	return true;
+}
+
+void DualQuaternion::Transform( Vector& point ) const
+{
+	Transform( point, point );
+}
+
+void DualQuaternion::Transform( const Vector& pointA, Vector& pointB ) const
+{
+	Vector translation;
+	GetTranslation( translation );
+	real.Rotate( pointA, pointB );
+	pointB.Add( translation );
+}
+
+void DualQuaternion::Transform( Vector* pointArray, int arraySize ) const
+{
+	AffineTransform affineTransform;
+	GetAffineTransform( affineTransform );
+
+	BatchTransform batchTransform;
+	batchTransform.SetPointTransform( affineTransform );
+	batchTransform.TransformPoints( pointArray, arraySize );
+}
+
+// A rotation is its own normal transform, so none needs to be derived.
+bool DualQuaternion::Transform( VertexArray& vertexArray ) const
+{
+	AffineTransform affineTransform;
+	GetAffineTransform( affineTransform );
+
+	BatchTransform batchTransform;
+	batchTransform.SetTransform( affineTransform, &affineTransform.linearTransform );
+
+	if( vertexArray.size() > 0 )
+		batchTransform.TransformVertices( &vertexArray[0], ( int )vertexArray.size() );
+
+	return true;
+}
+
+void DualQuaternion::Nlerp( const DualQuaternion& unitDualQuaternionA, const DualQuaternion& unitDualQuaternionB, double lambda )
+{
+	DualQuaternion dualQuaternionArray[2] = { unitDualQuaternionA, unitDualQuaternionB };
+	double weightArray[2] = { 1.0 - lambda, lambda };
+	Blend( dualQuaternionArray, weightArray, 2 );
+}
+
+bool DualQuaternion::Blend( const DualQuaternion* unitDualQuaternionArray, const double* weightArray, int arraySize )
+{
+	real.Set( 0.0, 0.0, 0.0, 0.0 );
+	dual.Set( 0.0, 0.0, 0.0, 0.0 );
+
+	for( int i = 0; i < arraySize; i++ )
+	{
+		// Keep every term in the same hemisphere as the first, so that antipodal representations of the same pose don't cancel.
+		const DualQuaternion& dualQuaternion = unitDualQuaternionArray[i];
+		double weight = weightArray[i];
+		if( i > 0 && dualQuaternion.real.Dot( unitDualQuaternionArray[0].real ) < 0.0 )
+			weight = -weight;
+
+		Quaternion term( dualQuaternion.real );
+		term.Scale( weight );
+		real.Add( term );
+
+		term = dualQuaternion.dual;
+		term.Scale( weight );
+		dual.Add( term );
+	}
+
+	return Normalize();
+}
+
+bool DualQuaternion::IsEqualTo( const DualQuaternion& dualQuaternion, double eps /*= EPSILON*/ ) const
+{
+	return real.IsEqualTo( dualQuaternion.real, eps ) && dual.IsEqualTo( dualQuaternion.dual, eps );
+}
+
+// DualQuaternion.cpp
@@ -0,0 +1,84 @@
+// DualQuaternion.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Quaternion.h"
+#include "Vertex.h"
+
+namespace _3DMath
+{
+	class DualQuaternion;
+	class AffineTransform;
+}
+
+// A unit dual quaternion represents a rigid-body motion: a rotation followed by a translation.
+// Chains of poses compose with one dual quaternion product instead of a 3x3 multiply plus a
+// transform, and blending several of them (as in skinning) does not collapse the volume the way
+// blending matrices does.
+class _3DMATH_API _3DMath::DualQuaternion
+{
+public:
+
+	DualQuaternion( void );
+	DualQuaternion( const DualQuaternion& dualQuaternion );
+	DualQuaternion( const Quaternion& real, const Quaternion& dual );
+	DualQuaternion( const Quaternion& unitRotation, const Vector& translation );
+	~DualQuaternion( void );
+
+	DualQuaternion& operator=( const DualQuaternion& dualQuaternion );
+
+	void Identity( void );
+
+	void SetRigidBodyMotion( const Quaternion& unitRotation, const Vector& translation );
+	void SetRigidBodyMotion( const Vector& unitAxis, double angle, const Vector& translation );
+	void GetRigidBodyMotion( Quaternion& unitRotation, Vector& translation ) const;
+
+	void GetTranslation( Vector& translation ) const;
+
+	// The given transform is assumed to be rigid.
+	void SetFromAffineTransform( const AffineTransform& affineTransform );
+	void GetAffineTransform( AffineTransform& affineTransform ) const;
+
+	void Multiply( const DualQuaternion& dualQuaternion );
+	void Multiply( const DualQuaternion& dualQuaternionA, const DualQuaternion& dualQuaternionB );
+
+	// As with AffineTransform, concatination applies the first motion, then the second.
+	void Concatinate( const DualQuaternion& dualQuaternion );
+	void Concatinate( const DualQuaternion& dualQuaternionA, const DualQuaternion& dualQuaternionB );
+
+	// For a unit dual quaternion, the inverse is just the quaternion conjugate of both parts.
+	void Invert( void );
+	void GetInverse( DualQuaternion& dualQuaternion ) const;
+	void SetInverse( const DualQuaternion& dualQuaternion );
+
+	// This rescales to unit length and removes any drift of the dual part away from orthogonality with the real part.
+	bool Normalize( void );
+
+	// These assume a unit dual quaternion.
+	void Transform( Vector& point ) const;
+	void Transform( const Vector& pointA, Vector& pointB ) const;
+	void Transform( Vector* pointArray, int arraySize ) const;
+	bool Transform( VertexArray& vertexArray ) const;
+
+	// This is linear blending followed by normalization (DLB), which is what skinning wants.
+	void Nlerp( const DualQuaternion& unitDualQuaternionA, const DualQuaternion& unitDualQuaternionB, double lambda );
+	bool Blend( const DualQuaternion* unitDualQuaternionArray, const double* weightArray, int arraySize );
+
+	bool IsEqualTo( const DualQuaternion& dualQuaternion, double eps = EPSILON ) const;
+
+	Quaternion real;
+	Quaternion dual;
+};
+
+namespace _3DMath
+{
+	inline DualQuaternion operator*( const DualQuaternion& dualQuaternionA, const DualQuaternion& dualQuaternionB )
+	{
+		DualQuaternion product;
+		product.Multiply( dualQuaternionA, dualQuaternionB );
+		return product;
+	}
+}
+
+// DualQuaternion.h
@@ -0,0 +1,424 @@
+// FastMath.cpp
+
+#include "FastMath.h"
+#include "BatchTransform.h"
+#include "Simd.h"
+#include <float.h>
+
+using namespace _3DMath;
+
+static FastMath::Precision defaultPrecision = FastMath::PRECISION_EXACT;
+
+static inline bool UseFast( FastMath::Precision precision )
+{
+	if( precision == FastMath::PRECISION_DEFAULT )
+		precision = defaultPrecision;
+
+	return precision == FastMath::PRECISION_FAST;
+}
+
+static inline bool UseAVX2( void )
+{
+	return BatchTransform::GetSupportedInstructions() == BatchTransform::INSTRUCTIONS_AVX2;
+}
+
+// The polynomials are the Cephes ones.  Sine and cosine are good on [-pi/4,pi/4], and the
+// arctangent rational function on [-0.42,0.66].
+static const double sineCoefficient[6] = { 1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6, -1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1 };
+static const double cosineCoefficient[6] = { -1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7, 2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2 };
+static const double arcTangentNumerator[5] = { -8.750608600031904122785e-1, -1.615753718733365076637e1, -7.500855792314704667340e1, -1.228866684490136173410e2, -6.485021904942025371773e1 };
+static const double arcTangentDenominator[5] = { 2.485846490142306297962e1, 1.650270098316988542046e2, 4.328810604912902668951e2, 4.853903996359136964868e2, 1.945506571482613964425e2 };
+
+// Pi/2 split so that multiples of the high part up to the range limit below are exact.
+static const double halfPiHigh = 1.57079632673412561417e+00;
+static const double halfPiLow = 6.07710050650619224932e-11;
+static const double maxSinCosAngle = 1e6;
+
+// What M_PI_2 is short of pi/2.
+static const double halfPiLost = 6.123233995736765886130e-17;
+
+//---------------------------------------------------------------------
+//                                Scalar
+//---------------------------------------------------------------------
+
+static inline double Polynomial( const double* coefficient, int count, double z )
+{
+	double result = coefficient[0];
+	for( int i = 1; i < count; i++ )
+		result = result * z + coefficient[i];
+	return result;
+}
+
+// This is the same as above with an implicit leading coefficient of one.
+static inline double MonicPolynomial( const double* coefficient, int count, double z )
+{
+	double result = z + coefficient[0];
+	for( int i = 1; i < count; i++ )
+		result = result * z + coefficient[i];
+	return result;
+}
+
+static inline double InverseSqrtFast( double x )
+{
+#if defined _3DMATH_X86
+	if( x >= FLT_MIN && x <= FLT_MAX )
+	{
+		// Start from the 12-bit single-precision estimate; each Newton step doubles the bits.
+		double y = _mm_cvtss_f32( _mm_rsqrt_ss( _mm_set_ss( float( x ) ) ) );
+		double halfX = 0.5 * x;
+		y *= 1.5 - halfX * y * y;
+		y *= 1.5 - halfX * y * y;
+		return y;
+	}
+#endif
+	return 1.0 / sqrt( x );
+}
+
+static inline void SinCosFast( double angle, double& sine, double& cosine )
+{
+	if( !( fabs( angle ) < maxSinCosAngle ) )
+	{
+		sine = sin( angle );
+		cosine = cos( angle );
+		return;
+	}
+
+	// Reduce to [-pi/4,pi/4] and remember which quadrant we came from.
+	int q = int( angle * ( 2.0 / M_PI ) + ( angle < 0.0 ? -0.5 : 0.5 ) );
+	double quadrant = double( q );
+	double r = ( angle - quadrant * halfPiHigh ) - quadrant * halfPiLow;
+	double z = r * r;
+
+	double s = r + r * z * Polynomial( sineCoefficient, 6, z );
+	double c = 1.0 - 0.5 * z + z * z * Polynomial( cosineCoefficient, 6, z );
+
+	if( q & 1 )
+	{
+		double t = s;
+		s = c;
+		c = t;
+	}
+
+	sine = ( q & 2 ) ? -s : s;
+	cosine = ( ( q + 1 ) & 2 ) ? -c : c;
+}
+
+// The arctangent of lesser / greater, where 0 <= lesser <= greater.  Above 0.66, this uses
+// atan(a) = pi/4 + atan((a-1)/(a+1)), folded into the one division.
+static inline double ArcTangentUnitFast( double lesser, double greater )
+{
+	if( greater == 0.0 )
+		return 0.0;
+
+	bool shift = lesser > 0.66 * greater;
+	double t = shift ? ( lesser - greater ) / ( lesser + greater ) : lesser / greater;
+	double z = t * t;
+	double result = t + t * z * Polynomial( arcTangentNumerator, 5, z ) / MonicPolynomial( arcTangentDenominator, 5, z );
+	return shift ? M_PI_4 + ( result + 0.5 * halfPiLost ) : result;
+}
+
+static inline double ATan2Fast( double y, double x )
+{
+	double absY = fabs( y );
+	double absX = fabs( x );
+	double greater = MAX( absX, absY );
+	double lesser = MIN( absX, absY );
+
+	double result = ArcTangentUnitFast( lesser, greater );
+	if( absY > absX )
+		result = ( M_PI_2 - result ) + halfPiLost;
+	if( signbit( x ) )
+		result = ( M_PI - result ) + 2.0 * halfPiLost;
+
+	return copysign( result, y );
+}
+
+static inline double ACosFast( double x )
+{
+	x = MAX( -1.0, MIN( x, 1.0 ) );
+	return ATan2Fast( sqrt( ( 1.0 - x ) * ( 1.0 + x ) ), x );
+}
+
+#if defined _3DMATH_X86
+
+//---------------------------------------------------------------------
+//                                 AVX2
+//---------------------------------------------------------------------
+
+// These mirror the scalar forms with the branches turned into blends.  Any group of four with a
+// lane outside the fast domain is handed back to the scalar form, which knows what to do.
+
+_3DMATH_TARGET_AVX2 static inline __m256d PolynomialAVX2( const double* coefficient, int count, __m256d z )
+{
+	__m256d result = _mm256_set1_pd( coefficient[0] );
+	for( int i = 1; i < count; i++ )
+		result = _mm256_fmadd_pd( result, z, _mm256_set1_pd( coefficient[i] ) );
+	return result;
+}
+
+_3DMATH_TARGET_AVX2 static inline __m256d MonicPolynomialAVX2( const double* coefficient, int count, __m256d z )
+{
+	__m256d result = _mm256_add_pd( z, _mm256_set1_pd( coefficient[0] ) );
+	for( int i = 1; i < count; i++ )
+		result = _mm256_fmadd_pd( result, z, _mm256_set1_pd( coefficient[i] ) );
+	return result;
+}
+
+_3DMATH_TARGET_AVX2 static inline __m256d SignMaskAVX2( void )
+{
+	return _mm256_set1_pd( -0.0 );
+}
+
+_3DMATH_TARGET_AVX2 static int InverseSqrtAVX2( const double* xArray, double* resultArray, int arraySize )
+{
+	__m256d minimum = _mm256_set1_pd( FLT_MIN );
+	__m256d maximum = _mm256_set1_pd( FLT_MAX );
+	__m256d half = _mm256_set1_pd( 0.5 );
+	__m256d threeHalves = _mm256_set1_pd( 1.5 );
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4 )
+	{
+		__m256d x = _mm256_loadu_pd( xArray + i );
+		__m256d inRange = _mm256_and_pd( _mm256_cmp_pd( x, minimum, _CMP_GE_OQ ), _mm256_cmp_pd( x, maximum, _CMP_LE_OQ ) );
+		if( _mm256_movemask_pd( inRange ) != 0xF )
+		{
+			for( int j = i; j < i + 4; j++ )
+				resultArray[j] = InverseSqrtFast( xArray[j] );
+			continue;
+		}
+
+		__m256d y = _mm256_cvtps_pd( _mm_rsqrt_ps( _mm256_cvtpd_ps( x ) ) );
+		__m256d halfX = _mm256_mul_pd( half, x );
+		y = _mm256_mul_pd( y, _mm256_fnmadd_pd( _mm256_mul_pd( halfX, y ), y, threeHalves ) );
+		y = _mm256_mul_pd( y, _mm256_fnmadd_pd( _mm256_mul_pd( halfX, y ), y, threeHalves ) );
+		_mm256_storeu_pd( resultArray + i, y );
+	}
+
+	return i;
+}
+
+_3DMATH_TARGET_AVX2 static int SinCosAVX2( const double* angleArray, double* sineArray, double* cosineArray, int arraySize )
+{
+	__m256d maximum = _mm256_set1_pd( maxSinCosAngle );
+	__m256d one = _mm256_set1_pd( 1.0 );
+	__m256d half = _mm256_set1_pd( 0.5 );
+	__m256i quadrantOne = _mm256_set1_epi64x( 1 );
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4 )
+	{
+		__m256d angle = _mm256_loadu_pd( angleArray + i );
+		__m256d inRange = _mm256_cmp_pd( _mm256_andnot_pd( SignMaskAVX2(), angle ), maximum, _CMP_LT_OQ );
+		if( _mm256_movemask_pd( inRange ) != 0xF )
+		{
+			for( int j = i; j < i + 4; j++ )
+				SinCosFast( angleArray[j], sineArray[j], cosineArray[j] );
+			continue;
+		}
+
+		__m256d quadrant = _mm256_round_pd( _mm256_mul_pd( angle, _mm256_set1_pd( 2.0 / M_PI ) ), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+		__m256d r = _mm256_fnmadd_pd( quadrant, _mm256_set1_pd( halfPiHigh ), angle );
+		r = _mm256_fnmadd_pd( quadrant, _mm256_set1_pd( halfPiLow ), r );
+		__m256d z = _mm256_mul_pd( r, r );
+
+		__m256d s = _mm256_fmadd_pd( _mm256_mul_pd( r, z ), PolynomialAVX2( sineCoefficient, 6, z ), r );
+		__m256d c = _mm256_fmadd_pd( _mm256_mul_pd( z, z ), PolynomialAVX2( cosineCoefficient, 6, z ), _mm256_fnmadd_pd( half, z, one ) );
+
+		// Blends only look at the sign bit, so the quadrant bits are shifted up there.
+		__m256i q = _mm256_cvtepi32_epi64( _mm256_cvtpd_epi32( quadrant ) );
+		__m256d swap = _mm256_castsi256_pd( _mm256_slli_epi64( q, 63 ) );
+		__m256d sineSign = _mm256_castsi256_pd( _mm256_slli_epi64( _mm256_srli_epi64( q, 1 ), 63 ) );
+		__m256d cosineSign = _mm256_castsi256_pd( _mm256_slli_epi64( _mm256_srli_epi64( _mm256_add_epi64( q, quadrantOne ), 1 ), 63 ) );
+
+		_mm256_storeu_pd( sineArray + i, _mm256_xor_pd( _mm256_blendv_pd( s, c, swap ), sineSign ) );
+		_mm256_storeu_pd( cosineArray + i, _mm256_xor_pd( _mm256_blendv_pd( c, s, swap ), cosineSign ) );
+	}
+
+	return i;
+}
+
+_3DMATH_TARGET_AVX2 static inline __m256d ATan2AVX2( __m256d y, __m256d x )
+{
+	__m256d zero = _mm256_setzero_pd();
+
+	__m256d absY = _mm256_andnot_pd( SignMaskAVX2(), y );
+	__m256d absX = _mm256_andnot_pd( SignMaskAVX2(), x );
+	__m256d greater = _mm256_max_pd( absX, absY );
+	__m256d lesser = _mm256_min_pd( absX, absY );
+
+	__m256d shift = _mm256_cmp_pd( lesser, _mm256_mul_pd( greater, _mm256_set1_pd( 0.66 ) ), _CMP_GT_OQ );
+	__m256d numerator = _mm256_blendv_pd( lesser, _mm256_sub_pd( lesser, greater ), shift );
+	__m256d denominator = _mm256_blendv_pd( greater, _mm256_add_pd( lesser, greater ), shift );
+	__m256d t = _mm256_and_pd( _mm256_div_pd( numerator, denominator ), _mm256_cmp_pd( greater, zero, _CMP_NEQ_OQ ) );
+	__m256d z = _mm256_mul_pd( t, t );
+	__m256d ratio = _mm256_div_pd( PolynomialAVX2( arcTangentNumerator, 5, z ), MonicPolynomialAVX2( arcTangentDenominator, 5, z ) );
+	__m256d result = _mm256_fmadd_pd( _mm256_mul_pd( t, z ), ratio, t );
+	result = _mm256_add_pd( _mm256_and_pd( shift, _mm256_set1_pd( M_PI_4 ) ), _mm256_add_pd( result, _mm256_and_pd( shift, _mm256_set1_pd( 0.5 * halfPiLost ) ) ) );
+
+	__m256d reflected = _mm256_add_pd( _mm256_sub_pd( _mm256_set1_pd( M_PI_2 ), result ), _mm256_set1_pd( halfPiLost ) );
+	result = _mm256_blendv_pd( result, reflected, _mm256_cmp_pd( absY, absX, _CMP_GT_OQ ) );
+
+	reflected = _mm256_add_pd( _mm256_sub_pd( _mm256_set1_pd( M_PI ), result ), _mm256_set1_pd( 2.0 * halfPiLost ) );
+	result = _mm256_blendv_pd( result, reflected, x );
+
+	return _mm256_or_pd( result, _mm256_and_pd( SignMaskAVX2(), y ) );
+}
+
+_3DMATH_TARGET_AVX2 static int ATan2AVX2( const double* yArray, const double* xArray, double* resultArray, int arraySize )
+{
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4 )
+		_mm256_storeu_pd( resultArray + i, ATan2AVX2( _mm256_loadu_pd( yArray + i ), _mm256_loadu_pd( xArray + i ) ) );
+
+	return i;
+}
+
+_3DMATH_TARGET_AVX2 static int ACosAVX2( const double* xArray, double* resultArray, int arraySize )
+{
+	__m256d one = _mm256_set1_pd( 1.0 );
+	__m256d negativeOne = _mm256_set1_pd( -1.0 );
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4 )
+	{
+		__m256d x = _mm256_max_pd( negativeOne, _mm256_min_pd( _mm256_loadu_pd( xArray + i ), one ) );
+		__m256d y = _mm256_sqrt_pd( _mm256_mul_pd( _mm256_sub_pd( one, x ), _mm256_add_pd( one, x ) ) );
+		_mm256_storeu_pd( resultArray + i, ATan2AVX2( y, x ) );
+	}
+
+	return i;
+}
+
+#endif //_3DMATH_X86
+
+//---------------------------------------------------------------------
+//                               FastMath
+//---------------------------------------------------------------------
+
+/*static*/ void FastMath::SetDefaultPrecision( Precision precision )
+{
+	defaultPrecision = ( precision == PRECISION_DEFAULT ) ? PRECISION_EXACT : precision;
+}
+
+/*static*/ FastMath::Precision FastMath::GetDefaultPrecision( void )
+{
+	return defaultPrecision;
+}
+
+/*static*/ double FastMath::InverseSqrt( double x, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	if( UseFast( precision ) )
+		return InverseSqrtFast( x );
+
+	return 1.0 / sqrt( x );
+}
+
+/*static*/ void FastMath::SinCos( double angle, double& sine, double& cosine, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	if( UseFast( precision ) )
+		SinCosFast( angle, sine, cosine );
+	else
+	{
+		sine = sin( angle );
+		cosine = cos( angle );
+	}
+}
+
+/*static*/ double FastMath::ACos( double x, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	if( UseFast( precision ) )
+		return ACosFast( x );
+
+	return acos( x );
+}
+
+/*static*/ double FastMath::ATan2( double y, double x, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	if( UseFast( precision ) )
+		return ATan2Fast( y, x );
+
+	return atan2( y, x );
+}
+
+/*static*/ void FastMath::InverseSqrt( const double* xArray, double* resultArray, int arraySize, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	int i = 0;
+	if( UseFast( precision ) )
+	{
+#if defined _3DMATH_X86
+		if( UseAVX2() )
+			i = InverseSqrtAVX2( xArray, resultArray, arraySize );
+#endif
+		for( ; i < arraySize; i++ )
+			resultArray[i] = InverseSqrtFast( xArray[i] );
+	}
+	else
+	{
+		for( ; i < arraySize; i++ )
+			resultArray[i] = 1.0 / sqrt( xArray[i] );
+	}
+}
+
+/*static*/ void FastMath::SinCos( const double* angleArray, double* sineArray, double* cosineArray, int arraySize, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	int i = 0;
+	if( UseFast( precision ) )
+	{
+#if defined _3DMATH_X86
+		if( UseAVX2() )
+			i = SinCosAVX2( angleArray, sineArray, cosineArray, arraySize );
+#endif
+		for( ; i < arraySize; i++ )
+			SinCosFast( angleArray[i], sineArray[i], cosineArray[i] );
+	}
+	else
+	{
+		for( ; i < arraySize; i++ )
+		{
+			double angle = angleArray[i];
+			sineArray[i] = sin( angle );
+			cosineArray[i] = cos( angle );
+		}
+	}
+}
+
+/*static*/ void FastMath::ACos( const double* xArray, double* resultArray, int arraySize, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	int i = 0;
+	if( UseFast( precision ) )
+	{
+#if defined _3DMATH_X86
+		if( UseAVX2() )
+			i = ACosAVX2( xArray, resultArray, arraySize );
+#endif
+		for( ; i < arraySize; i++ )
+			resultArray[i] = ACosFast( xArray[i] );
+	}
+	else
+	{
+		for( ; i < arraySize; i++ )
+			resultArray[i] = acos( xArray[i] );
+	}
+}
+
+/*static*/ void FastMath::ATan2( const double* yArray, const double* xArray, double* resultArray, int arraySize, Precision precision /*= PRECISION_DEFAULT*/ )
+{
+	int i = 0;
+	if( UseFast( precision ) )
+	{
+#if defined _3DMATH_X86
+		if( UseAVX2() )
+			i = ATan2AVX2( yArray, xArray, resultArray, arraySize );
+#endif
+		for( ; i < arraySize; i++ )
+			resultArray[i] = ATan2Fast( yArray[i], xArray[i] );
+	}
+	else
+	{
+		for( ; i < arraySize; i++ )
+			resultArray[i] = atan2( yArray[i], xArray[i] );
+	}
+}
+
+// FastMath.cpp
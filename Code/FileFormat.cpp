@@ -4,6 +4,9 @@
 #include "TriangleMesh.h"
 #include "Exception.h"
 #include "Renderer.h"
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
 
 using namespace _3DMath;
 
@@ -21,8 +24,9 @@ FileFormat::FileFormat( void )
 
 /*virtual*/ bool FileFormat::LoadTriangleMesh( TriangleMesh& triangleMesh, const std::string& file )
 {
+	// Binary mode is harmless for our text formats and required for the binary ones.
 	std::ifstream stream;
-	stream.open( file );
+	stream.open( file, std::ios::in | std::ios::binary );
 	if( !stream.is_open() )
 		return false;
 
@@ -32,24 +36,108 @@ FileFormat::FileFormat( void )
 /*virtual*/ bool FileFormat::SaveTriangleMesh( const TriangleMesh& triangleMesh, const std::string& file )
 {
 	std::ofstream stream;
-	stream.open( file );
+	stream.open( file, std::ios::out | std::ios::binary );
 	if( !stream.is_open() )
 		return false;
 
 	return SaveTriangleMesh( triangleMesh, stream );
 }
 
-/*static*/ FileFormat* FileFormat::CreateForFile( const std::string& file )
+// Extensions are kept and compared in lower case.
+static std::string ToLower( const std::string& string )
 {
-	FileFormat* fileFormat = nullptr;
+	std::string lowerString = string;
+	for( int i = 0; i < ( signed )lowerString.length(); i++ )
+		lowerString[i] = ( char )::tolower( lowerString[i] );
 
-	if( file.find( ".ply" ) >= 0 )
-		fileFormat = new PlyFormat();
+	return lowerString;
+}
+
+/*static*/ FileFormat::RegistrationArray& FileFormat::GetRegistrationArray( void )
+{
+	struct BuiltInRegistrationArray : public RegistrationArray
+	{
+		BuiltInRegistrationArray( void )
+		{
+			Registration registration;
+
+			registration.extension = MeshCacheFormat::extension;
+			registration.sniffFunction = &MeshCacheFormat::Sniff;
+			registration.createFunction = &MeshCacheFormat::Create;
+			push_back( registration );
+
+			registration.extension = ".ply";
+			registration.sniffFunction = &PlyFormat::Sniff;
+			registration.createFunction = &PlyFormat::Create;
+			push_back( registration );
+
+			registration.extension = ".obj";
+			registration.sniffFunction = &ObjFormat::Sniff;
+			registration.createFunction = &ObjFormat::Create;
+			push_back( registration );
+		}
+	};
+
+	static BuiltInRegistrationArray registrationArray;
+	return registrationArray;
+}
+
+/*static*/ void FileFormat::RegisterFormat( const std::string& extension, SniffFunction sniffFunction, CreateFunction createFunction )
+{
+	Registration registration;
+	registration.extension = ToLower( extension );
+	registration.sniffFunction = sniffFunction;
+	registration.createFunction = createFunction;
+
+	// Formats registered later take precedence so that a user can override a built-in one.
+	RegistrationArray& registrationArray = GetRegistrationArray();
+	registrationArray.insert( registrationArray.begin(), registration );
+}
+
+/*static*/ FileFormat* FileFormat::CreateForFile( const std::string& file, bool sniffContents /*= false*/ )
+{
+	char header[ SNIFF_SIZE ];
+	int headerSize = 0;
+
+	if( sniffContents )
+	{
+		std::ifstream stream;
+		stream.open( file, std::ios::in | std::ios::binary );
+		if( stream.is_open() )
+		{
+			stream.read( header, SNIFF_SIZE );
+			headerSize = ( int )stream.gcount();
+		}
+	}
+
+	return CreateForHeader( file, header, headerSize );
+}
+
+/*static*/ FileFormat* FileFormat::CreateForHeader( const std::string& file, const char* header, int headerSize )
+{
+	const RegistrationArray& registrationArray = GetRegistrationArray();
+
+	if( headerSize > 0 )
+	{
+		for( int i = 0; i < ( signed )registrationArray.size(); i++ )
+		{
+			const Registration& registration = registrationArray[i];
+			if( registration.sniffFunction && registration.sniffFunction( header, headerSize ) )
+				return registration.createFunction();
+		}
+	}
+
+	std::string lowerFile = ToLower( file );
 
-	if( file.find( ".obj" ) >= 0 )
-		fileFormat = new ObjFormat();
+	for( int i = 0; i < ( signed )registrationArray.size(); i++ )
+	{
+		const Registration& registration = registrationArray[i];
+		const std::string& extension = registration.extension;
+		if( lowerFile.length() >= extension.length() && lowerFile.compare( lowerFile.length() - extension.length(), extension.length(), extension ) == 0 )
+			return registration.createFunction();
+	}
 
-	return fileFormat;
+	return nullptr;
 }
 
 FileFormat::LineArray* FileFormat::TokenizeFile( std::istream& stream )
@@ -107,6 +195,16 @@ PlyFormat::PlyFormat( void )
 {
 }
 
+/*static*/ FileFormat* PlyFormat::Create( void )
+{
+	return new PlyFormat();
+}
+
+/*static*/ bool PlyFormat::Sniff( const char* header, int headerSize )
+{
+	return( headerSize >= 4 && memcmp( header, "ply", 3 ) == 0 && ( header[3] == '\n' || header[3] == '\r' ) );
+}
+
 /*virtual*/ bool PlyFormat::LoadTriangleMesh( TriangleMesh& triangleMesh, std::istream& stream )
 {
     bool success = true;
@@ -280,43 +378,75 @@ void PlyFormat::AddTriangles( TriangleMesh& triangleMesh, const LineArray::itera
 
 /*virtual*/ bool PlyFormat::SaveTriangleMesh( const TriangleMesh& triangleMesh, std::ostream& stream )
 {
-	stream << "ply" << std::endl;
-	stream << "format ascii 1.0" << std::endl;
-	stream << "comment Generated by 3DMath library." << std::endl;
-	stream << "element vertex " << triangleMesh.vertexArray->size() << std::endl;
-	stream << "property double x" << std::endl;
-	stream << "property double y" << std::endl;
-	stream << "property double z" << std::endl;
-	stream << "property double nx" << std::endl;
-	stream << "property double ny" << std::endl;
-	stream << "property double nz" << std::endl;
-	stream << "property double r" << std::endl;
-	stream << "property double g" << std::endl;
-	stream << "property double b" << std::endl;
-	stream << "property double u" << std::endl;
-	stream << "property double v" << std::endl;
-	stream << "element face " << triangleMesh.triangleList->size() << std::endl;
-	stream << "property list uchar int vertex_indices" << std::endl;
-	stream << "end_header" << std::endl;
+	StreamWriter writer( stream );
+
+	writer.Write( "ply\n" );
+	writer.Write( "format ascii 1.0\n" );
+	writer.Write( "comment Generated by 3DMath library.\n" );
+	writer.Write( "element vertex " );
+	writer.WriteInteger( triangleMesh.vertexArray->size() );
+	writer.Write( '\n' );
+	writer.Write( "property double x\n" );
+	writer.Write( "property double y\n" );
+	writer.Write( "property double z\n" );
+	writer.Write( "property double nx\n" );
+	writer.Write( "property double ny\n" );
+	writer.Write( "property double nz\n" );
+	writer.Write( "property double r\n" );
+	writer.Write( "property double g\n" );
+	writer.Write( "property double b\n" );
+	writer.Write( "property double u\n" );
+	writer.Write( "property double v\n" );
+	writer.Write( "element face " );
+	writer.WriteInteger( triangleMesh.triangleList->size() );
+	writer.Write( '\n' );
+	writer.Write( "property list uchar int vertex_indices\n" );
+	writer.Write( "end_header\n" );
 
 	for( int i = 0; i < ( signed )triangleMesh.vertexArray->size(); i++ )
 	{
 		const Vertex& vertex = ( *triangleMesh.vertexArray )[i];
 
-		stream << vertex.position.x << " " << vertex.position.y << " " << vertex.position.z << " ";
-		stream << vertex.normal.x << " " << vertex.normal.y << " " << vertex.normal.z << " ";
-		stream << vertex.color.x << " " << vertex.color.y << " " << vertex.color.z << " ";
-		stream << vertex.texCoords.x << " " << vertex.texCoords.y << std::endl;
+		writer.WriteDouble( vertex.position.x );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.position.y );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.position.z );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.normal.x );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.normal.y );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.normal.z );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.color.x );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.color.y );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.color.z );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.texCoords.x );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.texCoords.y );
+		writer.Write( '\n' );
 	}
 
 	for( IndexTriangleList::const_iterator iter = triangleMesh.triangleList->cbegin(); iter != triangleMesh.triangleList->cend(); iter++ )
 	{
 		const IndexTriangle& triangle = *iter;
 
-		stream << "3 " << triangle.vertex[0] << " " << triangle.vertex[1] << " " << triangle.vertex[2] << std::endl;
+		writer.Write( "3 " );
+		writer.WriteInteger( triangle.vertex[0] );
+		writer.Write( ' ' );
+		writer.WriteInteger( triangle.vertex[1] );
+		writer.Write( ' ' );
+		writer.WriteInteger( triangle.vertex[2] );
+		writer.Write( '\n' );
 	}
 
-    return true;
+	writer.Flush();
+
+	return writer.Good();
 }
 
 //---------------------------------------------------------------------
@@ -331,6 +461,48 @@ ObjFormat::ObjFormat( void )
 {
 }
 
+/*static*/ FileFormat* ObjFormat::Create( void )
+{
+	return new ObjFormat();
+}
+
+// OBJ has no signature, so we look for the first line that isn't blank or a comment and check its keyword.
+/*static*/ bool ObjFormat::Sniff( const char* header, int headerSize )
+{
+	static const char* keywordArray[] = { "v", "vt", "vn", "vp", "f", "o", "g", "s", "mtllib", "usemtl", nullptr };
+
+	int i = 0;
+	while( i < headerSize )
+	{
+		while( i < headerSize && ::isspace( ( unsigned char )header[i] ) )
+			i++;
+
+		if( i < headerSize && header[i] == '#' )
+		{
+			while( i < headerSize && header[i] != '\n' )
+				i++;
+			continue;
+		}
+
+		break;
+	}
+
+	int j = i;
+	while( j < headerSize && !::isspace( ( unsigned char )header[j] ) )
+		j++;
+
+	// The keyword must be followed by something, or we can't be sure we saw all of it.
+	if( j == i || j == headerSize )
+		return false;
+
+	std::string keyword( &header[i], j - i );
+	for( int k = 0; keywordArray[k]; k++ )
+		if( keyword == keywordArray[k] )
+			return true;
+
+	return false;
+}
+
 /*virtual*/ bool ObjFormat::LoadTriangleMesh( TriangleMesh& triangleMesh, std::istream& stream )
 {
 	bool success = true;
@@ -409,7 +581,74 @@ ObjFormat::ObjFormat( void )
 
 /*virtual*/ bool ObjFormat::SaveTriangleMesh( const TriangleMesh& triangleMesh, std::ostream& stream )
 {
-	return false;
+	StreamWriter writer( stream );
+
+	writer.Write( "# Generated by 3DMath library.\n" );
+
+	// Our vertices carry all attributes together, so each attribute array
+	// is written in vertex order and a face corner uses the same index into each.
+	for( int i = 0; i < ( signed )triangleMesh.vertexArray->size(); i++ )
+	{
+		const Vertex& vertex = ( *triangleMesh.vertexArray )[i];
+
+		writer.Write( "v " );
+		writer.WriteDouble( vertex.position.x );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.position.y );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.position.z );
+		writer.Write( '\n' );
+	}
+
+	for( int i = 0; i < ( signed )triangleMesh.vertexArray->size(); i++ )
+	{
+		const Vertex& vertex = ( *triangleMesh.vertexArray )[i];
+
+		writer.Write( "vt " );
+		writer.WriteDouble( vertex.texCoords.x );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.texCoords.y );
+		writer.Write( '\n' );
+	}
+
+	for( int i = 0; i < ( signed )triangleMesh.vertexArray->size(); i++ )
+	{
+		const Vertex& vertex = ( *triangleMesh.vertexArray )[i];
+
+		writer.Write( "vn " );
+		writer.WriteDouble( vertex.normal.x );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.normal.y );
+		writer.Write( ' ' );
+		writer.WriteDouble( vertex.normal.z );
+		writer.Write( '\n' );
+	}
+
+	for( IndexTriangleList::const_iterator iter = triangleMesh.triangleList->cbegin(); iter != triangleMesh.triangleList->cend(); iter++ )
+	{
+		const IndexTriangle& triangle = *iter;
+
+		writer.Write( 'f' );
+
+		for( int i = 0; i < 3; i++ )
+		{
+			// OBJ indices are one-based.
+			int64_t index = triangle.vertex[i] + 1;
+
+			writer.Write( ' ' );
+			writer.WriteInteger( index );
+			writer.Write( '/' );
+			writer.WriteInteger( index );
+			writer.Write( '/' );
+			writer.WriteInteger( index );
+		}
+
+		writer.Write( '\n' );
+	}
+
+	writer.Flush();
+
+	return writer.Good();
 }
 
 int ObjFormat::FindFirstLine( const LineArray* lineArray, const std::string& lineType )
@@ -466,4 +705,718 @@ void ObjFormat::PopulateVector( const StringArray* stringArray, int startIndex,
 		component[ j++ ] = atof( ( *stringArray )[i].c_str() );
 }
 
+//---------------------------------------------------------------------
+//                             MeshCacheFormat
+//---------------------------------------------------------------------
+
+/*static*/ const char* MeshCacheFormat::extension = ".3dmesh";
+
+static const char meshCacheMagic[8] = { '3', 'D', 'M', 'M', 'E', 'S', 'H', '\0' };
+static const uint32_t meshCacheByteOrderMark = 0x01020304;
+
+// The payload is written, and read when its size can't be checked up front, this much at a time.
+#define MESH_CACHE_IO_CHUNK_SIZE		( 1 << 26 )
+
+// This is how many bytes are left in the stream, or -1 if the stream can't say, as for a pipe.
+static int64_t GetRemainingStreamSize( std::istream& stream )
+{
+	std::streampos position = stream.tellg();
+	if( position == std::streampos( -1 ) )
+	{
+		stream.clear();
+		return -1;
+	}
+
+	stream.seekg( 0, std::ios::end );
+	std::streampos end = stream.tellg();
+	stream.clear();
+	stream.seekg( position );
+
+	if( end == std::streampos( -1 ) || !stream )
+	{
+		stream.clear();
+		return -1;
+	}
+
+	return int64_t( end - position );
+}
+
+MeshCacheFormat::MeshCacheFormat( void )
+{
+}
+
+/*virtual*/ MeshCacheFormat::~MeshCacheFormat( void )
+{
+}
+
+/*static*/ FileFormat* MeshCacheFormat::Create( void )
+{
+	return new MeshCacheFormat();
+}
+
+/*static*/ bool MeshCacheFormat::Sniff( const char* header, int headerSize )
+{
+	return( headerSize >= ( signed )sizeof( meshCacheMagic ) && memcmp( header, meshCacheMagic, sizeof( meshCacheMagic ) ) == 0 );
+}
+
+/*static*/ uint64_t MeshCacheFormat::AlignSize( uint64_t size )
+{
+	return( size + SECTION_ALIGNMENT - 1 ) & ~uint64_t( SECTION_ALIGNMENT - 1 );
+}
+
+// This is a Fletcher-style checksum taken over 32-bit words, which is plenty to catch
+// truncated or stale cache files, and fast enough not to dominate the load time.
+/*static*/ uint64_t MeshCacheFormat::CalculateChecksum( const char* data, uint64_t size )
+{
+	uint64_t sumA = 0, sumB = 0;
+
+	uint64_t wordCount = size / 4;
+	for( uint64_t i = 0; i < wordCount; i++ )
+	{
+		uint32_t word;
+		memcpy( &word, &data[ i * 4 ], 4 );
+		sumA = ( sumA + word ) % 0xFFFFFFFF;
+		sumB = ( sumB + sumA ) % 0xFFFFFFFF;
+	}
+
+	for( uint64_t i = wordCount * 4; i < size; i++ )
+	{
+		sumA = ( sumA + uint8_t( data[i] ) ) % 0xFFFFFFFF;
+		sumB = ( sumB + sumA ) % 0xFFFFFFFF;
+	}
+
+	return( sumB << 32 ) | sumA;
+}
+
+/*static*/ void MeshCacheFormat::InitHeader( Header& header, const TriangleMesh& triangleMesh )
+{
+	memset( &header, 0, sizeof( Header ) );
+	memcpy( header.magic, meshCacheMagic, sizeof( header.magic ) );
+	header.version = VERSION;
+	header.headerSize = sizeof( Header );
+	header.byteOrderMark = meshCacheByteOrderMark;
+	header.sectionFlags = SECTION_POSITIONS | SECTION_NORMALS | SECTION_COLORS | SECTION_TEXCOORDS | SECTION_ALPHAS | SECTION_INDICES;
+	header.vertexCount = triangleMesh.vertexArray->size();
+	header.triangleCount = triangleMesh.triangleList->size();
+
+	uint64_t vectorSectionSize = AlignSize( header.vertexCount * 3 * sizeof( double ) );
+	uint64_t texCoordSectionSize = AlignSize( header.vertexCount * 2 * sizeof( double ) );
+	uint64_t alphaSectionSize = AlignSize( header.vertexCount * sizeof( double ) );
+	uint64_t indexSectionSize = AlignSize( header.triangleCount * 3 * sizeof( int32_t ) );
+
+	header.payloadSize = 3 * vectorSectionSize + texCoordSectionSize + alphaSectionSize + indexSectionSize;
+}
+
+/*virtual*/ bool MeshCacheFormat::SaveTriangleMesh( const TriangleMesh& triangleMesh, std::ostream& stream )
+{
+	Header header;
+	InitHeader( header, triangleMesh );
+
+	// We assemble the payload in memory first so that it can be check-summed before we write the header.
+	std::vector< char > payload( ( size_t )header.payloadSize, 0 );
+	char* section = payload.data();
+
+	const VertexArray& vertexArray = *triangleMesh.vertexArray;
+	int vertexCount = ( int )header.vertexCount;
+
+	const Vector Vertex::* vectorMembers[3] = { &Vertex::position, &Vertex::normal, &Vertex::color };
+	for( int j = 0; j < 3; j++ )
+	{
+		double* data = ( double* )section;
+		for( int i = 0; i < vertexCount; i++ )
+		{
+			const Vector& vector = vertexArray[i].*vectorMembers[j];
+			data[ 3 * i + 0 ] = vector.x;
+			data[ 3 * i + 1 ] = vector.y;
+			data[ 3 * i + 2 ] = vector.z;
+		}
+
+		section += AlignSize( header.vertexCount * 3 * sizeof( double ) );
+	}
+
+	double* texCoords = ( double* )section;
+	for( int i = 0; i < vertexCount; i++ )
+	{
+		texCoords[ 2 * i + 0 ] = vertexArray[i].texCoords.x;
+		texCoords[ 2 * i + 1 ] = vertexArray[i].texCoords.y;
+	}
+
+	section += AlignSize( header.vertexCount * 2 * sizeof( double ) );
+
+	double* alphas = ( double* )section;
+	for( int i = 0; i < vertexCount; i++ )
+		alphas[i] = vertexArray[i].alpha;
+
+	section += AlignSize( header.vertexCount * sizeof( double ) );
+
+	int32_t* indices = ( int32_t* )section;
+	for( IndexTriangleList::const_iterator iter = triangleMesh.triangleList->cbegin(); iter != triangleMesh.triangleList->cend(); iter++ )
+	{
+		const IndexTriangle& triangle = *iter;
+		*indices++ = triangle.vertex[0];
+		*indices++ = triangle.vertex[1];
+		*indices++ = triangle.vertex[2];
+	}
+
+	header.checksum = CalculateChecksum( payload.data(), header.payloadSize );
+
+	StreamWriter writer( stream );
+	writer.Write( ( const char* )&header, sizeof( Header ) );
+
+	// The writer counts in ints, and the payload of a big enough mesh is more than an int can count.
+	for( uint64_t offset = 0; offset < header.payloadSize; offset += MESH_CACHE_IO_CHUNK_SIZE )
+		writer.Write( payload.data() + offset, ( int )MIN( header.payloadSize - offset, uint64_t( MESH_CACHE_IO_CHUNK_SIZE ) ) );
+
+	writer.Flush();
+
+	return writer.Good();
+}
+
+/*virtual*/ bool MeshCacheFormat::LoadTriangleMesh( TriangleMesh& triangleMesh, std::istream& stream )
+{
+	bool success = true;
+
+	try
+	{
+		triangleMesh.Clear();
+
+		Header header;
+		if( !stream.read( ( char* )&header, sizeof( Header ) ) )
+			throw new Exception( "Failed to read mesh cache header." );
+
+		if( memcmp( header.magic, meshCacheMagic, sizeof( header.magic ) ) != 0 )
+			throw new Exception( "Not a mesh cache file." );
+
+		if( header.byteOrderMark != meshCacheByteOrderMark )
+			throw new Exception( "Mesh cache file was written with a different byte order." );
+
+		if( header.version != VERSION || header.headerSize != sizeof( Header ) )
+			throw new Exception( "Mesh cache version unrecognized." );
+
+		// The counts are checked before any size is figured from them, so that none of it can overflow.
+		if( header.vertexCount > uint64_t( INT_MAX ) || header.triangleCount > uint64_t( INT_MAX ) )
+			throw new Exception( "Mesh cache counts are out of range." );
+
+		uint64_t vectorSectionSize = AlignSize( header.vertexCount * 3 * sizeof( double ) );
+		uint64_t texCoordSectionSize = AlignSize( header.vertexCount * 2 * sizeof( double ) );
+		uint64_t alphaSectionSize = AlignSize( header.vertexCount * sizeof( double ) );
+		uint64_t indexSectionSize = AlignSize( header.triangleCount * 3 * sizeof( int32_t ) );
+		if( header.sectionFlags != ( SECTION_POSITIONS | SECTION_NORMALS | SECTION_COLORS | SECTION_TEXCOORDS | SECTION_ALPHAS | SECTION_INDICES ) || header.payloadSize != 3 * vectorSectionSize + texCoordSectionSize + alphaSectionSize + indexSectionSize )
+			throw new Exception( "Mesh cache sections are malformed." );
+
+		if( header.payloadSize > uint64_t( SIZE_MAX ) )
+			throw new Exception( "Mesh cache payload is too big to load." );
+
+		// A header claiming more than the file holds must fail here, not in allocating what it claims.
+		int64_t remainingSize = GetRemainingStreamSize( stream );
+		if( remainingSize >= 0 && header.payloadSize > uint64_t( remainingSize ) )
+			throw new Exception( "Mesh cache file is truncated." );
+
+		std::vector< char > payload;
+		if( remainingSize >= 0 )
+		{
+			// Pull the whole payload in with a single read; this is where all the time goes.
+			payload.resize( ( size_t )header.payloadSize );
+			if( !stream.read( payload.data(), header.payloadSize ) )
+				throw new Exception( "Mesh cache file is truncated." );
+		}
+		else
+		{
+			// Without a size to check against, the payload is only allowed to grow as the data arrives.
+			for( uint64_t offset = 0; offset < header.payloadSize; offset += MESH_CACHE_IO_CHUNK_SIZE )
+			{
+				uint64_t chunkSize = MIN( header.payloadSize - offset, uint64_t( MESH_CACHE_IO_CHUNK_SIZE ) );
+				payload.resize( ( size_t )( offset + chunkSize ) );
+				if( !stream.read( payload.data() + offset, chunkSize ) )
+					throw new Exception( "Mesh cache file is truncated." );
+			}
+		}
+
+		if( CalculateChecksum( payload.data(), header.payloadSize ) != header.checksum )
+			throw new Exception( "Mesh cache checksum mismatch." );
+
+		const char* section = payload.data();
+
+		int vertexCount = ( int )header.vertexCount;
+		VertexArray& vertexArray = *triangleMesh.vertexArray;
+		vertexArray.resize( vertexCount );
+
+		Vector Vertex::* vectorMembers[3] = { &Vertex::position, &Vertex::normal, &Vertex::color };
+		for( int j = 0; j < 3; j++ )
+		{
+			const double* data = ( const double* )section;
+			for( int i = 0; i < vertexCount; i++ )
+				( vertexArray[i].*vectorMembers[j] ).Set( data[ 3 * i + 0 ], data[ 3 * i + 1 ], data[ 3 * i + 2 ] );
+
+			section += vectorSectionSize;
+		}
+
+		const double* texCoords = ( const double* )section;
+		for( int i = 0; i < vertexCount; i++ )
+			vertexArray[i].texCoords.Set( texCoords[ 2 * i + 0 ], texCoords[ 2 * i + 1 ], 0.0 );
+
+		section += texCoordSectionSize;
+
+		const double* alphas = ( const double* )section;
+		for( int i = 0; i < vertexCount; i++ )
+			vertexArray[i].alpha = alphas[i];
+
+		section += alphaSectionSize;
+
+		const int32_t* indices = ( const int32_t* )section;
+		for( uint64_t i = 0; i < header.triangleCount; i++ )
+		{
+			IndexTriangle triangle( indices[0], indices[1], indices[2] );
+			indices += 3;
+
+			for( int j = 0; j < 3; j++ )
+				if( !IndexTriangle::BoundsCheck( triangle.vertex[j], &vertexArray ) )
+					throw new Exception( "Mesh cache triangle index out of range." );
+
+			triangleMesh.triangleList->push_back( triangle );
+		}
+	}
+	catch( Exception* exception )
+	{
+		exception->Handle();
+		delete exception;
+		success = false;
+		triangleMesh.Clear();
+	}
+
+	return success;
+}
+
+//---------------------------------------------------------------------
+//                            Double Formatting
+//---------------------------------------------------------------------
+
+// Doubles are turned into decimal digits with Loitsch's Grisu2, which works in 64-bit integer
+// arithmetic against a table of cached powers of ten.  Its digits always read back to the exact
+// same double and are nearly always the fewest that do; unlike trying successive precisions with
+// snprintf, it costs one pass and no parsing.
+
+// These are 10^k, for k = -348, -340, ..., 340, as normalized 64-bit significands and binary exponents.
+static const uint64_t cachedPowerSignificandArray[] =
+{
+	0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+	0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+	0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+	0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+	0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+	0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+	0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+	0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+	0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+	0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+	0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+	0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+	0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+	0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+	0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+	0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+	0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+	0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+	0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+	0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+	0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+	0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+	0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+	0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+	0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+	0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+	0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+	0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+	0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const int16_t cachedPowerExponentArray[] =
+{
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+	-901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+	-582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+	-263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+	56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+	694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+	1013, 1039, 1066
+};
+
+static const uint64_t powerOfTenArray[] =
+{
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+	10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+	1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// This is the value f * 2^e.
+struct DiyFloat
+{
+	uint64_t f;
+	int e;
+};
+
+static inline DiyFloat MakeDiyFloat( uint64_t f, int e )
+{
+	DiyFloat diyFloat;
+	diyFloat.f = f;
+	diyFloat.e = e;
+	return diyFloat;
+}
+
+// The product's significand is the rounded upper half of the 128-bit product.
+static inline DiyFloat Multiply( const DiyFloat& x, const DiyFloat& y )
+{
+	const uint64_t mask = 0xFFFFFFFFULL;
+
+	uint64_t a = x.f >> 32, b = x.f & mask;
+	uint64_t c = y.f >> 32, d = y.f & mask;
+
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t middle = ( bd >> 32 ) + ( ad & mask ) + ( bc & mask ) + ( 1ULL << 31 );
+
+	return MakeDiyFloat( ac + ( ad >> 32 ) + ( bc >> 32 ) + ( middle >> 32 ), x.e + y.e + 64 );
+}
+
+static inline DiyFloat Normalize( DiyFloat diyFloat )
+{
+	while( !( diyFloat.f & ( 1ULL << 63 ) ) )
+	{
+		diyFloat.f <<= 1;
+		diyFloat.e--;
+	}
+
+	return diyFloat;
+}
+
+static void GrisuRound( char* digits, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance )
+{
+	while( rest < distance && delta - rest >= tenKappa && ( rest + tenKappa < distance || distance - rest > rest + tenKappa - distance ) )
+	{
+		digits[ length - 1 ]--;
+		rest += tenKappa;
+	}
+}
+
+// Generate the digits of the scaled value up to the scaled upper boundary, stopping as soon as
+// what's left is within delta, the width of the rounding interval.
+static void GrisuGenerateDigits( const DiyFloat& scaled, const DiyFloat& upper, uint64_t delta, char* digits, int& length, int& exponent )
+{
+	int shift = -upper.e;
+	uint64_t one = 1ULL << shift;
+	uint64_t distance = upper.f - scaled.f;
+
+	uint32_t integral = uint32_t( upper.f >> shift );
+	uint64_t fraction = upper.f & ( one - 1 );
+
+	int kappa = 1;
+	while( kappa < 10 && integral >= powerOfTenArray[ kappa ] )
+		kappa++;
+
+	length = 0;
+
+	while( kappa > 0 )
+	{
+		uint32_t divisor = uint32_t( powerOfTenArray[ kappa - 1 ] );
+		uint32_t digit = integral / divisor;
+		integral %= divisor;
+
+		if( digit != 0 || length != 0 )
+			digits[ length++ ] = char( '0' + digit );
+
+		kappa--;
+
+		uint64_t rest = ( uint64_t( integral ) << shift ) + fraction;
+		if( rest <= delta )
+		{
+			exponent += kappa;
+			GrisuRound( digits, length, delta, rest, powerOfTenArray[ kappa ] << shift, distance );
+			return;
+		}
+	}
+
+	for(;;)
+	{
+		fraction *= 10;
+		delta *= 10;
+
+		char digit = char( fraction >> shift );
+		if( digit != 0 || length != 0 )
+			digits[ length++ ] = char( '0' + digit );
+
+		fraction &= one - 1;
+		kappa--;
+
+		if( fraction < delta )
+		{
+			exponent += kappa;
+			GrisuRound( digits, length, delta, fraction, one, distance * powerOfTenArray[ -kappa ] );
+			return;
+		}
+	}
+}
+
+// The value must be positive and finite.  Its digits are returned such that value = digits * 10^exponent.
+static void Grisu2( double value, char* digits, int& length, int& exponent )
+{
+	const uint64_t hiddenBit = 1ULL << 52;
+
+	uint64_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+
+	int biasedExponent = int( ( bits >> 52 ) & 0x7FF );
+	uint64_t significand = bits & ( hiddenBit - 1 );
+
+	DiyFloat v;
+	if( biasedExponent != 0 )
+		v = MakeDiyFloat( significand + hiddenBit, biasedExponent - 1075 );
+	else
+		v = MakeDiyFloat( significand, -1074 );
+
+	// The boundaries are halfway to the neighboring doubles.  The lower one is closer when the
+	// significand is a power of two, since the exponent drops below it.
+	DiyFloat upper = MakeDiyFloat( ( v.f << 1 ) + 1, v.e - 1 );
+	while( !( upper.f & ( hiddenBit << 1 ) ) )
+	{
+		upper.f <<= 1;
+		upper.e--;
+	}
+	upper.f <<= 10;
+	upper.e -= 10;
+
+	DiyFloat lower;
+	if( v.f == hiddenBit )
+		lower = MakeDiyFloat( ( v.f << 2 ) - 1, v.e - 2 );
+	else
+		lower = MakeDiyFloat( ( v.f << 1 ) - 1, v.e - 1 );
+	lower.f <<= lower.e - upper.e;
+	lower.e = upper.e;
+
+	// Pick the cached power that brings the upper boundary's exponent into [-60,-32].
+	double k = ( -61 - upper.e ) * 0.30102999566398114 + 347;
+	int cachedK = int( k );
+	if( k - cachedK > 0.0 )
+		cachedK++;
+
+	int index = ( cachedK >> 3 ) + 1;
+	exponent = -( -348 + index * 8 );
+
+	DiyFloat cachedPower = MakeDiyFloat( cachedPowerSignificandArray[ index ], cachedPowerExponentArray[ index ] );
+
+	DiyFloat scaled = Multiply( Normalize( v ), cachedPower );
+	DiyFloat scaledUpper = Multiply( upper, cachedPower );
+	DiyFloat scaledLower = Multiply( lower, cachedPower );
+
+	// Shrink the interval by one unit at each end to allow for the rounding of the products.
+	scaledUpper.f--;
+	scaledLower.f++;
+
+	GrisuGenerateDigits( scaled, scaledUpper, scaledUpper.f - scaledLower.f, digits, length, exponent );
+}
+
+// Lay out digits * 10^exponent much as %g would, with no trailing zeros after a decimal point.
+static int FormatDigits( const char* digits, int length, int exponent, char* buffer )
+{
+	// The value lies in [10^(point-1),10^point).
+	int point = length + exponent;
+	int size = 0;
+
+	if( length <= point && point <= 17 )
+	{
+		memcpy( buffer, digits, length );
+		size = length;
+		while( size < point )
+			buffer[ size++ ] = '0';
+	}
+	else if( 0 < point && point <= 17 )
+	{
+		memcpy( buffer, digits, point );
+		buffer[ point ] = '.';
+		memcpy( &buffer[ point + 1 ], &digits[ point ], length - point );
+		size = length + 1;
+	}
+	else if( -4 < point && point <= 0 )
+	{
+		buffer[ size++ ] = '0';
+		buffer[ size++ ] = '.';
+		for( int i = point; i < 0; i++ )
+			buffer[ size++ ] = '0';
+		memcpy( &buffer[ size ], digits, length );
+		size += length;
+	}
+	else
+	{
+		buffer[ size++ ] = digits[0];
+		if( length > 1 )
+		{
+			buffer[ size++ ] = '.';
+			memcpy( &buffer[ size ], &digits[1], length - 1 );
+			size += length - 1;
+		}
+
+		int power = point - 1;
+		buffer[ size++ ] = 'e';
+		if( power < 0 )
+		{
+			buffer[ size++ ] = '-';
+			power = -power;
+		}
+
+		if( power >= 100 )
+			buffer[ size++ ] = char( '0' + power / 100 );
+		if( power >= 10 )
+			buffer[ size++ ] = char( '0' + ( power / 10 ) % 10 );
+		buffer[ size++ ] = char( '0' + power % 10 );
+	}
+
+	return size;
+}
+
+//---------------------------------------------------------------------
+//                              StreamWriter
+//---------------------------------------------------------------------
+
+StreamWriter::StreamWriter( std::ostream& stream, int bufferSize /*= 1 << 16*/ )
+{
+	this->stream = &stream;
+	this->bufferSize = ( bufferSize < 64 ) ? 64 : bufferSize;
+	buffer = new char[ this->bufferSize ];
+	bufferLength = 0;
+}
+
+/*virtual*/ StreamWriter::~StreamWriter( void )
+{
+	Flush();
+
+	delete[] buffer;
+}
+
+void StreamWriter::Reserve( int length )
+{
+	if( bufferLength + length > bufferSize )
+		Flush();
+}
+
+void StreamWriter::Flush( void )
+{
+	if( bufferLength > 0 )
+	{
+		stream->write( buffer, bufferLength );
+		bufferLength = 0;
+	}
+}
+
+bool StreamWriter::Good( void ) const
+{
+	return stream->good();
+}
+
+void StreamWriter::Write( const char* string )
+{
+	Write( string, ( int )strlen( string ) );
+}
+
+void StreamWriter::Write( const std::string& string )
+{
+	Write( string.c_str(), ( int )string.length() );
+}
+
+void StreamWriter::Write( const char* data, int length )
+{
+	if( length > bufferSize )
+	{
+		// Large blocks bypass our buffer entirely.
+		Flush();
+		stream->write( data, length );
+		return;
+	}
+
+	Reserve( length );
+	memcpy( &buffer[ bufferLength ], data, length );
+	bufferLength += length;
+}
+
+void StreamWriter::Write( char ch )
+{
+	Reserve(1);
+	buffer[ bufferLength++ ] = ch;
+}
+
+void StreamWriter::WriteInteger( int64_t integer )
+{
+	Reserve(24);
+
+	uint64_t magnitude = ( integer < 0 ) ? ( ~uint64_t( integer ) + 1 ) : uint64_t( integer );
+
+	if( integer < 0 )
+		buffer[ bufferLength++ ] = '-';
+
+	char digits[24];
+	int count = 0;
+	do
+	{
+		digits[ count++ ] = char( '0' + magnitude % 10 );
+		magnitude /= 10;
+	}
+	while( magnitude != 0 );
+
+	while( count > 0 )
+		buffer[ bufferLength++ ] = digits[ --count ];
+}
+
+void StreamWriter::WriteDouble( double value )
+{
+	Reserve(32);
+	bufferLength += FormatDouble( value, &buffer[ bufferLength ], 32 );
+}
+
+/*static*/ int StreamWriter::FormatDouble( double value, char* buffer, int bufferSize )
+{
+	// Whole numbers (very common for colors, texture coordinates and axis-aligned normals)
+	// don't need any floating-point formatting at all.
+	if( fabs( value ) < 1e15 && value == double( int64_t( value ) ) && !( value == 0.0 && signbit( value ) ) )
+	{
+		int64_t integer = int64_t( value );
+		uint64_t magnitude = ( integer < 0 ) ? uint64_t( -integer ) : uint64_t( integer );
+
+		char digits[24];
+		int count = 0;
+		do
+		{
+			digits[ count++ ] = char( '0' + magnitude % 10 );
+			magnitude /= 10;
+		}
+		while( magnitude != 0 );
+
+		int length = 0;
+		if( integer < 0 )
+			buffer[ length++ ] = '-';
+		while( count > 0 )
+			buffer[ length++ ] = digits[ --count ];
+		return length;
+	}
+
+	if( !isfinite( value ) )
+		return snprintf( buffer, bufferSize, "%g", value );
+
+	int length = 0;
+	if( signbit( value ) )
+	{
+		buffer[ length++ ] = '-';
+		value = -value;
+	}
+
+	if( value == 0.0 )
+	{
+		buffer[ length++ ] = '0';
+		return length;
+	}
+
+	char digits[20];
+	int digitCount = 0, exponent = 0;
+	Grisu2( value, digits, digitCount, exponent );
+
+	return length + FormatDigits( digits, digitCount, exponent, &buffer[ length ] );
+}
+
 // FileFormat.cpp
\ No newline at end of file
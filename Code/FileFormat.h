@@ -9,6 +9,8 @@ namespace _3DMath
     class FileFormat;
     class PlyFormat;
 	class ObjFormat;
+	class MeshCacheFormat;
+	class StreamWriter;
     class TriangleMesh;
 	class Vector;
 }
@@ -26,10 +28,33 @@ public:
     virtual bool LoadTriangleMesh( TriangleMesh& triangleMesh, const std::string& file );
     virtual bool SaveTriangleMesh( const TriangleMesh& triangleMesh, const std::string& file );
 
-	static FileFormat* CreateForFile( const std::string& file );
+	// Formats are chosen by file extension, ignoring case.  When loading, pass sniffContents so that the
+	// first few bytes of the file are checked first; a save must not, or it would keep whatever format
+	// an old file at the same path happened to have.
+	static FileFormat* CreateForFile( const std::string& file, bool sniffContents = false );
+	static FileFormat* CreateForHeader( const std::string& file, const char* header, int headerSize );
+
+	enum { SNIFF_SIZE = 64 };
+
+	typedef FileFormat* ( *CreateFunction )( void );
+	typedef bool ( *SniffFunction )( const char* header, int headerSize );
+
+	// The sniff function may be null for formats that have no recognizable signature.
+	static void RegisterFormat( const std::string& extension, SniffFunction sniffFunction, CreateFunction createFunction );
 
 protected:
 
+	struct Registration
+	{
+		std::string extension;
+		SniffFunction sniffFunction;
+		CreateFunction createFunction;
+	};
+
+	typedef std::vector< Registration > RegistrationArray;
+
+	static RegistrationArray& GetRegistrationArray( void );
+
 	typedef std::vector< std::string > StringArray;
     typedef std::vector< StringArray* > LineArray;
 
@@ -46,6 +71,9 @@ public:
     virtual bool LoadTriangleMesh( TriangleMesh& triangleMesh, std::istream& stream ) override;
     virtual bool SaveTriangleMesh( const TriangleMesh& triangleMesh, std::ostream& stream ) override;
 
+	static FileFormat* Create( void );
+	static bool Sniff( const char* header, int headerSize );
+
 private:
 
     void AddVertex( TriangleMesh& triangleMesh, const LineArray::iterator& headerIter, const LineArray::iterator& bodyIter );
@@ -62,6 +90,9 @@ public:
     virtual bool LoadTriangleMesh( TriangleMesh& triangleMesh, std::istream& stream ) override;
     virtual bool SaveTriangleMesh( const TriangleMesh& triangleMesh, std::ostream& stream ) override;
 
+	static FileFormat* Create( void );
+	static bool Sniff( const char* header, int headerSize );
+
 private:
 
 	int FindFirstLine( const LineArray* lineArray, const std::string& lineType );
@@ -69,4 +100,92 @@ private:
 	void PopulateVector( const StringArray* stringArray, int startIndex, Vector& vector );
 };
 
+// This is our own binary format.  It is meant as a cache for meshes that would otherwise be
+// re-parsed from text over and over again, and is not meant for interchange with other tools.
+// Each vertex attribute is stored as its own 32-byte aligned section of raw doubles, followed by
+// the triangle indices, so loading is little more than one block read and a few tight loops.
+class _3DMATH_API _3DMath::MeshCacheFormat : public _3DMath::FileFormat
+{
+public:
+
+	MeshCacheFormat( void );
+	virtual ~MeshCacheFormat( void );
+
+	virtual bool LoadTriangleMesh( TriangleMesh& triangleMesh, std::istream& stream ) override;
+	virtual bool SaveTriangleMesh( const TriangleMesh& triangleMesh, std::ostream& stream ) override;
+
+	enum
+	{
+		VERSION = 1,
+		SECTION_ALIGNMENT = 32,
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint32_t byteOrderMark;
+		uint32_t sectionFlags;
+		uint64_t vertexCount;
+		uint64_t triangleCount;
+		uint64_t payloadSize;
+		uint64_t checksum;
+		uint64_t reserved;
+	};
+
+	enum SectionFlag
+	{
+		SECTION_POSITIONS		= 0x0001,
+		SECTION_NORMALS			= 0x0002,
+		SECTION_COLORS			= 0x0004,
+		SECTION_TEXCOORDS		= 0x0008,
+		SECTION_ALPHAS			= 0x0010,
+		SECTION_INDICES			= 0x0020,
+	};
+
+	static const char* extension;
+
+	static FileFormat* Create( void );
+	static bool Sniff( const char* header, int headerSize );
+
+	static uint64_t CalculateChecksum( const char* data, uint64_t size );
+
+private:
+
+	static uint64_t AlignSize( uint64_t size );
+	static void InitHeader( Header& header, const TriangleMesh& triangleMesh );
+};
+
+class _3DMATH_API _3DMath::StreamWriter
+{
+public:
+
+	StreamWriter( std::ostream& stream, int bufferSize = 1 << 16 );
+	virtual ~StreamWriter( void );
+
+	void Write( const char* string );
+	void Write( const char* data, int length );
+	void Write( const std::string& string );
+	void Write( char ch );
+	void WriteInteger( int64_t integer );
+	void WriteDouble( double value );
+	void Flush( void );
+
+	bool Good( void ) const;
+
+	// Format the given value with digits that always parse back to the exact same double, which are
+	// the fewest possible for all but a rare few values.  At most 25 characters are written.
+	static int FormatDouble( double value, char* buffer, int bufferSize );
+
+private:
+
+	void Reserve( int length );
+
+	std::ostream* stream;
+	char* buffer;
+	int bufferSize;
+	int bufferLength;
+};
+
 // FileFormat.h
\ No newline at end of file
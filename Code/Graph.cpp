@@ -34,7 +34,7 @@ GraphNode* GraphNode::GetAdjacency( const std::string& name )
 	AdjacencyMap::iterator iter = adjacencyMap.find( name );
 	if( iter != adjacencyMap.end() )
 	{
-		int graphNodeHandle = iter->second;
+		ObjectHandle graphNodeHandle = iter->second;
 		adjacentNode = ( GraphNode* )HandleObject::Dereference( graphNodeHandle );
 	}
 
@@ -48,7 +48,7 @@ void GraphNode::SetAdjacency( const std::string& name, GraphNode* graphNode )
 		adjacencyMap.erase( iter );
 
 	if( graphNode )
-		adjacencyMap.insert( std::pair< std::string, int >( name, graphNode->GetHandle() ) );
+		adjacencyMap.insert( std::pair< std::string, ObjectHandle >( name, graphNode->GetHandle() ) );
 }
 
 //------------------------------------------------------------------------------------
@@ -84,7 +84,7 @@ void GraphTraversor::Reset( GraphNode* graphNode, Mode mode /*= BREADTH_FIRST*/
 		return false;
 
 	ObjectHandleList::iterator iter = handleQueue.begin();
-	int graphNodeHandle = *iter;
+	ObjectHandle graphNodeHandle = *iter;
 	handleQueue.erase( iter );
 
 	visitationSet.insert( graphNodeHandle );
@@ -103,7 +103,7 @@ void GraphTraversor::Reset( GraphNode* graphNode, Mode mode /*= BREADTH_FIRST*/
 			EnqueueIfNotVisitedOrEnqueued( iter->second );
 }
 
-void GraphTraversor::EnqueueIfNotVisitedOrEnqueued( int graphNodeHandle )
+void GraphTraversor::EnqueueIfNotVisitedOrEnqueued( ObjectHandle graphNodeHandle )
 {
 	HandleSet::iterator iter = visitationSet.find( graphNodeHandle );
 	if( iter != visitationSet.end() )
@@ -27,7 +27,7 @@ public:
 	GraphNode* GetAdjacency( const std::string& name );
 	void SetAdjacency( const std::string& name, GraphNode* graphNode );
 
-	typedef std::map< std::string, int > AdjacencyMap;
+	typedef std::map< std::string, ObjectHandle > AdjacencyMap;
 	AdjacencyMap adjacencyMap;
 };
 
@@ -73,12 +73,12 @@ public:
 	virtual bool Traverse( GraphNode*& graphNode );
 	virtual void EnqueueUnvisitedAdjacencies( GraphNode* graphNode );
 
-	void EnqueueIfNotVisitedOrEnqueued( int graphNodeHandle );
+	void EnqueueIfNotVisitedOrEnqueued( ObjectHandle graphNodeHandle );
 
 	Mode mode;
 	ObjectHandleList handleQueue;
 	
-	typedef std::set< int > HandleSet;
+	typedef std::set< ObjectHandle > HandleSet;
 	HandleSet visitationSet, enqueuedSet;
 };
 
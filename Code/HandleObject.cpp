@@ -1,46 +1,166 @@
 // HandleObject.cpp
 
 #include "HandleObject.h"
+#include <atomic>
 
-namespace _3DMath
+using namespace _3DMath;
+
+#define SLOT_CHUNK_SHIFT		14
+#define SLOT_CHUNK_SIZE			( 1 << SLOT_CHUNK_SHIFT )
+#define MAX_SLOT_CHUNKS			( 1 << 14 )
+
+//---------------------------------------------------------------------
+//                             Slot Table
+//---------------------------------------------------------------------
+
+struct HandleSlot
 {
-	int HandleObject::newHandle = 1;
-	static HandleObjectMap handleObjectMapStorage;
-	HandleObjectMap* HandleObject::handleObjectMap = &handleObjectMapStorage;
+	std::atomic< HandleObject* > object;
+	std::atomic< uint32_t > generation;
+	std::atomic< uint32_t > nextFreeSlot;		// One more than the next slot of the free list, or zero at its end.
+};
+
+// These have static storage and no constructors to run, so they're ready before any other static
+// object might make a handle object, and still there after any might destroy one.  The chunks are
+// never freed, which is what lets a reader look at a slot without a lock.
+static std::atomic< HandleSlot* > slotChunkArray[ MAX_SLOT_CHUNKS ];
+static std::atomic< uint32_t > slotCount( 0 );
+
+// The low 32 bits are one more than the first free slot, or zero if there is none; the high 32 bits
+// count changes to the list, so that a pop can't succeed against a head that was popped and pushed
+// back while it looked at it.
+static std::atomic< uint64_t > freeSlotHead( 0 );
+
+static inline HandleSlot* GetSlot( uint32_t index )
+{
+	if( ( index >> SLOT_CHUNK_SHIFT ) >= MAX_SLOT_CHUNKS )
+		return nullptr;
+
+	HandleSlot* chunk = slotChunkArray[ index >> SLOT_CHUNK_SHIFT ].load( std::memory_order_acquire );
+	if( !chunk )
+		return nullptr;
+
+	return &chunk[ index & ( SLOT_CHUNK_SIZE - 1 ) ];
 }
 
-using namespace _3DMath;
+// Threads racing to make the same chunk each make one, and all but one throw theirs away.
+static HandleSlot* MakeSlot( uint32_t index )
+{
+	std::atomic< HandleSlot* >& chunkPointer = slotChunkArray[ index >> SLOT_CHUNK_SHIFT ];
 
-HandleObject::HandleObject( void )
+	HandleSlot* chunk = chunkPointer.load( std::memory_order_acquire );
+	if( !chunk )
+	{
+		HandleSlot* newChunk = new HandleSlot[ SLOT_CHUNK_SIZE ];
+		for( int i = 0; i < SLOT_CHUNK_SIZE; i++ )
+		{
+			newChunk[i].object.store( nullptr, std::memory_order_relaxed );
+			newChunk[i].generation.store( 1, std::memory_order_relaxed );
+			newChunk[i].nextFreeSlot.store( 0, std::memory_order_relaxed );
+		}
+
+		if( chunkPointer.compare_exchange_strong( chunk, newChunk, std::memory_order_acq_rel, std::memory_order_acquire ) )
+			chunk = newChunk;
+		else
+			delete[] newChunk;
+	}
+
+	return &chunk[ index & ( SLOT_CHUNK_SIZE - 1 ) ];
+}
+
+static ObjectHandle AllocateSlot( HandleObject* object )
 {
-	handle = newHandle++;
-	if( handleObjectMap )
-		handleObjectMap->insert( std::pair< int, HandleObject* >( handle, this ) );
+	HandleSlot* slot = nullptr;
+	uint32_t index = 0;
+
+	uint64_t head = freeSlotHead.load( std::memory_order_acquire );
+	while( uint32_t( head ) != 0 )
+	{
+		index = uint32_t( head ) - 1;
+		slot = GetSlot( index );
+
+		uint64_t newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) | slot->nextFreeSlot.load( std::memory_order_relaxed );
+		if( freeSlotHead.compare_exchange_weak( head, newHead, std::memory_order_acq_rel, std::memory_order_acquire ) )
+			break;
+
+		slot = nullptr;
+	}
+
+	if( !slot )
+	{
+		index = slotCount.fetch_add( 1, std::memory_order_relaxed );
+		if( ( index >> SLOT_CHUNK_SHIFT ) >= MAX_SLOT_CHUNKS )
+			return 0;
+
+		slot = MakeSlot( index );
+	}
+
+	slot->object.store( object );
+	return ( ObjectHandle( slot->generation.load( std::memory_order_relaxed ) ) << 32 ) | index;
 }
 
-/*virtual*/ HandleObject::~HandleObject( void )
+// The generation is changed before the object is cleared, so that a reader that finds the object
+// and then the handle's generation knows the object was alive in between.
+static void FreeSlot( ObjectHandle handle )
 {
-	if( handleObjectMap )
+	uint32_t index = uint32_t( handle );
+	HandleSlot* slot = GetSlot( index );
+	if( !slot )
+		return;
+
+	uint32_t generation = slot->generation.load( std::memory_order_relaxed ) + 1;
+	slot->generation.store( generation ? generation : 1 );
+	slot->object.store( nullptr );
+
+	uint64_t head = freeSlotHead.load( std::memory_order_relaxed );
+	uint64_t newHead;
+	do
 	{
-		HandleObjectMap::iterator iter = handleObjectMap->find( handle );
-		if( iter != handleObjectMap->end() )		// This should always happen.
-			handleObjectMap->erase( iter );
+		slot->nextFreeSlot.store( uint32_t( head ), std::memory_order_relaxed );
+		newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) | ( index + 1 );
 	}
+	while( !freeSlotHead.compare_exchange_weak( head, newHead, std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+//---------------------------------------------------------------------
+//                             HandleObject
+//---------------------------------------------------------------------
+
+HandleObject::HandleObject( void )
+{
+	handle = AllocateSlot( this );
+}
+
+HandleObject::HandleObject( const HandleObject& handleObject )
+{
+	handle = AllocateSlot( this );
+}
+
+/*virtual*/ HandleObject::~HandleObject( void )
+{
+	if( handle )
+		FreeSlot( handle );
+}
+
+HandleObject& HandleObject::operator=( const HandleObject& handleObject )
+{
+	return *this;
 }
 
 // Of course, we can't gurantee that the returned pointer can't somehow become
 // stale before the caller is finished using it.  A better handle system might
 // be built on top of a reference counting scheme.
-/*static*/ HandleObject* HandleObject::Dereference( int handle )
+/*static*/ HandleObject* HandleObject::Dereference( ObjectHandle handle )
 {
-	if( handleObjectMap )
-	{
-		HandleObjectMap::iterator iter = handleObjectMap->find( handle );
-		if( iter != handleObjectMap->end() )
-			return iter->second;
-	}
+	HandleSlot* slot = GetSlot( uint32_t( handle ) );
+	if( !slot )
+		return nullptr;
 
-	return nullptr;
+	HandleObject* object = slot->object.load();
+	if( slot->generation.load() != uint32_t( handle >> 32 ) )
+		return nullptr;
+
+	return object;
 }
 
 /*virtual*/ void HandleObject::Render( Renderer& renderer ) const
@@ -52,4 +172,4 @@ HandleObject::HandleObject( void )
 	return nullptr;
 }
 
-// HandleObject.cpp
\ No newline at end of file
+// HandleObject.cpp
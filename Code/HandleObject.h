@@ -9,30 +9,37 @@ namespace _3DMath
 	class HandleObject;
 	class Renderer;
 
-	typedef std::map< int, HandleObject* > HandleObjectMap;
-	typedef std::list< int > ObjectHandleList;
+	// The low 32 bits are a slot and the high 32 bits that slot's generation, which changes each time
+	// the slot's object is destroyed, so that a stale handle never finds the slot's next object.
+	// Zero is never a handle.
+	typedef uint64_t ObjectHandle;
+
+	typedef std::list< ObjectHandle > ObjectHandleList;
 }
 
+// Every handle object has a slot in a global table that only grows, in chunks that never move, so
+// that a handle is dereferenced in constant time, and without a lock; objects may be made and
+// destroyed on any thread, and the slots of destroyed objects are reused.
 class _3DMATH_API _3DMath::HandleObject
 {
 public:
 
 	HandleObject( void );
+	HandleObject( const HandleObject& handleObject );		// A copy gets a handle of its own.
 	virtual ~HandleObject( void );
 
+	HandleObject& operator=( const HandleObject& handleObject );
+
 	virtual void Render( Renderer& renderer ) const;
 	virtual HandleObject* Clone( void ) const;
 
-	int GetHandle( void ) const { return handle; }
+	ObjectHandle GetHandle( void ) const { return handle; }
 
-	static HandleObject* Dereference( int handle );
+	static HandleObject* Dereference( ObjectHandle handle );
 
 private:
 
-	int handle;
-
-	static int newHandle;
-	static HandleObjectMap* handleObjectMap;
+	ObjectHandle handle;
 };
 
 // HandleObject.h
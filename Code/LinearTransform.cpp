@@ -1,9 +1,174 @@
 // LinearTransform.cpp
 
 #include "LinearTransform.h"
+#include "Quaternion.h"
 
 using namespace _3DMath;
 
+//---------------------------------------------------------------------
+//                       Singular value decomposition
+//---------------------------------------------------------------------
+
+// Matrices here are indexed [row][column], so the columns are the axes.
+typedef double Matrix3[3][3];
+
+static void GetMatrix( const LinearTransform& linearTransform, Matrix3 m )
+{
+	const Vector* axis[3] = { &linearTransform.xAxis, &linearTransform.yAxis, &linearTransform.zAxis };
+	for( int j = 0; j < 3; j++ )
+	{
+		m[0][j] = axis[j]->x;
+		m[1][j] = axis[j]->y;
+		m[2][j] = axis[j]->z;
+	}
+}
+
+static void SetMatrix( const Matrix3 m, LinearTransform& linearTransform )
+{
+	linearTransform.xAxis.Set( m[0][0], m[1][0], m[2][0] );
+	linearTransform.yAxis.Set( m[0][1], m[1][1], m[2][1] );
+	linearTransform.zAxis.Set( m[0][2], m[1][2], m[2][2] );
+}
+
+// Diagonalize the symmetric matrix s in place by cyclic Jacobi rotations, accumulating them in v,
+// so that on exit, s_in = v diag(s) v^T.  Convergence is quadratic, so a handful of sweeps suffice.
+static void JacobiEigenDecomposition( Matrix3 s, Matrix3 v )
+{
+	static const int pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+	static const int maxSweeps = 8;
+
+	for( int i = 0; i < 3; i++ )
+		for( int j = 0; j < 3; j++ )
+			v[i][j] = ( i == j ) ? 1.0 : 0.0;
+
+	for( int sweep = 0; sweep < maxSweeps; sweep++ )
+	{
+		double offDiagonal = s[0][1] * s[0][1] + s[0][2] * s[0][2] + s[1][2] * s[1][2];
+		double diagonal = s[0][0] * s[0][0] + s[1][1] * s[1][1] + s[2][2] * s[2][2];
+		if( offDiagonal <= 1e-32 * diagonal )
+			break;
+
+		for( int k = 0; k < 3; k++ )
+		{
+			int p = pairs[k][0];
+			int q = pairs[k][1];
+			if( s[p][q] == 0.0 )
+				continue;
+
+			// Choose the smaller rotation angle that zeroes s[p][q].
+			double theta = ( s[q][q] - s[p][p] ) / ( 2.0 * s[p][q] );
+			double t = ( ( theta < 0.0 ) ? -1.0 : 1.0 ) / ( fabs( theta ) + sqrt( theta * theta + 1.0 ) );
+			double c = 1.0 / sqrt( t * t + 1.0 );
+			double sn = t * c;
+
+			int r = 3 - p - q;
+			double srp = s[r][p];
+			double srq = s[r][q];
+			s[r][p] = s[p][r] = c * srp - sn * srq;
+			s[r][q] = s[q][r] = sn * srp + c * srq;
+
+			s[p][p] -= t * s[p][q];
+			s[q][q] += t * s[p][q];
+			s[p][q] = s[q][p] = 0.0;
+
+			for( int i = 0; i < 3; i++ )
+			{
+				double vip = v[i][p];
+				double viq = v[i][q];
+				v[i][p] = c * vip - sn * viq;
+				v[i][q] = sn * vip + c * viq;
+			}
+		}
+	}
+}
+
+static void SwapColumns( Matrix3 m, int a, int b )
+{
+	for( int i = 0; i < 3; i++ )
+	{
+		double temp = m[i][a];
+		m[i][a] = m[i][b];
+		m[i][b] = -temp;		// Negating one column keeps the determinant positive.
+	}
+}
+
+// Apply the Givens rotation in the (p,q) plane that zeroes b[q][col], to the rows of both b and ut.
+static void GivensRotateRows( Matrix3 b, Matrix3 ut, int p, int q, int col )
+{
+	double x = b[p][col];
+	double y = b[q][col];
+	double r = sqrt( x * x + y * y );
+	if( r == 0.0 )
+		return;
+
+	double c = x / r;
+	double s = y / r;
+
+	for( int j = 0; j < 3; j++ )
+	{
+		double bp = b[p][j], bq = b[q][j];
+		b[p][j] = c * bp + s * bq;
+		b[q][j] = c * bq - s * bp;
+
+		double up = ut[p][j], uq = ut[q][j];
+		ut[p][j] = c * up + s * uq;
+		ut[q][j] = c * uq - s * up;
+	}
+}
+
+// V comes from the eigenvectors of m^T m, found by cyclic Jacobi rotations, and U from a Givens QR
+// factorization of m V.  Unlike forming U = m V S^{-1}, this stays orthonormal even when m is
+// singular or nearly so.
+static void SingularValueDecomposition( const Matrix3 m, Matrix3 u, double sigma[3], Matrix3 v )
+{
+	Matrix3 s;
+	for( int i = 0; i < 3; i++ )
+		for( int j = 0; j < 3; j++ )
+			s[i][j] = m[0][i] * m[0][j] + m[1][i] * m[1][j] + m[2][i] * m[2][j];
+
+	JacobiEigenDecomposition( s, v );
+
+	double lambda[3] = { s[0][0], s[1][1], s[2][2] };
+	for( int i = 0; i < 2; i++ )
+	{
+		for( int j = 2; j > i; j-- )
+		{
+			if( lambda[j] > lambda[j - 1] )
+			{
+				double temp = lambda[j];
+				lambda[j] = lambda[j - 1];
+				lambda[j - 1] = temp;
+				SwapColumns( v, j, j - 1 );
+			}
+		}
+	}
+
+	Matrix3 b, ut;
+	for( int i = 0; i < 3; i++ )
+	{
+		for( int j = 0; j < 3; j++ )
+		{
+			b[i][j] = m[i][0] * v[0][j] + m[i][1] * v[1][j] + m[i][2] * v[2][j];
+			ut[i][j] = ( i == j ) ? 1.0 : 0.0;
+		}
+	}
+
+	GivensRotateRows( b, ut, 0, 1, 0 );
+	GivensRotateRows( b, ut, 0, 2, 0 );
+	GivensRotateRows( b, ut, 1, 2, 1 );
+
+	for( int i = 0; i < 3; i++ )
+	{
+		sigma[i] = b[i][i];
+		for( int j = 0; j < 3; j++ )
+			u[i][j] = ut[j][i];
+	}
+}
+
+//---------------------------------------------------------------------
+//                             LinearTransform
+//---------------------------------------------------------------------
+
 LinearTransform::LinearTransform( void )
 {
 	Identity();
@@ -162,13 +327,11 @@ void LinearTransform::Concatinate( const LinearTransform& linearTransformA, cons
 	linearTransformB.Transform( linearTransformA.zAxis, zAxis );
 }
 
+// Going through a quaternion costs one sine and one cosine rather than three of each.
 void LinearTransform::SetRotation( const Vector& unitAxis, double angle )
 {
-	Identity();
-
-	xAxis.Rotate( unitAxis, angle );
-	yAxis.Rotate( unitAxis, angle );
-	zAxis.Rotate( unitAxis, angle );
+	Quaternion quaternion( unitAxis, angle );
+	quaternion.GetLinearTransform( *this );
 }
 
 void LinearTransform::Multiply( const Vector& vectorA, const Vector& vectorB )
@@ -180,8 +343,17 @@ void LinearTransform::Multiply( const Vector& vectorA, const Vector& vectorB )
 
 bool LinearTransform::GetRotation( Vector& unitAxis, double& angle ) const
 {
-	// The rotation axis is an Eigen vector.
-	return false;
+	// Only a proper rotation has a rotation axis and angle.
+	if( fabs( xAxis.Length() - 1.0 ) > EPSILON || fabs( yAxis.Length() - 1.0 ) > EPSILON || fabs( zAxis.Length() - 1.0 ) > EPSILON )
+		return false;
+	if( !xAxis.IsOrthogonalTo( yAxis ) || !yAxis.IsOrthogonalTo( zAxis ) || !zAxis.IsOrthogonalTo( xAxis ) )
+		return false;
+	if( Determinant() < 0.0 )
+		return false;
+
+	Quaternion quaternion;
+	quaternion.SetFromLinearTransform( *this );
+	return quaternion.GetRotation( unitAxis, angle );
 }
 
 void LinearTransform::SetScale( double scale )
@@ -191,29 +363,108 @@ void LinearTransform::SetScale( double scale )
 	zAxis.Set( 0.0, 0.0, scale );
 }
 
-// TODO: We may want to provide an argument that lets the caller specify which of the 3 axes to use as anchor.
 bool LinearTransform::Orthogonalize( void )
 {
 	if( Determinant() == 0.0 )
 		return false;
 
-	yAxis.RejectFrom( xAxis );
-	zAxis.RejectFrom( xAxis );
-	zAxis.RejectFrom( yAxis );
+	LinearTransform stretch;
+	GetPolarDecomposition( *this, stretch );
+	return true;
+}
 
-	xAxis.Normalize();
-	yAxis.Normalize();
-	zAxis.Normalize();
+/*static*/ bool LinearTransform::Orthogonalize( LinearTransform* linearTransformArray, int arraySize )
+{
+	bool success = true;
+	for( int i = 0; i < arraySize; i++ )
+		if( !linearTransformArray[i].Orthogonalize() )
+			success = false;
 
-	return true;
+	return success;
 }
 
+// With M = Q P the polar decomposition, P is positive definite for an invertible M, so its diagonal
+// is never zero, and it factors as K D with K = P D^{-1}.  If Q is a reflection, then with F = diag(1,1,-1),
+// M = ( Q F ) ( F K F ) ( F D ), where Q F is proper and F K F still has a unit diagonal.
 bool LinearTransform::Decompose( LinearTransform& scale, LinearTransform& shear, LinearTransform& rotation )
 {
 	// This exists if and only if we have a linearly independent set.
-	// As I recall, we can get the shear matrix using the Grahm-Schmidt process.
-	// Still other decompositions may be more useful.
-	return false;
+	if( Determinant() == 0.0 )
+		return false;
+
+	LinearTransform orthogonal, stretch;
+	GetPolarDecomposition( orthogonal, stretch );
+
+	Matrix3 q, p;
+	GetMatrix( orthogonal, q );
+	GetMatrix( stretch, p );
+
+	// Only underflow could leave a zero here.
+	for( int j = 0; j < 3; j++ )
+		if( p[j][j] == 0.0 )
+			return false;
+
+	double f[3] = { 1.0, 1.0, ( orthogonal.Determinant() < 0.0 ) ? -1.0 : 1.0 };
+
+	Matrix3 k, d, r;
+	for( int i = 0; i < 3; i++ )
+	{
+		for( int j = 0; j < 3; j++ )
+		{
+			k[i][j] = f[i] * f[j] * p[i][j] / p[j][j];
+			d[i][j] = ( i == j ) ? f[i] * p[i][i] : 0.0;
+			r[i][j] = q[i][j] * f[j];
+		}
+	}
+
+	SetMatrix( d, scale );
+	SetMatrix( k, shear );
+	SetMatrix( r, rotation );
+	return true;
+}
+
+void LinearTransform::GetSingularValueDecomposition( LinearTransform& rotationU, Vector& singularValues, LinearTransform& rotationV ) const
+{
+	Matrix3 m, u, v;
+	double sigma[3];
+	GetMatrix( *this, m );
+	SingularValueDecomposition( m, u, sigma, v );
+
+	SetMatrix( u, rotationU );
+	singularValues.Set( sigma[0], sigma[1], sigma[2] );
+	SetMatrix( v, rotationV );
+}
+
+// With M = U S V^T, the factors are Q = U D V^T and P = V D S V^T, where D flips the sign of
+// the last singular value if it's negative.
+void LinearTransform::GetPolarDecomposition( LinearTransform& orthogonal, LinearTransform& stretch ) const
+{
+	Matrix3 m, u, v, q, p;
+	double sigma[3];
+	GetMatrix( *this, m );
+	SingularValueDecomposition( m, u, sigma, v );
+
+	double flip = ( sigma[2] < 0.0 ) ? -1.0 : 1.0;
+	double d[3] = { 1.0, 1.0, flip };
+	double absSigma[3] = { sigma[0], sigma[1], sigma[2] * flip };
+
+	for( int i = 0; i < 3; i++ )
+	{
+		for( int j = 0; j < 3; j++ )
+		{
+			q[i][j] = u[i][0] * v[j][0] + u[i][1] * v[j][1] + u[i][2] * d[2] * v[j][2];
+			p[i][j] = v[i][0] * absSigma[0] * v[j][0] + v[i][1] * absSigma[1] * v[j][1] + v[i][2] * absSigma[2] * v[j][2];
+		}
+	}
+
+	SetMatrix( q, orthogonal );
+	SetMatrix( p, stretch );
+}
+
+/*static*/ void LinearTransform::GetPolarDecomposition( const LinearTransform* linearTransformArray, LinearTransform* orthogonalArray, LinearTransform* stretchArray, int arraySize )
+{
+	for( int i = 0; i < arraySize; i++ )
+		linearTransformArray[i].GetPolarDecomposition( orthogonalArray[i], stretchArray[i] );
 }
 
 bool LinearTransform::GetNormalTransform( LinearTransform& normalTransform ) const
@@ -53,9 +53,26 @@ public:
 
 	void Multiply( const Vector& vectorA, const Vector& vectorB );
 
+	// This replaces the transform with the nearest orthogonal one, which is the orthogonal factor of its
+	// polar decomposition.  Handedness is preserved.  False is returned for a singular transform.
 	bool Orthogonalize( void );
+	static bool Orthogonalize( LinearTransform* linearTransformArray, int arraySize );
+
+	// This transform is scale, then shear, then rotation, concatinated.  The scale is diagonal, the shear
+	// has a unit diagonal, and the rotation is proper.  Shear times scale is the symmetric stretch of the
+	// polar decomposition, so the shear itself is only symmetric under a uniform scale.  A reflection
+	// shows up as a negative z scale, with the shear's z row and column negated to match.  False is
+	// returned only for a singular transform.
 	bool Decompose( LinearTransform& scale, LinearTransform& shear, LinearTransform& rotation );
 
+	// This transform is rotationV transposed, then scale by the singular values, then rotationU.  Both
+	// rotations are proper, the values are sorted by decreasing magnitude, and only the last can be negative.
+	void GetSingularValueDecomposition( LinearTransform& rotationU, Vector& singularValues, LinearTransform& rotationV ) const;
+
+	// This transform is stretch, then orthogonal, where stretch is symmetric positive semi-definite.
+	void GetPolarDecomposition( LinearTransform& orthogonal, LinearTransform& stretch ) const;
+	static void GetPolarDecomposition( const LinearTransform* linearTransformArray, LinearTransform* orthogonalArray, LinearTransform* stretchArray, int arraySize );
+
 	bool GetNormalTransform( LinearTransform& normalTransform ) const;
 
 	bool BuildFrameUsingVector( const Vector& vector );
@@ -0,0 +1,214 @@
+// Mat.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vec.h"
+#include "LinearTransform.h"
+#include "AffineTransform.h"
+#include "Matrix4x4.h"
+
+// Mat is the fixed-size matrix companion to Vec.  Elements are stored row-major, and vectors
+// are treated as columns, so that M * v agrees with Matrix4x4::MultiplyRight and with
+// LinearTransform::Transform (whose axes become the columns of the matrix.)
+
+namespace _3DMath
+{
+	template< typename Type, int Rows, int Cols >
+	struct Mat
+	{
+		constexpr Type operator()( int row, int col ) const & { return e[ row * Cols + col ]; }
+		Type& operator()( int row, int col ) & { return e[ row * Cols + col ]; }
+
+		constexpr Vec< Type, Cols > Row( int row ) const { return RowImpl( row, typename MakeIndexSequence< Cols >::Type() ); }
+		constexpr Vec< Type, Rows > Col( int col ) const { return ColImpl( col, typename MakeIndexSequence< Rows >::Type() ); }
+
+		template< int... I >
+		constexpr Vec< Type, Cols > RowImpl( int row, IndexSequence< I... > ) const { return Vec< Type, Cols >{ { e[ row * Cols + I ]... } }; }
+
+		template< int... I >
+		constexpr Vec< Type, Rows > ColImpl( int col, IndexSequence< I... > ) const { return Vec< Type, Rows >{ { e[ I * Cols + col ]... } }; }
+
+		Type e[ Rows * Cols ];
+	};
+
+	typedef Mat< float, 3, 3 > Mat3f;
+	typedef Mat< float, 4, 4 > Mat4f;
+	typedef Mat< double, 3, 3 > Mat3d;
+	typedef Mat< double, 4, 4 > Mat4d;
+
+	namespace MatDetail
+	{
+		template< typename Type, int Rows, int Cols, int... I >
+		constexpr Mat< Type, Rows, Cols > Identity( IndexSequence< I... > )
+		{
+			return Mat< Type, Rows, Cols >{ { ( ( I / Cols == I % Cols ) ? Type(1) : Type(0) )... } };
+		}
+
+		template< typename Type, int Rows, int Cols, int... I >
+		constexpr Mat< Type, Cols, Rows > Transpose( const Mat< Type, Rows, Cols >& mat, IndexSequence< I... > )
+		{
+			return Mat< Type, Cols, Rows >{ { mat.e[ ( I % Rows ) * Cols + I / Rows ]... } };
+		}
+
+		template< typename Type, int Rows, int Cols, int... I >
+		constexpr Mat< Type, Rows, Cols > Add( const Mat< Type, Rows, Cols >& matA, const Mat< Type, Rows, Cols >& matB, IndexSequence< I... > )
+		{
+			return Mat< Type, Rows, Cols >{ { ( matA.e[I] + matB.e[I] )... } };
+		}
+
+		template< typename Type, int Rows, int Cols, int... I >
+		constexpr Mat< Type, Rows, Cols > Scale( const Mat< Type, Rows, Cols >& mat, Type scale, IndexSequence< I... > )
+		{
+			return Mat< Type, Rows, Cols >{ { ( mat.e[I] * scale )... } };
+		}
+
+		template< typename Type, int Rows, int Inner, int Cols >
+		constexpr Type ProductElement( const Mat< Type, Rows, Inner >& matA, const Mat< Type, Inner, Cols >& matB, int row, int col, int k )
+		{
+			return( k == Inner ) ? Type(0) : ( matA.e[ row * Inner + k ] * matB.e[ k * Cols + col ] + ProductElement( matA, matB, row, col, k + 1 ) );
+		}
+
+		template< typename Type, int Rows, int Inner, int Cols, int... I >
+		constexpr Mat< Type, Rows, Cols > Multiply( const Mat< Type, Rows, Inner >& matA, const Mat< Type, Inner, Cols >& matB, IndexSequence< I... > )
+		{
+			return Mat< Type, Rows, Cols >{ { ProductElement( matA, matB, I / Cols, I % Cols, 0 )... } };
+		}
+
+		template< typename Type, int Rows, int Cols, int... I >
+		constexpr Vec< Type, Rows > Multiply( const Mat< Type, Rows, Cols >& mat, const Vec< Type, Cols >& vec, IndexSequence< I... > )
+		{
+			return Vec< Type, Rows >{ { Dot( mat.Row(I), vec )... } };
+		}
+
+		template< typename ToType, typename FromType, int Rows, int Cols, int... I >
+		constexpr Mat< ToType, Rows, Cols > Cast( const Mat< FromType, Rows, Cols >& mat, IndexSequence< I... > )
+		{
+			return Mat< ToType, Rows, Cols >{ { ToType( mat.e[I] )... } };
+		}
+	}
+
+	template< typename Type, int Size >
+	constexpr Mat< Type, Size, Size > MatIdentity( void )
+	{
+		return MatDetail::Identity< Type, Size, Size >( typename MakeIndexSequence< Size * Size >::Type() );
+	}
+
+	template< typename ToType, typename FromType, int Rows, int Cols >
+	constexpr Mat< ToType, Rows, Cols > MatCast( const Mat< FromType, Rows, Cols >& mat )
+	{
+		return MatDetail::Cast< ToType >( mat, typename MakeIndexSequence< Rows * Cols >::Type() );
+	}
+
+	template< typename Type, int Rows, int Cols >
+	constexpr Mat< Type, Cols, Rows > Transpose( const Mat< Type, Rows, Cols >& mat )
+	{
+		return MatDetail::Transpose( mat, typename MakeIndexSequence< Rows * Cols >::Type() );
+	}
+
+	template< typename Type, int Rows, int Cols >
+	constexpr Mat< Type, Rows, Cols > operator+( const Mat< Type, Rows, Cols >& matA, const Mat< Type, Rows, Cols >& matB )
+	{
+		return MatDetail::Add( matA, matB, typename MakeIndexSequence< Rows * Cols >::Type() );
+	}
+
+	template< typename Type, int Rows, int Cols >
+	constexpr Mat< Type, Rows, Cols > operator*( const Mat< Type, Rows, Cols >& mat, Type scale )
+	{
+		return MatDetail::Scale( mat, scale, typename MakeIndexSequence< Rows * Cols >::Type() );
+	}
+
+	template< typename Type, int Rows, int Inner, int Cols >
+	constexpr Mat< Type, Rows, Cols > operator*( const Mat< Type, Rows, Inner >& matA, const Mat< Type, Inner, Cols >& matB )
+	{
+		return MatDetail::Multiply( matA, matB, typename MakeIndexSequence< Rows * Cols >::Type() );
+	}
+
+	template< typename Type, int Rows, int Cols >
+	constexpr Vec< Type, Rows > operator*( const Mat< Type, Rows, Cols >& mat, const Vec< Type, Cols >& vec )
+	{
+		return MatDetail::Multiply( mat, vec, typename MakeIndexSequence< Rows >::Type() );
+	}
+
+	template< typename Type >
+	constexpr Type Determinant( const Mat< Type, 3, 3 >& mat )
+	{
+		return Dot( mat.Col(0), Cross( mat.Col(1), mat.Col(2) ) );
+	}
+
+	// Transform a point by an affine 4x4 matrix, ignoring the projective row.
+	template< typename Type >
+	constexpr Vec< Type, 3 > TransformPoint( const Mat< Type, 4, 4 >& mat, const Vec< Type, 3 >& point )
+	{
+		return Vec< Type, 3 >{ {
+			mat.e[0] * point.c[0] + mat.e[1] * point.c[1] + mat.e[2] * point.c[2] + mat.e[3],
+			mat.e[4] * point.c[0] + mat.e[5] * point.c[1] + mat.e[6] * point.c[2] + mat.e[7],
+			mat.e[8] * point.c[0] + mat.e[9] * point.c[1] + mat.e[10] * point.c[2] + mat.e[11] } };
+	}
+
+	template< typename Type >
+	inline Mat< Type, 3, 3 > ToMat( const LinearTransform& linearTransform )
+	{
+		const Vector& x = linearTransform.xAxis;
+		const Vector& y = linearTransform.yAxis;
+		const Vector& z = linearTransform.zAxis;
+
+		return Mat< Type, 3, 3 >{ {
+			Type( x.x ), Type( y.x ), Type( z.x ),
+			Type( x.y ), Type( y.y ), Type( z.y ),
+			Type( x.z ), Type( y.z ), Type( z.z ) } };
+	}
+
+	template< typename Type >
+	inline Mat< Type, 4, 4 > ToMat( const AffineTransform& affineTransform )
+	{
+		const Vector& x = affineTransform.linearTransform.xAxis;
+		const Vector& y = affineTransform.linearTransform.yAxis;
+		const Vector& z = affineTransform.linearTransform.zAxis;
+		const Vector& t = affineTransform.translation;
+
+		return Mat< Type, 4, 4 >{ {
+			Type( x.x ), Type( y.x ), Type( z.x ), Type( t.x ),
+			Type( x.y ), Type( y.y ), Type( z.y ), Type( t.y ),
+			Type( x.z ), Type( y.z ), Type( z.z ), Type( t.z ),
+			Type(0), Type(0), Type(0), Type(1) } };
+	}
+
+	template< typename Type >
+	inline Mat< Type, 4, 4 > ToMat( const Matrix4x4& matrix )
+	{
+		Mat< Type, 4, 4 > mat;
+		for( int i = 0; i < 4; i++ )
+			for( int j = 0; j < 4; j++ )
+				mat.e[ i * 4 + j ] = Type( matrix.elements[i][j] );
+		return mat;
+	}
+
+	template< typename Type >
+	inline void FromMat( const Mat< Type, 3, 3 >& mat, LinearTransform& linearTransform )
+	{
+		linearTransform.xAxis.Set( mat.e[0], mat.e[3], mat.e[6] );
+		linearTransform.yAxis.Set( mat.e[1], mat.e[4], mat.e[7] );
+		linearTransform.zAxis.Set( mat.e[2], mat.e[5], mat.e[8] );
+	}
+
+	// The bottom row is assumed to be ( 0, 0, 0, 1 ) and is ignored.
+	template< typename Type >
+	inline void FromMat( const Mat< Type, 4, 4 >& mat, AffineTransform& affineTransform )
+	{
+		affineTransform.linearTransform.xAxis.Set( mat.e[0], mat.e[4], mat.e[8] );
+		affineTransform.linearTransform.yAxis.Set( mat.e[1], mat.e[5], mat.e[9] );
+		affineTransform.linearTransform.zAxis.Set( mat.e[2], mat.e[6], mat.e[10] );
+		affineTransform.translation.Set( mat.e[3], mat.e[7], mat.e[11] );
+	}
+
+	template< typename Type >
+	inline void FromMat( const Mat< Type, 4, 4 >& mat, Matrix4x4& matrix )
+	{
+		for( int i = 0; i < 4; i++ )
+			for( int j = 0; j < 4; j++ )
+				matrix.elements[i][j] = double( mat.e[ i * 4 + j ] );
+	}
+}
+
+// Mat.h
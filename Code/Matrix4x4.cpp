@@ -2,15 +2,100 @@
 
 #include "Matrix4x4.h"
 #include "Vector.h"
+#include "BatchTransform.h"
+#include "Simd.h"
 
 using namespace _3DMath;
 
+//---------------------------------------------------------------------
+//                                Kernels
+//---------------------------------------------------------------------
+
+typedef double MatrixElements[4][4];
+
+static void MultiplyScalar( const MatrixElements& left, const MatrixElements& right, MatrixElements& product )
+{
+	for( int i = 0; i < 4; i++ )
+		for( int j = 0; j < 4; j++ )
+			product[i][j] = left[i][0] * right[0][j] + left[i][1] * right[1][j] + left[i][2] * right[2][j] + left[i][3] * right[3][j];
+}
+
+#if defined _3DMATH_X86
+
+// Each row of the product is a combination of the rows of the right matrix, weighted by a row of the left.
+_3DMATH_TARGET_SSE2 static void MultiplySSE2( const MatrixElements& left, const MatrixElements& right, MatrixElements& product )
+{
+	__m128d rightLo[4], rightHi[4];
+	for( int k = 0; k < 4; k++ )
+	{
+		rightLo[k] = _mm_loadu_pd( &right[k][0] );
+		rightHi[k] = _mm_loadu_pd( &right[k][2] );
+	}
+
+	for( int i = 0; i < 4; i++ )
+	{
+		__m128d weight = _mm_set1_pd( left[i][0] );
+		__m128d rowLo = _mm_mul_pd( weight, rightLo[0] );
+		__m128d rowHi = _mm_mul_pd( weight, rightHi[0] );
+
+		for( int k = 1; k < 4; k++ )
+		{
+			weight = _mm_set1_pd( left[i][k] );
+			rowLo = _mm_add_pd( rowLo, _mm_mul_pd( weight, rightLo[k] ) );
+			rowHi = _mm_add_pd( rowHi, _mm_mul_pd( weight, rightHi[k] ) );
+		}
+
+		_mm_storeu_pd( &product[i][0], rowLo );
+		_mm_storeu_pd( &product[i][2], rowHi );
+	}
+}
+
+// This multiplies and adds separately rather than fusing them, so that it rounds just as the other kernels do.
+_3DMATH_TARGET_AVX2_NOFMA static void MultiplyAVX2( const MatrixElements& left, const MatrixElements& right, MatrixElements& product )
+{
+	__m256d rightRow[4];
+	for( int k = 0; k < 4; k++ )
+		rightRow[k] = _mm256_loadu_pd( right[k] );
+
+	for( int i = 0; i < 4; i++ )
+	{
+		__m256d row = _mm256_mul_pd( _mm256_broadcast_sd( &left[i][0] ), rightRow[0] );
+		row = _mm256_add_pd( row, _mm256_mul_pd( _mm256_broadcast_sd( &left[i][1] ), rightRow[1] ) );
+		row = _mm256_add_pd( row, _mm256_mul_pd( _mm256_broadcast_sd( &left[i][2] ), rightRow[2] ) );
+		row = _mm256_add_pd( row, _mm256_mul_pd( _mm256_broadcast_sd( &left[i][3] ), rightRow[3] ) );
+		_mm256_storeu_pd( product[i], row );
+	}
+}
+
+#endif //_3DMATH_X86
+
+typedef void ( *MultiplyFunction )( const MatrixElements& left, const MatrixElements& right, MatrixElements& product );
+
+static MultiplyFunction GetMultiplyFunction( void )
+{
+	switch( BatchTransform::GetSupportedInstructions() )
+	{
+#if defined _3DMATH_X86
+		case BatchTransform::INSTRUCTIONS_AVX2:
+			return MultiplyAVX2;
+		case BatchTransform::INSTRUCTIONS_SSE2:
+			return MultiplySSE2;
+#endif
+		default:
+			return MultiplyScalar;
+	}
+}
+
+//---------------------------------------------------------------------
+//                                Matrix4x4
+//---------------------------------------------------------------------
+
 Matrix4x4::Matrix4x4( void )
 {
 	SetIdentity();
 }
 
-/*virtual*/ Matrix4x4::~Matrix4x4( void )
+Matrix4x4::~Matrix4x4( void )
 {
 }
 
@@ -53,9 +138,26 @@ void Matrix4x4::GetCol( int col, Vector& vector, double& w ) const
 	w = elements[3][col];
 }
 
+// This is the Laplace expansion along the top two rows, in terms of 2x2 minors of the top and bottom halves.
 double Matrix4x4::Determinant( void ) const
 {
-	return 0.0; // TODO: Write this.
+	const MatrixElements& a = elements;
+
+	double s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+	double s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+	double s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+	double s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+	double s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+	double s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+	double c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+	double c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+	double c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+	double c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+	double c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+	double c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
 }
 
 void Matrix4x4::GetCopy( Matrix4x4& copy ) const
@@ -82,14 +184,124 @@ void Matrix4x4::SetTranspose( const Matrix4x4& transpose )
 			elements[i][j] = transpose.elements[j][i];
 }
 
-void Matrix4x4::GetInverse( Matrix4x4& inverse ) const
+bool Matrix4x4::GetInverse( Matrix4x4& inverse ) const
 {
-	inverse.SetInverse( *this );
+	return inverse.SetInverse( *this );
 }
 
-void Matrix4x4::SetInverse( const Matrix4x4& inverse )
+// The inverse is the transposed matrix of cofactors over the determinant, with the cofactors
+// built from the same 2x2 minors as the determinant.
+bool Matrix4x4::SetInverse( const Matrix4x4& inverse )
 {
-	// TODO: Write this.
+	if( inverse.IsAffine() )
+		return SetAffineInverse( inverse );
+
+	const MatrixElements& a = inverse.elements;
+
+	double s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+	double s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+	double s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+	double s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+	double s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+	double s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+	double c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+	double c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+	double c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+	double c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+	double c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+	double c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+	double det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if( det == 0.0 )
+		return false;
+
+	double scale = 1.0 / det;
+
+	MatrixElements b;
+
+	b[0][0] = ( a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3 ) * scale;
+	b[0][1] = ( -a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3 ) * scale;
+	b[0][2] = ( a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3 ) * scale;
+	b[0][3] = ( -a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3 ) * scale;
+
+	b[1][0] = ( -a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1 ) * scale;
+	b[1][1] = ( a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1 ) * scale;
+	b[1][2] = ( -a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1 ) * scale;
+	b[1][3] = ( a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1 ) * scale;
+
+	b[2][0] = ( a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0 ) * scale;
+	b[2][1] = ( -a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0 ) * scale;
+	b[2][2] = ( a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0 ) * scale;
+	b[2][3] = ( -a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0 ) * scale;
+
+	b[3][0] = ( -a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0 ) * scale;
+	b[3][1] = ( a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0 ) * scale;
+	b[3][2] = ( -a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0 ) * scale;
+	b[3][3] = ( a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0 ) * scale;
+
+	for( int i = 0; i < 4; i++ )
+		for( int j = 0; j < 4; j++ )
+			elements[i][j] = b[i][j];
+
+	return true;
+}
+
+bool Matrix4x4::GetAffineInverse( Matrix4x4& inverse ) const
+{
+	return inverse.SetAffineInverse( *this );
+}
+
+// Only the upper-left 3x3 block needs a real inverse; the translation column is then just -L^{-1}t.
+bool Matrix4x4::SetAffineInverse( const Matrix4x4& inverse )
+{
+	if( !inverse.IsAffine() )
+		return false;
+
+	const MatrixElements& a = inverse.elements;
+
+	// These are the cofactors of the 3x3 block, which form the rows of its adjugate.
+	double b00 = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+	double b01 = a[0][2] * a[2][1] - a[0][1] * a[2][2];
+	double b02 = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+	double b10 = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+	double b11 = a[0][0] * a[2][2] - a[0][2] * a[2][0];
+	double b12 = a[0][2] * a[1][0] - a[0][0] * a[1][2];
+	double b20 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+	double b21 = a[0][1] * a[2][0] - a[0][0] * a[2][1];
+	double b22 = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+
+	double det = a[0][0] * b00 + a[0][1] * b10 + a[0][2] * b20;
+	if( det == 0.0 )
+		return false;
+
+	double scale = 1.0 / det;
+	double tx = a[0][3], ty = a[1][3], tz = a[2][3];
+
+	elements[0][0] = b00 * scale;
+	elements[0][1] = b01 * scale;
+	elements[0][2] = b02 * scale;
+	elements[1][0] = b10 * scale;
+	elements[1][1] = b11 * scale;
+	elements[1][2] = b12 * scale;
+	elements[2][0] = b20 * scale;
+	elements[2][1] = b21 * scale;
+	elements[2][2] = b22 * scale;
+
+	for( int i = 0; i < 3; i++ )
+		elements[i][3] = -( elements[i][0] * tx + elements[i][1] * ty + elements[i][2] * tz );
+
+	elements[3][0] = 0.0;
+	elements[3][1] = 0.0;
+	elements[3][2] = 0.0;
+	elements[3][3] = 1.0;
+
+	return true;
+}
+
+bool Matrix4x4::IsAffine( void ) const
+{
+	return elements[3][0] == 0.0 && elements[3][1] == 0.0 && elements[3][2] == 0.0 && elements[3][3] == 1.0;
 }
 
 void Matrix4x4::Add( const Matrix4x4& leftMatrix, const Matrix4x4& rightMatrix )
@@ -108,7 +320,15 @@ void Matrix4x4::Add( const Matrix4x4& matrix )
 
 void Matrix4x4::Multiply( const Matrix4x4& leftMatrix, const Matrix4x4& rightMatrix )
 {
-	// TODO: Write this.
+	static const MultiplyFunction multiplyFunction = GetMultiplyFunction();
+
+	// Go through a temporary in case we're one of the operands.
+	MatrixElements product;
+	multiplyFunction( leftMatrix.elements, rightMatrix.elements, product );
+
+	for( int i = 0; i < 4; i++ )
+		for( int j = 0; j < 4; j++ )
+			elements[i][j] = product[i][j];
 }
 
 void Matrix4x4::MultiplyRight( const Matrix4x4& rightMatrix )
@@ -134,42 +354,66 @@ void Matrix4x4::MultiplyRight( const Vector& vector_a, double w_a, Vector& vecto
 	w_b = elements[3][0] * vector_a.x + elements[3][1] * vector_a.y + elements[3][2] * vector_a.z + elements[3][3] * w_a;
 }
 
+/*static*/ void Matrix4x4::MultiplyMany( const Matrix4x4& leftMatrix, const Matrix4x4* rightMatrixArray, Matrix4x4* productArray, int arraySize )
+{
+	// A copy of the left matrix keeps this right if it's also in the product array.
+	Matrix4x4 left;
+	left.SetCopy( leftMatrix );
+
+	for( int i = 0; i < arraySize; i++ )
+		productArray[i].Multiply( left, rightMatrixArray[i] );
+}
+
 bool Matrix4x4::SolveLinearSystem( Vector& vector_a, double& w_a, const Vector& vector_b, double w_b ) const
 {
-	// Solve the equation Ma = b for a given M and b.
-	// We might just calculate a = M^{-1}b, but this doesn't work if b is zero.
+	// Solve the equation Ma = b for a given M and b by Gaussian elimination on the augmented
+	// matrix [M|b], choosing the largest available pivot in each column for stability.
 
-	Matrix4x4 reduce;
-	reduce.SetCopy( *this );
+	double reduce[4][5];
+	for( int i = 0; i < 4; i++ )
+		for( int j = 0; j < 4; j++ )
+			reduce[i][j] = elements[i][j];
 
-	// Here we reduce M into upper-triangular form.  Notice that we don't try to find the most numerically stable solution.
-	
-	for( int q = 0; q < 3; q++ )
+	reduce[0][4] = vector_b.x;
+	reduce[1][4] = vector_b.y;
+	reduce[2][4] = vector_b.z;
+	reduce[3][4] = w_b;
+
+	for( int q = 0; q < 4; q++ )
 	{
+		int pivot = q;
+		for( int i = q + 1; i < 4; i++ )
+			if( fabs( reduce[i][q] ) > fabs( reduce[pivot][q] ) )
+				pivot = i;
+
+		if( reduce[pivot][q] == 0.0 )
+			return false; // Singular matrix.
+
+		if( pivot != q )
+			for( int j = q; j < 5; j++ )
+				std::swap( reduce[q][j], reduce[pivot][j] );
+
 		for( int i = q + 1; i < 4; i++ )
 		{
-			double scale = -reduce.elements[i][q] / reduce.elements[q][q];
-			for( int j = 0; j < 4; j++ )
-				reduce.elements[i][j] += reduce.elements[q][j] * scale;
+			double scale = -reduce[i][q] / reduce[q][q];
+			for( int j = q; j < 5; j++ )
+				reduce[i][j] += reduce[q][j] * scale;
 		}
 	}
 
-	for( int i = 0; i < 4; i++ )
-	{
-		if( reduce.elements[i][i] == 0.0 )
-			return false; // Singular matrix.
+	// We can now solve by back-substitution.
 
-		double scale = 1.0 / reduce.elements[i][i];
-		for( int j = i; j < 4; j++ )
-			reduce.elements[i][j] *= scale;
+	double a[4];
+	for( int i = 3; i >= 0; i-- )
+	{
+		double sum = reduce[i][4];
+		for( int j = i + 1; j < 4; j++ )
+			sum -= reduce[i][j] * a[j];
+		a[i] = sum / reduce[i][i];
 	}
 
-	// We can now solve by substitution.
-
-	w_a = w_b;
-	vector_a.z = vector_b.z - reduce.elements[2][3] * w_a;
-	vector_a.y = vector_b.y - reduce.elements[1][2] * vector_a.z + reduce.elements[1][3] * w_a;
-	vector_a.x = vector_b.x - reduce.elements[0][1] * vector_a.y + reduce.elements[0][2] * vector_a.z + reduce.elements[0][3] * w_a;
+	vector_a.Set( a[0], a[1], a[2] );
+	w_a = a[3];
 
 	return true;
 }
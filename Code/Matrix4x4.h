@@ -10,11 +10,14 @@ namespace _3DMath
 	class Matrix4x4;
 }
 
+// This is deliberately non-virtual, so that an array of matrices is just packed elements that can be
+// streamed through the vectorized kernels.  The kernels use unaligned loads and stores, so no alignment
+// beyond that of a double is asked for; neither new nor std::vector would honor it before C++17 anyway.
 class _3DMATH_API _3DMath::Matrix4x4
 {
 public:
 	Matrix4x4( void );
-	virtual ~Matrix4x4( void );
+	~Matrix4x4( void );
 
 	void SetRow( int row, const Vector& vector, double w );
 	void SetCol( int col, const Vector& vector, double w );
@@ -31,8 +34,15 @@ public:
 	void GetTranspose( Matrix4x4& tranpose ) const;
 	void SetTranspose( const Matrix4x4& transpose );
 
-	void GetInverse( Matrix4x4& inverse ) const;
-	void SetInverse( const Matrix4x4& inverse );
+	// These return false if the matrix is singular.  Affine matrices are detected and take the cheaper path.
+	bool GetInverse( Matrix4x4& inverse ) const;
+	bool SetInverse( const Matrix4x4& inverse );
+
+	// These return false if the matrix is singular or its bottom row isn't ( 0, 0, 0, 1 ).
+	bool GetAffineInverse( Matrix4x4& inverse ) const;
+	bool SetAffineInverse( const Matrix4x4& inverse );
+
+	bool IsAffine( void ) const;
 
 	void Add( const Matrix4x4& leftMatrix, const Matrix4x4& rightMatrix );
 	void Add( const Matrix4x4& matrix );
@@ -42,6 +52,9 @@ public:
 	void MultiplyLeft( const Matrix4x4& leftMatrix );
 	void MultiplyRight( const Vector& vector_a, double w, Vector& vector_b, double& w_b ) const;
 
+	// Calculate productArray[i] = leftMatrix * rightMatrixArray[i] for each i, e.g., to put a batch of instances into view space.
+	static void MultiplyMany( const Matrix4x4& leftMatrix, const Matrix4x4* rightMatrixArray, Matrix4x4* productArray, int arraySize );
+
 	bool SolveLinearSystem( Vector& vector_a, double& w_a, const Vector& vector_b, double w_b ) const;
 
 	double elements[4][4];
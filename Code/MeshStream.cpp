@@ -0,0 +1,1364 @@
+// MeshStream.cpp
+
+#include "MeshStream.h"
+#include "FileFormat.h"
+#include "Triangle.h"
+#include "AffineTransform.h"
+#include "Exception.h"
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+
+using namespace _3DMath;
+
+//---------------------------------------------------------------------
+//                             MeshStreamChunk
+//---------------------------------------------------------------------
+
+MeshStreamChunk::MeshStreamChunk( void )
+{
+	vertexBase = 0;
+}
+
+MeshStreamChunk::~MeshStreamChunk( void )
+{
+}
+
+void MeshStreamChunk::Clear( void )
+{
+	vertexArray.clear();
+	triangleArray.clear();
+}
+
+int MeshStreamChunk::Size( void ) const
+{
+	return( int )( vertexArray.size() + triangleArray.size() );
+}
+
+//---------------------------------------------------------------------
+//                             MeshStreamReader
+//---------------------------------------------------------------------
+
+MeshStreamReader::MeshStreamReader( void )
+{
+	chunkSize = 1 << 16;
+	vertexCount = -1;
+	triangleCount = -1;
+	stream = nullptr;
+	fileStream = nullptr;
+	failed = false;
+}
+
+/*virtual*/ MeshStreamReader::~MeshStreamReader( void )
+{
+	Close();
+}
+
+bool MeshStreamReader::Open( const std::string& file )
+{
+	Close();
+
+	fileStream = new std::ifstream();
+	fileStream->open( file, std::ios::in | std::ios::binary );
+	if( !fileStream->is_open() )
+	{
+		Close();
+		return false;
+	}
+
+	stream = fileStream;
+	failed = false;
+	return Begin( *stream );
+}
+
+void MeshStreamReader::Close( void )
+{
+	delete fileStream;
+	fileStream = nullptr;
+	stream = nullptr;
+}
+
+bool MeshStreamReader::Rewind( void )
+{
+	if( !stream )
+		return false;
+
+	stream->clear();
+	stream->seekg( 0, std::ios::beg );
+	if( !stream->good() )
+		return false;
+
+	failed = false;
+	return Begin( *stream );
+}
+
+bool MeshStreamReader::ReadLine( std::string& line )
+{
+	if( !std::getline( *stream, line ) )
+		return false;
+
+	if( line.length() > 0 && line[ line.length() - 1 ] == '\r' )
+		line.resize( line.length() - 1 );
+
+	return true;
+}
+
+/*static*/ MeshStreamReader* MeshStreamReader::CreateForFile( const std::string& file )
+{
+	MeshStreamReader* reader = nullptr;
+
+	FileFormat* fileFormat = FileFormat::CreateForFile( file, true );
+	if( dynamic_cast< PlyFormat* >( fileFormat ) )
+		reader = new PlyStreamReader();
+	else if( dynamic_cast< ObjFormat* >( fileFormat ) )
+		reader = new ObjStreamReader();
+
+	delete fileFormat;
+
+	if( reader && !reader->Open( file ) )
+	{
+		delete reader;
+		reader = nullptr;
+	}
+
+	return reader;
+}
+
+//---------------------------------------------------------------------
+//                             PlyStreamReader
+//---------------------------------------------------------------------
+
+PlyStreamReader::PlyStreamReader( void )
+{
+	verticesRead = 0;
+	facesRead = 0;
+	faceCount = 0;
+}
+
+/*virtual*/ PlyStreamReader::~PlyStreamReader( void )
+{
+}
+
+/*virtual*/ bool PlyStreamReader::Begin( std::istream& stream )
+{
+	this->stream = &stream;
+
+	componentArray.clear();
+	verticesRead = 0;
+	facesRead = 0;
+	faceCount = 0;
+	vertexCount = 0;
+	triangleCount = -1;
+
+	try
+	{
+		std::string line;
+		if( !ReadLine( line ) || line != "ply" )
+			throw new Exception( "Not a ply file." );
+
+		if( !ReadLine( line ) || line.compare( 0, 16, "format ascii 1.0" ) != 0 )
+			throw new Exception( "Format unrecognized." );
+
+		std::string element;
+
+		while( true )
+		{
+			if( !ReadLine( line ) )
+				throw new Exception( "Unexpected end of header." );
+
+			char word[3][64] = { "", "", "" };
+			int wordCount = sscanf( line.c_str(), "%63s %63s %63s", word[0], word[1], word[2] );
+			if( wordCount <= 0 )
+				continue;
+
+			std::string keyword = word[0];
+
+			if( keyword == "end_header" )
+				break;
+			else if( keyword == "comment" || keyword == "obj_info" )
+				continue;
+			else if( keyword == "element" )
+			{
+				element = word[1];
+				int count = atoi( word[2] );
+
+				if( element == "vertex" )
+				{
+					if( faceCount > 0 )
+						throw new Exception( "Faces must follow vertices for streaming." );
+
+					vertexCount = count;
+				}
+				else if( element == "face" )
+					faceCount = count;
+				else if( count != 0 )
+					throw new Exception( "Unknown element section: " + element );
+			}
+			else if( keyword == "property" )
+			{
+				if( element == "vertex" )
+				{
+					std::string component = word[2];
+
+					Component type = COMPONENT_IGNORED;
+					if( component == "x" )
+						type = COMPONENT_X;
+					else if( component == "y" )
+						type = COMPONENT_Y;
+					else if( component == "z" )
+						type = COMPONENT_Z;
+					else if( component == "nx" )
+						type = COMPONENT_NX;
+					else if( component == "ny" )
+						type = COMPONENT_NY;
+					else if( component == "nz" )
+						type = COMPONENT_NZ;
+					else if( component == "r" )
+						type = COMPONENT_R;
+					else if( component == "g" )
+						type = COMPONENT_G;
+					else if( component == "b" )
+						type = COMPONENT_B;
+					else if( component == "u" || component == "s" )
+						type = COMPONENT_U;
+					else if( component == "v" || component == "t" )
+						type = COMPONENT_V;
+
+					componentArray.push_back( type );
+				}
+				else if( element == "face" )
+				{
+					if( std::string( word[1] ) != "list" || line.find( "vertex_indices" ) == std::string::npos )
+						throw new Exception( "Unsupported face format." );
+				}
+			}
+		}
+	}
+	catch( Exception* exception )
+	{
+		exception->Handle();
+		delete exception;
+		failed = true;
+		return false;
+	}
+
+	return true;
+}
+
+/*virtual*/ bool PlyStreamReader::ReadChunk( MeshStreamChunk& chunk )
+{
+	chunk.Clear();
+	chunk.vertexBase = verticesRead;
+
+	if( failed || !stream )
+		return false;
+
+	std::string line;
+
+	while( chunk.Size() < chunkSize )
+	{
+		if( verticesRead < vertexCount )
+		{
+			if( !ReadLine( line ) )
+			{
+				failed = true;
+				break;
+			}
+
+			Vertex vertex;
+			const char* cursor = line.c_str();
+
+			for( int i = 0; i < ( signed )componentArray.size(); i++ )
+			{
+				char* end = nullptr;
+				double value = strtod( cursor, &end );
+				if( end == cursor )
+				{
+					failed = true;
+					break;
+				}
+
+				cursor = end;
+
+				switch( componentArray[i] )
+				{
+					case COMPONENT_X:	vertex.position.x = value;	break;
+					case COMPONENT_Y:	vertex.position.y = value;	break;
+					case COMPONENT_Z:	vertex.position.z = value;	break;
+					case COMPONENT_NX:	vertex.normal.x = value;	break;
+					case COMPONENT_NY:	vertex.normal.y = value;	break;
+					case COMPONENT_NZ:	vertex.normal.z = value;	break;
+					case COMPONENT_R:	vertex.color.x = value;		break;
+					case COMPONENT_G:	vertex.color.y = value;		break;
+					case COMPONENT_B:	vertex.color.z = value;		break;
+					case COMPONENT_U:	vertex.texCoords.x = value;	break;
+					case COMPONENT_V:	vertex.texCoords.y = value;	break;
+					default:										break;
+				}
+			}
+
+			if( failed )
+				break;
+
+			chunk.vertexArray.push_back( vertex );
+			verticesRead++;
+		}
+		else if( facesRead < faceCount )
+		{
+			if( !ReadLine( line ) )
+			{
+				failed = true;
+				break;
+			}
+
+			char* cursor = const_cast< char* >( line.c_str() );
+			int count = ( int )strtol( cursor, &cursor, 10 );
+
+			int index[3];
+			for( int i = 0; i < count; i++ )
+			{
+				char* end = nullptr;
+				int value = ( int )strtol( cursor, &end, 10 );
+				if( end == cursor || value < 0 || value >= vertexCount )
+				{
+					failed = true;
+					break;
+				}
+
+				cursor = end;
+
+				// Choose an arbitrary tessellation of the polygon.
+				if( i == 0 )
+					index[0] = value;
+				else if( i == 1 )
+					index[2] = value;
+				else
+				{
+					index[1] = index[2];
+					index[2] = value;
+					chunk.triangleArray.push_back( IndexTriangle( index[0], index[1], index[2] ) );
+				}
+			}
+
+			if( failed )
+				break;
+
+			facesRead++;
+		}
+		else
+			break;
+	}
+
+	return( chunk.Size() > 0 );
+}
+
+//---------------------------------------------------------------------
+//                             ObjStreamReader
+//---------------------------------------------------------------------
+
+ObjStreamReader::ObjStreamReader( void )
+{
+	verticesRead = 0;
+}
+
+/*virtual*/ ObjStreamReader::~ObjStreamReader( void )
+{
+}
+
+/*virtual*/ bool ObjStreamReader::Begin( std::istream& stream )
+{
+	this->stream = &stream;
+
+	verticesRead = 0;
+	vertexCount = -1;
+	triangleCount = -1;
+
+	return true;
+}
+
+/*virtual*/ bool ObjStreamReader::ReadChunk( MeshStreamChunk& chunk )
+{
+	chunk.Clear();
+	chunk.vertexBase = verticesRead;
+
+	if( failed || !stream )
+		return false;
+
+	std::string line;
+
+	while( chunk.Size() < chunkSize && ReadLine( line ) )
+	{
+		const char* cursor = line.c_str();
+		while( *cursor == ' ' || *cursor == '\t' )
+			cursor++;
+
+		if( cursor[0] == 'v' && ( cursor[1] == ' ' || cursor[1] == '\t' ) )
+		{
+			Vertex vertex;
+
+			double value[6];
+			int count = 0;
+			char* end = const_cast< char* >( cursor + 1 );
+			while( count < 6 )
+			{
+				const char* start = end;
+				value[ count ] = strtod( start, &end );
+				if( end == start )
+					break;
+				count++;
+			}
+
+			if( count < 3 )
+			{
+				failed = true;
+				break;
+			}
+
+			vertex.position.Set( value[0], value[1], value[2] );
+			if( count == 6 )
+				vertex.color.Set( value[3], value[4], value[5] );
+
+			chunk.vertexArray.push_back( vertex );
+			verticesRead++;
+		}
+		else if( cursor[0] == 'f' && ( cursor[1] == ' ' || cursor[1] == '\t' ) )
+		{
+			faceIndexArray.clear();
+
+			char* end = const_cast< char* >( cursor + 1 );
+			while( true )
+			{
+				const char* start = end;
+				int index = ( int )strtol( start, &end, 10 );
+				if( end == start )
+					break;
+
+				// Skip over any texture coordinate and normal indices.
+				while( *end != '\0' && *end != ' ' && *end != '\t' )
+					end++;
+
+				// OBJ indices are one-based, and negative ones count back from the latest vertex.
+				if( index < 0 )
+					index = verticesRead + index;
+				else
+					index = index - 1;
+
+				if( index < 0 || index >= verticesRead )
+				{
+					failed = true;
+					break;
+				}
+
+				faceIndexArray.push_back( index );
+			}
+
+			if( failed )
+				break;
+
+			// Choose an arbitrary tesselation of the face.
+			for( int i = 0; i < ( signed )faceIndexArray.size() - 2; i++ )
+				chunk.triangleArray.push_back( IndexTriangle( faceIndexArray[0], faceIndexArray[ i + 1 ], faceIndexArray[ i + 2 ] ) );
+		}
+	}
+
+	return( chunk.Size() > 0 );
+}
+
+//---------------------------------------------------------------------
+//                             MeshStreamWriter
+//---------------------------------------------------------------------
+
+MeshStreamWriter::MeshStreamWriter( void )
+{
+	stream = nullptr;
+	fileStream = nullptr;
+	writer = nullptr;
+}
+
+/*virtual*/ MeshStreamWriter::~MeshStreamWriter( void )
+{
+	delete writer;
+	delete fileStream;
+}
+
+bool MeshStreamWriter::Open( const std::string& file )
+{
+	delete writer;
+	writer = nullptr;
+	delete fileStream;
+
+	fileStream = new std::ofstream();
+	fileStream->open( file, std::ios::out | std::ios::binary | std::ios::trunc );
+	if( !fileStream->is_open() )
+	{
+		delete fileStream;
+		fileStream = nullptr;
+		return false;
+	}
+
+	return Begin( *fileStream );
+}
+
+bool MeshStreamWriter::Close( void )
+{
+	bool success = End();
+
+	delete writer;
+	writer = nullptr;
+	delete fileStream;
+	fileStream = nullptr;
+	stream = nullptr;
+
+	return success;
+}
+
+/*static*/ MeshStreamWriter* MeshStreamWriter::CreateForFile( const std::string& file )
+{
+	MeshStreamWriter* writer = nullptr;
+
+	FileFormat* fileFormat = FileFormat::CreateForFile( file );
+	if( dynamic_cast< PlyFormat* >( fileFormat ) )
+		writer = new PlyStreamWriter();
+	else if( dynamic_cast< ObjFormat* >( fileFormat ) )
+		writer = new ObjStreamWriter();
+
+	delete fileFormat;
+
+	return writer;
+}
+
+//---------------------------------------------------------------------
+//                             PlyStreamWriter
+//---------------------------------------------------------------------
+
+// Counts are written zero-padded to this width so that they can be patched in place.
+static const int plyCountWidth = 10;
+
+PlyStreamWriter::PlyStreamWriter( void )
+{
+	faceScratch = nullptr;
+	endSucceeded = false;
+	vertexCountPosition = -1;
+	faceCountPosition = -1;
+	verticesWritten = 0;
+	facesWritten = 0;
+}
+
+/*virtual*/ PlyStreamWriter::~PlyStreamWriter( void )
+{
+	delete faceScratch;
+}
+
+/*virtual*/ bool PlyStreamWriter::Begin( std::ostream& stream )
+{
+	this->stream = &stream;
+
+	delete writer;
+	writer = new StreamWriter( stream );
+
+	delete faceScratch;
+	faceScratch = new ScratchFile();
+	endSucceeded = false;
+
+	verticesWritten = 0;
+	facesWritten = 0;
+
+	std::string placeholder( plyCountWidth, '0' );
+
+	writer->Write( "ply\n" );
+	writer->Write( "format ascii 1.0\n" );
+	writer->Write( "comment Generated by 3DMath library.\n" );
+	writer->Write( "element vertex " );
+	writer->Flush();
+	vertexCountPosition = ( int64_t )stream.tellp();
+	writer->Write( placeholder );
+	writer->Write( '\n' );
+	writer->Write( "property double x\n" );
+	writer->Write( "property double y\n" );
+	writer->Write( "property double z\n" );
+	writer->Write( "property double nx\n" );
+	writer->Write( "property double ny\n" );
+	writer->Write( "property double nz\n" );
+	writer->Write( "property double r\n" );
+	writer->Write( "property double g\n" );
+	writer->Write( "property double b\n" );
+	writer->Write( "property double u\n" );
+	writer->Write( "property double v\n" );
+	writer->Write( "element face " );
+	writer->Flush();
+	faceCountPosition = ( int64_t )stream.tellp();
+	writer->Write( placeholder );
+	writer->Write( '\n' );
+	writer->Write( "property list uchar int vertex_indices\n" );
+	writer->Write( "end_header\n" );
+
+	return writer->Good();
+}
+
+/*virtual*/ bool PlyStreamWriter::WriteChunk( const MeshStreamChunk& chunk )
+{
+	if( !writer || !faceScratch )
+		return false;
+
+	for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+	{
+		const Vertex& vertex = chunk.vertexArray[i];
+
+		writer->WriteDouble( vertex.position.x );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.position.y );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.position.z );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.normal.x );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.normal.y );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.normal.z );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.color.x );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.color.y );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.color.z );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.texCoords.x );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.texCoords.y );
+		writer->Write( '\n' );
+	}
+
+	verticesWritten += ( int )chunk.vertexArray.size();
+
+	if( chunk.triangleArray.size() > 0 )
+	{
+		std::vector< int32_t > indexArray;
+		indexArray.reserve( chunk.triangleArray.size() * 3 );
+		for( int i = 0; i < ( signed )chunk.triangleArray.size(); i++ )
+			for( int j = 0; j < 3; j++ )
+				indexArray.push_back( chunk.triangleArray[i].vertex[j] );
+
+		if( !faceScratch->Append( indexArray.data(), indexArray.size() * sizeof( int32_t ) ) )
+			return false;
+
+		facesWritten += ( int )chunk.triangleArray.size();
+	}
+
+	return writer->Good();
+}
+
+/*virtual*/ bool PlyStreamWriter::End( void )
+{
+	if( !writer )
+		return false;
+
+	// Close() calls this too, so a second call just reports how the first went.
+	if( !faceScratch )
+		return endSucceeded;
+
+	endSucceeded = WriteFaces();
+
+	delete faceScratch;
+	faceScratch = nullptr;
+
+	return endSucceeded;
+}
+
+bool PlyStreamWriter::WriteFaces( void )
+{
+	const int blockSize = 3 * 4096;
+	std::vector< int32_t > indexArray( blockSize );
+
+	int64_t indexCount = faceScratch->Size() / sizeof( int32_t );
+	for( int64_t offset = 0; offset < indexCount; offset += blockSize )
+	{
+		int count = ( int )MIN( int64_t( blockSize ), indexCount - offset );
+		if( !faceScratch->Read( offset * sizeof( int32_t ), indexArray.data(), count * sizeof( int32_t ) ) )
+			return false;
+
+		for( int i = 0; i < count; i += 3 )
+		{
+			writer->Write( "3 " );
+			writer->WriteInteger( indexArray[i] );
+			writer->Write( ' ' );
+			writer->WriteInteger( indexArray[ i + 1 ] );
+			writer->Write( ' ' );
+			writer->WriteInteger( indexArray[ i + 2 ] );
+			writer->Write( '\n' );
+		}
+	}
+
+	writer->Flush();
+
+	if( vertexCountPosition < 0 || faceCountPosition < 0 )
+		return false;
+
+	std::streampos endPosition = stream->tellp();
+
+	char count[32];
+	snprintf( count, sizeof( count ), "%0*d", plyCountWidth, verticesWritten );
+	stream->seekp( vertexCountPosition );
+	stream->write( count, plyCountWidth );
+	snprintf( count, sizeof( count ), "%0*d", plyCountWidth, facesWritten );
+	stream->seekp( faceCountPosition );
+	stream->write( count, plyCountWidth );
+	stream->seekp( endPosition );
+	stream->flush();
+
+	return stream->good();
+}
+
+//---------------------------------------------------------------------
+//                             ObjStreamWriter
+//---------------------------------------------------------------------
+
+ObjStreamWriter::ObjStreamWriter( void )
+{
+}
+
+/*virtual*/ ObjStreamWriter::~ObjStreamWriter( void )
+{
+}
+
+/*virtual*/ bool ObjStreamWriter::Begin( std::ostream& stream )
+{
+	this->stream = &stream;
+
+	delete writer;
+	writer = new StreamWriter( stream );
+
+	writer->Write( "# Generated by 3DMath library.\n" );
+
+	return writer->Good();
+}
+
+/*virtual*/ bool ObjStreamWriter::WriteChunk( const MeshStreamChunk& chunk )
+{
+	if( !writer )
+		return false;
+
+	// Normals are written alongside positions so that a face corner can use one index for both.
+	for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+	{
+		const Vertex& vertex = chunk.vertexArray[i];
+
+		writer->Write( "v " );
+		writer->WriteDouble( vertex.position.x );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.position.y );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.position.z );
+		writer->Write( "\nvn " );
+		writer->WriteDouble( vertex.normal.x );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.normal.y );
+		writer->Write( ' ' );
+		writer->WriteDouble( vertex.normal.z );
+		writer->Write( '\n' );
+	}
+
+	for( int i = 0; i < ( signed )chunk.triangleArray.size(); i++ )
+	{
+		const IndexTriangle& triangle = chunk.triangleArray[i];
+
+		writer->Write( 'f' );
+
+		for( int j = 0; j < 3; j++ )
+		{
+			int64_t index = triangle.vertex[j] + 1;
+
+			writer->Write( ' ' );
+			writer->WriteInteger( index );
+			writer->Write( "//" );
+			writer->WriteInteger( index );
+		}
+
+		writer->Write( '\n' );
+	}
+
+	return writer->Good();
+}
+
+/*virtual*/ bool ObjStreamWriter::End( void )
+{
+	if( !writer )
+		return false;
+
+	writer->Flush();
+	stream->flush();
+	return stream->good();
+}
+
+//---------------------------------------------------------------------
+//                               ScratchFile
+//---------------------------------------------------------------------
+
+ScratchFile::ScratchFile( void )
+{
+	file = tmpfile();
+	size = 0;
+}
+
+ScratchFile::~ScratchFile( void )
+{
+	if( file )
+		fclose( file );
+}
+
+bool ScratchFile::Seek( int64_t offset )
+{
+	if( !file )
+		return false;
+
+#if defined _WIN32
+	return( _fseeki64( file, offset, SEEK_SET ) == 0 );
+#else
+	return( fseeko( file, ( off_t )offset, SEEK_SET ) == 0 );
+#endif
+}
+
+bool ScratchFile::Write( int64_t offset, const void* data, int64_t size )
+{
+	if( !Seek( offset ) )
+		return false;
+
+	if( fwrite( data, 1, ( size_t )size, file ) != ( size_t )size )
+		return false;
+
+	if( offset + size > this->size )
+		this->size = offset + size;
+
+	return true;
+}
+
+bool ScratchFile::Read( int64_t offset, void* data, int64_t size )
+{
+	if( !Seek( offset ) )
+		return false;
+
+	return( fread( data, 1, ( size_t )size, file ) == ( size_t )size );
+}
+
+bool ScratchFile::Append( const void* data, int64_t size )
+{
+	return Write( this->size, data, size );
+}
+
+//---------------------------------------------------------------------
+//                            MeshStreamPipeline
+//---------------------------------------------------------------------
+
+namespace
+{
+	struct WeldCell
+	{
+		int64_t index[3];
+
+		bool operator<( const WeldCell& cell ) const
+		{
+			for( int i = 0; i < 3; i++ )
+				if( index[i] != cell.index[i] )
+					return index[i] < cell.index[i];
+			return false;
+		}
+	};
+
+	// This is how a vertex travels through scratch storage during welding.
+	struct WeldRecord
+	{
+		int64_t index;
+		double position[3];
+		double normal[3];
+		double color[3];
+		double texCoords[2];
+		double alpha;
+
+		void SetVertex( int64_t index, const Vertex& vertex )
+		{
+			this->index = index;
+			vertex.position.Get( position[0], position[1], position[2] );
+			vertex.normal.Get( normal[0], normal[1], normal[2] );
+			vertex.color.Get( color[0], color[1], color[2] );
+			texCoords[0] = vertex.texCoords.x;
+			texCoords[1] = vertex.texCoords.y;
+			alpha = vertex.alpha;
+		}
+
+		void GetVertex( Vertex& vertex ) const
+		{
+			vertex.position.Set( position[0], position[1], position[2] );
+			vertex.normal.Set( normal[0], normal[1], normal[2] );
+			vertex.color.Set( color[0], color[1], color[2] );
+			vertex.texCoords.Set( texCoords[0], texCoords[1], 0.0 );
+			vertex.alpha = alpha;
+		}
+
+		void GetCell( const Vector& origin, double eps, WeldCell& cell ) const
+		{
+			cell.index[0] = int64_t( floor( ( position[0] - origin.x ) / eps ) );
+			cell.index[1] = int64_t( floor( ( position[1] - origin.y ) / eps ) );
+			cell.index[2] = int64_t( floor( ( position[2] - origin.z ) / eps ) );
+		}
+	};
+
+	// This is a run of eps cells along the welding axis, whose vertices wait in scratch storage.
+	struct WeldSlab
+	{
+		ScratchFile* scratch;
+		int64_t firstCell;
+		int64_t lastCell;
+	};
+
+	// This is a welded vertex as seen by the vertices still looking for one to weld to.
+	struct WeldPoint
+	{
+		int index;
+		double position[3];
+	};
+
+	typedef std::map< WeldCell, std::vector< WeldPoint > > WeldCellMap;
+
+	int FindWeldPoint( const WeldCellMap& cellMap, const WeldCell& cell, const double* position, double eps )
+	{
+		WeldCell neighborCell;
+		for( int i = -1; i <= 1; i++ )
+		{
+			neighborCell.index[0] = cell.index[0] + i;
+			for( int j = -1; j <= 1; j++ )
+			{
+				neighborCell.index[1] = cell.index[1] + j;
+				for( int k = -1; k <= 1; k++ )
+				{
+					neighborCell.index[2] = cell.index[2] + k;
+
+					WeldCellMap::const_iterator iter = cellMap.find( neighborCell );
+					if( iter == cellMap.end() )
+						continue;
+
+					const std::vector< WeldPoint >& weldPointArray = iter->second;
+					for( int l = 0; l < ( signed )weldPointArray.size(); l++ )
+					{
+						const WeldPoint& weldPoint = weldPointArray[l];
+
+						double distanceSquared = 0.0;
+						for( int m = 0; m < 3; m++ )
+						{
+							double delta = position[m] - weldPoint.position[m];
+							distanceSquared += delta * delta;
+						}
+
+						if( distanceSquared <= eps * eps )
+							return weldPoint.index;
+					}
+				}
+			}
+		}
+
+		return -1;
+	}
+}
+
+MeshStreamPipeline::MeshStreamPipeline( void )
+{
+	chunkSize = 1 << 16;
+	elementsPerPage = 1 << 14;
+	maxResidentPages = 64;
+	maxBucketCount = 256;
+}
+
+/*virtual*/ MeshStreamPipeline::~MeshStreamPipeline( void )
+{
+}
+
+bool MeshStreamPipeline::CalculateBoundingBox( MeshStreamReader& reader, AxisAlignedBox& boundingBox )
+{
+	reader.chunkSize = chunkSize;
+
+	bool foundVertex = false;
+
+	MeshStreamChunk chunk;
+	while( reader.ReadChunk( chunk ) )
+	{
+		for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+		{
+			const Vector& position = chunk.vertexArray[i].position;
+
+			if( foundVertex )
+				boundingBox.GrowToIncludePoint( position );
+			else
+			{
+				boundingBox.negCorner = position;
+				boundingBox.posCorner = position;
+				foundVertex = true;
+			}
+		}
+	}
+
+	return( foundVertex && !reader.Failed() );
+}
+
+bool MeshStreamPipeline::Export( MeshStreamReader& reader, MeshStreamWriter& writer )
+{
+	reader.chunkSize = chunkSize;
+
+	MeshStreamChunk chunk;
+	while( reader.ReadChunk( chunk ) )
+		if( !writer.WriteChunk( chunk ) )
+			return false;
+
+	return !reader.Failed();
+}
+
+bool MeshStreamPipeline::Transform( MeshStreamReader& reader, MeshStreamWriter& writer, const AffineTransform& affineTransform )
+{
+	reader.chunkSize = chunkSize;
+
+	LinearTransform normalTransform;
+	if( !affineTransform.linearTransform.GetNormalTransform( normalTransform ) )
+		return false;
+
+	MeshStreamChunk chunk;
+	while( reader.ReadChunk( chunk ) )
+	{
+		for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+			affineTransform.Transform( chunk.vertexArray[i], &normalTransform );
+
+		if( !writer.WriteChunk( chunk ) )
+			return false;
+	}
+
+	return !reader.Failed();
+}
+
+bool MeshStreamPipeline::CalculateNormals( MeshStreamReader& reader, MeshStreamWriter& writer )
+{
+	reader.chunkSize = chunkSize;
+
+	ScratchArray< Vector > positionArray( elementsPerPage, maxResidentPages / 2 );
+	ScratchArray< Vector > normalArray( elementsPerPage, maxResidentPages / 2 );
+
+	Vector zero( 0.0, 0.0, 0.0 );
+
+	// The first pass accumulates face normals into each vertex, just as TriangleMesh::CalculateNormals does.
+	MeshStreamChunk chunk;
+	while( reader.ReadChunk( chunk ) )
+	{
+		for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+		{
+			positionArray.Append( chunk.vertexArray[i].position );
+			normalArray.Append( zero );
+		}
+
+		for( int i = 0; i < ( signed )chunk.triangleArray.size(); i++ )
+		{
+			const IndexTriangle& indexTriangle = chunk.triangleArray[i];
+
+			Triangle triangle;
+			for( int j = 0; j < 3; j++ )
+			{
+				if( indexTriangle.vertex[j] < 0 || indexTriangle.vertex[j] >= positionArray.Size() )
+					return false;
+
+				triangle.vertex[j] = positionArray.Get( indexTriangle.vertex[j] );
+			}
+
+			Vector faceNormal;
+			triangle.GetNormal( faceNormal );
+			if( !faceNormal.Normalize() )
+				continue;
+
+			for( int j = 0; j < 3; j++ )
+				normalArray.Set( indexTriangle.vertex[j], normalArray.Get( indexTriangle.vertex[j] ) + faceNormal );
+		}
+	}
+
+	if( reader.Failed() || !reader.Rewind() )
+		return false;
+
+	while( reader.ReadChunk( chunk ) )
+	{
+		for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+		{
+			Vertex& vertex = chunk.vertexArray[i];
+			vertex.normal = normalArray.Get( chunk.vertexBase + i );
+			vertex.normal.Normalize();
+		}
+
+		if( !writer.WriteChunk( chunk ) )
+			return false;
+	}
+
+	return !reader.Failed();
+}
+
+// Each vertex is merged into the first welded vertex found within eps of it, or else becomes a welded
+// vertex itself.  Welded vertices are found through an eps-sized grid of cells.  To keep memory bounded,
+// the grid is cut into slabs along its longest axis and the slabs are welded in order, each seeing only
+// its own cells and the last layer of cells in the slab before it.  Slabs are cut evenly in space, then
+// any slab with more vertices than the pages allow is cut again, until it fits or is one cell thick.
+bool MeshStreamPipeline::WeldVertices( MeshStreamReader& reader, MeshStreamWriter& writer, double eps /*= EPSILON*/ )
+{
+	if( eps <= 0.0 )
+		return false;
+
+	reader.chunkSize = chunkSize;
+
+	AxisAlignedBox boundingBox;
+	int64_t vertexTotal = 0;
+	bool foundVertex = false;
+
+	MeshStreamChunk chunk;
+	while( reader.ReadChunk( chunk ) )
+	{
+		for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+		{
+			const Vector& position = chunk.vertexArray[i].position;
+
+			if( foundVertex )
+				boundingBox.GrowToIncludePoint( position );
+			else
+			{
+				boundingBox.negCorner = position;
+				boundingBox.posCorner = position;
+				foundVertex = true;
+			}
+		}
+
+		vertexTotal += chunk.vertexArray.size();
+	}
+
+	if( reader.Failed() || !reader.Rewind() )
+		return false;
+
+	if( !foundVertex )
+		return Export( reader, writer );
+
+	Vector extent;
+	extent.Subtract( boundingBox.posCorner, boundingBox.negCorner );
+
+	int axis = 0;
+	if( extent.y > extent.x && extent.y >= extent.z )
+		axis = 1;
+	else if( extent.z > extent.x && extent.z > extent.y )
+		axis = 2;
+
+	double axisExtent = ( axis == 0 ) ? extent.x : ( ( axis == 1 ) ? extent.y : extent.z );
+	int64_t cellCount = int64_t( floor( axisExtent / eps ) ) + 1;
+
+	int64_t bucketCount = ( vertexTotal + chunkSize - 1 ) / chunkSize;
+	bucketCount = MAX( int64_t(1), MIN( bucketCount, MIN( int64_t( maxBucketCount ), cellCount ) ) );
+	int64_t cellsPerBucket = ( cellCount + bucketCount - 1 ) / bucketCount;
+
+	std::vector< WeldSlab > slabArray;
+	for( int64_t i = 0; i < bucketCount; i++ )
+	{
+		WeldSlab slab;
+		slab.scratch = new ScratchFile();
+		slab.firstCell = i * cellsPerBucket;
+		slab.lastCell = MIN( ( i + 1 ) * cellsPerBucket, cellCount ) - 1;
+		slabArray.push_back( slab );
+	}
+
+	bool success = true;
+
+	// Scatter every vertex into the slab that owns its cell.
+	while( success && reader.ReadChunk( chunk ) )
+	{
+		for( int i = 0; i < ( signed )chunk.vertexArray.size(); i++ )
+		{
+			const Vertex& vertex = chunk.vertexArray[i];
+
+			WeldRecord record;
+			record.SetVertex( chunk.vertexBase + i, vertex );
+
+			WeldCell cell;
+			record.GetCell( boundingBox.negCorner, eps, cell );
+
+			int64_t bucket = MIN( cell.index[ axis ] / cellsPerBucket, bucketCount - 1 );
+			if( !slabArray[ ( size_t )bucket ].scratch->Append( &record, sizeof( WeldRecord ) ) )
+				success = false;
+		}
+	}
+
+	if( reader.Failed() )
+		success = false;
+
+	// Slabs are taken from the back of this list, so it's kept in descending order.
+	std::reverse( slabArray.begin(), slabArray.end() );
+
+	// Weld each slab in turn, reading its records a chunk at a time and recording where every original
+	// vertex went.  Only the welded vertices of the slab's cells are held in memory, along with those
+	// of the last layer of cells in the slab before it, which vertices in the slab's first layer may reach.
+	// A slab holding more vertices than the pages may is first split into thinner slabs, so that a
+	// mesh clustered in a few cells doesn't land in one slab.
+	int64_t maxSlabSize = int64_t( elementsPerPage ) * MAX( maxResidentPages, 1 );
+
+	ScratchArray< int > remapArray( elementsPerPage, maxResidentPages );
+	remapArray.Resize( vertexTotal, -1 );
+
+	ScratchFile weldedScratch;
+	int weldedCount = 0;
+
+	WeldCellMap cellMap;
+	std::vector< WeldRecord > recordArray;
+
+	while( success && slabArray.size() > 0 )
+	{
+		WeldSlab slab = slabArray.back();
+		slabArray.pop_back();
+
+		int64_t recordTotal = slab.scratch->Size() / sizeof( WeldRecord );
+
+		if( recordTotal > maxSlabSize && slab.lastCell > slab.firstCell )
+		{
+			int64_t subSlabCount = MIN( int64_t( MAX( maxBucketCount, 2 ) ), slab.lastCell - slab.firstCell + 1 );
+			int64_t cellsPerSubSlab = ( slab.lastCell - slab.firstCell + subSlabCount ) / subSlabCount;
+
+			std::vector< WeldSlab > subSlabArray;
+			for( int64_t i = 0; i < subSlabCount; i++ )
+			{
+				WeldSlab subSlab;
+				subSlab.scratch = new ScratchFile();
+				subSlab.firstCell = slab.firstCell + i * cellsPerSubSlab;
+				subSlab.lastCell = MIN( slab.firstCell + ( i + 1 ) * cellsPerSubSlab - 1, slab.lastCell );
+				subSlabArray.push_back( subSlab );
+			}
+
+			for( int64_t base = 0; success && base < recordTotal; base += chunkSize )
+			{
+				int count = ( int )MIN( int64_t( chunkSize ), recordTotal - base );
+
+				recordArray.resize( count );
+				if( !slab.scratch->Read( base * sizeof( WeldRecord ), recordArray.data(), count * sizeof( WeldRecord ) ) )
+				{
+					success = false;
+					break;
+				}
+
+				for( int j = 0; j < count; j++ )
+				{
+					WeldCell cell;
+					recordArray[j].GetCell( boundingBox.negCorner, eps, cell );
+
+					int64_t subSlab = ( cell.index[ axis ] - slab.firstCell ) / cellsPerSubSlab;
+					subSlab = MAX( int64_t(0), MIN( subSlab, subSlabCount - 1 ) );
+					if( !subSlabArray[ ( size_t )subSlab ].scratch->Append( &recordArray[j], sizeof( WeldRecord ) ) )
+						success = false;
+				}
+			}
+
+			delete slab.scratch;
+
+			for( int64_t i = subSlabCount - 1; i >= 0; i-- )
+				slabArray.push_back( subSlabArray[ ( size_t )i ] );
+
+			continue;
+		}
+
+		for( int64_t base = 0; success && base < recordTotal; base += chunkSize )
+		{
+			int count = ( int )MIN( int64_t( chunkSize ), recordTotal - base );
+
+			recordArray.resize( count );
+			if( !slab.scratch->Read( base * sizeof( WeldRecord ), recordArray.data(), count * sizeof( WeldRecord ) ) )
+			{
+				success = false;
+				break;
+			}
+
+			for( int j = 0; j < count; j++ )
+			{
+				const WeldRecord& record = recordArray[j];
+
+				WeldCell cell;
+				record.GetCell( boundingBox.negCorner, eps, cell );
+
+				// Anything within eps of the vertex lies in its own cell or one of the cells around it.
+				int weldedIndex = FindWeldPoint( cellMap, cell, record.position, eps );
+				if( weldedIndex < 0 )
+				{
+					WeldPoint weldPoint;
+					weldPoint.index = weldedCount;
+					for( int k = 0; k < 3; k++ )
+						weldPoint.position[k] = record.position[k];
+
+					cellMap[ cell ].push_back( weldPoint );
+					if( !weldedScratch.Append( &record, sizeof( WeldRecord ) ) )
+						success = false;
+
+					weldedIndex = weldedCount++;
+				}
+
+				remapArray.Set( record.index, weldedIndex );
+			}
+		}
+
+		delete slab.scratch;
+
+		// Keep only the last layer of cells in this slab for the next one to see.
+		WeldCellMap::iterator iter = cellMap.begin();
+		while( iter != cellMap.end() )
+		{
+			if( iter->first.index[ axis ] < slab.lastCell )
+				iter = cellMap.erase( iter );
+			else
+				++iter;
+		}
+	}
+
+	for( int i = 0; i < ( signed )slabArray.size(); i++ )
+		delete slabArray[i].scratch;
+
+	if( !success )
+		return false;
+
+	// Write out the welded vertices, then all the faces with their indices remapped.
+	for( int base = 0; base < weldedCount; base += chunkSize )
+	{
+		int count = MIN( chunkSize, weldedCount - base );
+
+		std::vector< WeldRecord > recordArray( count );
+		if( !weldedScratch.Read( int64_t( base ) * sizeof( WeldRecord ), recordArray.data(), count * sizeof( WeldRecord ) ) )
+			return false;
+
+		chunk.Clear();
+		chunk.vertexBase = base;
+		chunk.vertexArray.resize( count );
+		for( int i = 0; i < count; i++ )
+			recordArray[i].GetVertex( chunk.vertexArray[i] );
+
+		if( !writer.WriteChunk( chunk ) )
+			return false;
+	}
+
+	if( !reader.Rewind() )
+		return false;
+
+	MeshStreamChunk faceChunk;
+	faceChunk.vertexBase = weldedCount;
+
+	while( reader.ReadChunk( chunk ) )
+	{
+		faceChunk.Clear();
+
+		for( int i = 0; i < ( signed )chunk.triangleArray.size(); i++ )
+		{
+			IndexTriangle triangle = chunk.triangleArray[i];
+			for( int j = 0; j < 3; j++ )
+				triangle.vertex[j] = remapArray.Get( triangle.vertex[j] );
+
+			// Welding can collapse triangles.
+			if( triangle.vertex[0] == triangle.vertex[1] || triangle.vertex[1] == triangle.vertex[2] || triangle.vertex[2] == triangle.vertex[0] )
+				continue;
+
+			faceChunk.triangleArray.push_back( triangle );
+		}
+
+		if( faceChunk.Size() > 0 && !writer.WriteChunk( faceChunk ) )
+			return false;
+	}
+
+	return !reader.Failed();
+}
+
+// MeshStream.cpp
@@ -0,0 +1,343 @@
+// MeshStream.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vertex.h"
+#include "IndexTriangle.h"
+#include "AxisAlignedBox.h"
+
+namespace _3DMath
+{
+	class MeshStreamChunk;
+	class MeshStreamReader;
+	class PlyStreamReader;
+	class ObjStreamReader;
+	class MeshStreamWriter;
+	class PlyStreamWriter;
+	class ObjStreamWriter;
+	class MeshStreamPipeline;
+	class ScratchFile;
+	class AffineTransform;
+	class StreamWriter;
+
+	typedef std::vector< IndexTriangle > IndexTriangleArray;
+}
+
+// A chunk holds the next run of vertices and/or triangles from a source, in file order.
+// Triangle indices are always global, so they may refer to vertices from earlier chunks.
+class _3DMATH_API _3DMath::MeshStreamChunk
+{
+public:
+
+	MeshStreamChunk( void );
+	~MeshStreamChunk( void );
+
+	void Clear( void );
+	int Size( void ) const;
+
+	VertexArray vertexArray;
+	IndexTriangleArray triangleArray;
+	int vertexBase;
+};
+
+class _3DMATH_API _3DMath::MeshStreamReader
+{
+public:
+
+	MeshStreamReader( void );
+	virtual ~MeshStreamReader( void );
+
+	bool Open( const std::string& file );
+	void Close( void );
+	bool Rewind( void );
+
+	virtual bool Begin( std::istream& stream ) = 0;
+
+	// This returns false once the source is exhausted or malformed; check Failed() to tell which.
+	virtual bool ReadChunk( MeshStreamChunk& chunk ) = 0;
+
+	bool Failed( void ) const { return failed; }
+
+	static MeshStreamReader* CreateForFile( const std::string& file );
+
+	int chunkSize;
+	int vertexCount;		// These are -1 if the source can't tell us up front.
+	int triangleCount;
+
+protected:
+
+	bool ReadLine( std::string& line );
+
+	std::istream* stream;
+	std::ifstream* fileStream;
+	bool failed;
+};
+
+class _3DMATH_API _3DMath::PlyStreamReader : public _3DMath::MeshStreamReader
+{
+public:
+
+	PlyStreamReader( void );
+	virtual ~PlyStreamReader( void );
+
+	virtual bool Begin( std::istream& stream ) override;
+	virtual bool ReadChunk( MeshStreamChunk& chunk ) override;
+
+private:
+
+	enum Component
+	{
+		COMPONENT_IGNORED,
+		COMPONENT_X, COMPONENT_Y, COMPONENT_Z,
+		COMPONENT_NX, COMPONENT_NY, COMPONENT_NZ,
+		COMPONENT_R, COMPONENT_G, COMPONENT_B,
+		COMPONENT_U, COMPONENT_V,
+	};
+
+	std::vector< Component > componentArray;
+	int verticesRead;
+	int facesRead;
+	int faceCount;
+};
+
+// Only positions and faces are streamed from OBJ sources.  Texture coordinates and normals
+// are indexed independently of positions in OBJ, which can't be reconciled without random access.
+class _3DMATH_API _3DMath::ObjStreamReader : public _3DMath::MeshStreamReader
+{
+public:
+
+	ObjStreamReader( void );
+	virtual ~ObjStreamReader( void );
+
+	virtual bool Begin( std::istream& stream ) override;
+	virtual bool ReadChunk( MeshStreamChunk& chunk ) override;
+
+private:
+
+	int verticesRead;
+	std::vector< int > faceIndexArray;
+};
+
+class _3DMATH_API _3DMath::MeshStreamWriter
+{
+public:
+
+	MeshStreamWriter( void );
+	virtual ~MeshStreamWriter( void );
+
+	bool Open( const std::string& file );
+	bool Close( void );
+
+	virtual bool Begin( std::ostream& stream ) = 0;
+	virtual bool WriteChunk( const MeshStreamChunk& chunk ) = 0;
+	virtual bool End( void ) = 0;
+
+	static MeshStreamWriter* CreateForFile( const std::string& file );
+
+protected:
+
+	std::ostream* stream;
+	std::ofstream* fileStream;
+	StreamWriter* writer;
+};
+
+// PLY wants all vertices before any faces and both counts in the header, so faces are spilled
+// to scratch storage until End(), at which point the counts are patched in place.  That requires
+// a seekable stream.
+class _3DMATH_API _3DMath::PlyStreamWriter : public _3DMath::MeshStreamWriter
+{
+public:
+
+	PlyStreamWriter( void );
+	virtual ~PlyStreamWriter( void );
+
+	virtual bool Begin( std::ostream& stream ) override;
+	virtual bool WriteChunk( const MeshStreamChunk& chunk ) override;
+	virtual bool End( void ) override;
+
+private:
+
+	bool WriteFaces( void );
+
+	ScratchFile* faceScratch;
+	bool endSucceeded;
+	int64_t vertexCountPosition;
+	int64_t faceCountPosition;
+	int verticesWritten;
+	int facesWritten;
+};
+
+class _3DMATH_API _3DMath::ObjStreamWriter : public _3DMath::MeshStreamWriter
+{
+public:
+
+	ObjStreamWriter( void );
+	virtual ~ObjStreamWriter( void );
+
+	virtual bool Begin( std::ostream& stream ) override;
+	virtual bool WriteChunk( const MeshStreamChunk& chunk ) override;
+	virtual bool End( void ) override;
+};
+
+// This is an anonymous temporary file that goes away when closed.
+class _3DMATH_API _3DMath::ScratchFile
+{
+public:
+
+	ScratchFile( void );
+	~ScratchFile( void );
+
+	bool Write( int64_t offset, const void* data, int64_t size );
+	bool Read( int64_t offset, void* data, int64_t size );
+	bool Append( const void* data, int64_t size );
+
+	int64_t Size( void ) const { return size; }
+
+private:
+
+	bool Seek( int64_t offset );
+
+	FILE* file;
+	int64_t size;
+};
+
+namespace _3DMath
+{
+	// This is a random-access array that lives in a scratch file, of which at most a few pages
+	// are resident in memory at any one time.  The element type must be safe to copy byte-wise.
+	template< typename Type >
+	class ScratchArray
+	{
+	public:
+
+		ScratchArray( int elementsPerPage = 1 << 14, int maxResidentPages = 64 )
+		{
+			this->elementsPerPage = elementsPerPage;
+			this->maxResidentPages = maxResidentPages;
+			size = 0;
+			useCounter = 0;
+		}
+
+		~ScratchArray( void )
+		{
+			for( int i = 0; i < ( signed )pageArray.size(); i++ )
+				delete[] pageArray[i].data;
+		}
+
+		// New elements are filled with the given value.
+		void Resize( int64_t newSize, const Type& fill )
+		{
+			int64_t oldSize = size;
+			size = newSize;
+			for( int64_t i = oldSize; i < newSize; i++ )
+				Set( i, fill );
+		}
+
+		int64_t Size( void ) const { return size; }
+
+		void Append( const Type& value )
+		{
+			Set( size++, value );
+		}
+
+		Type Get( int64_t index )
+		{
+			return GetPage( index )->data[ index % elementsPerPage ];
+		}
+
+		void Set( int64_t index, const Type& value )
+		{
+			Page* page = GetPage( index );
+			page->data[ index % elementsPerPage ] = value;
+			page->dirty = true;
+		}
+
+	private:
+
+		struct Page
+		{
+			int64_t pageIndex;
+			int64_t lastUse;
+			bool dirty;
+			Type* data;
+		};
+
+		Page* GetPage( int64_t index )
+		{
+			int64_t pageIndex = index / elementsPerPage;
+
+			Page* leastRecentPage = nullptr;
+			for( int i = 0; i < ( signed )pageArray.size(); i++ )
+			{
+				Page* page = &pageArray[i];
+				if( page->pageIndex == pageIndex )
+				{
+					page->lastUse = ++useCounter;
+					return page;
+				}
+
+				if( !leastRecentPage || page->lastUse < leastRecentPage->lastUse )
+					leastRecentPage = page;
+			}
+
+			int64_t pageBytes = int64_t( elementsPerPage ) * sizeof( Type );
+
+			Page* page = nullptr;
+			if( ( signed )pageArray.size() < maxResidentPages )
+			{
+				Page newPage;
+				newPage.data = new Type[ elementsPerPage ];
+				pageArray.push_back( newPage );
+				page = &pageArray.back();
+			}
+			else
+			{
+				page = leastRecentPage;
+				if( page->dirty )
+					scratchFile.Write( page->pageIndex * pageBytes, page->data, pageBytes );
+			}
+
+			page->pageIndex = pageIndex;
+			page->lastUse = ++useCounter;
+			page->dirty = false;
+
+			if( pageIndex * pageBytes < scratchFile.Size() )
+				scratchFile.Read( pageIndex * pageBytes, page->data, pageBytes );
+
+			return page;
+		}
+
+		ScratchFile scratchFile;
+		std::vector< Page > pageArray;
+		int elementsPerPage;
+		int maxResidentPages;
+		int64_t size;
+		int64_t useCounter;
+	};
+}
+
+// These operators consume a mesh one chunk at a time, so that meshes far larger than memory can
+// be processed.  Anything that needs per-vertex state keeps it in scratch arrays whose resident
+// size is bounded by the pipeline's page settings.  Operators needing more than one pass over
+// the source rewind the reader, so readers must be opened on seekable files.
+class _3DMATH_API _3DMath::MeshStreamPipeline
+{
+public:
+
+	MeshStreamPipeline( void );
+	virtual ~MeshStreamPipeline( void );
+
+	bool CalculateBoundingBox( MeshStreamReader& reader, AxisAlignedBox& boundingBox );
+	bool Export( MeshStreamReader& reader, MeshStreamWriter& writer );
+	bool Transform( MeshStreamReader& reader, MeshStreamWriter& writer, const AffineTransform& affineTransform );
+	bool CalculateNormals( MeshStreamReader& reader, MeshStreamWriter& writer );
+	bool WeldVertices( MeshStreamReader& reader, MeshStreamWriter& writer, double eps = EPSILON );
+
+	int chunkSize;
+	int elementsPerPage;
+	int maxResidentPages;
+	int maxBucketCount;
+};
+
+// MeshStream.h
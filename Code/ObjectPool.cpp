@@ -0,0 +1,118 @@
+// ObjectPool.cpp
+
+#include "ObjectPool.h"
+#include <cstddef>
+
+using namespace _3DMath;
+
+#define SHARED_POOL_COUNT		( ObjectPool::MAX_SHARED_SIZE / ObjectPool::SHARED_SIZE_GRANULARITY )
+
+ObjectPool::ObjectPool( size_t blockSize, int blocksPerChunk /*= 256*/ )
+{
+	// Every block must be able to hold the free list's link, and keep the alignment of anything new would give.
+	blockSize = MAX( blockSize, sizeof( FreeBlock ) );
+	blockSize = ( blockSize + alignof( std::max_align_t ) - 1 ) & ~( alignof( std::max_align_t ) - 1 );
+
+	this->blockSize = blockSize;
+	this->blocksPerChunk = MAX( blocksPerChunk, 1 );
+
+	usedBlockCount = 0;
+	freeBlockList = nullptr;
+	chunkArray = new std::vector< char* >;
+	mutex = new std::mutex;
+}
+
+/*virtual*/ ObjectPool::~ObjectPool( void )
+{
+	for( int i = 0; i < ( signed )chunkArray->size(); i++ )
+		::operator delete( ( *chunkArray )[i] );
+
+	delete chunkArray;
+	delete mutex;
+}
+
+void* ObjectPool::Allocate( void )
+{
+	std::lock_guard< std::mutex > lock( *mutex );
+
+	if( !freeBlockList )
+	{
+		char* chunk = ( char* )::operator new( blockSize * blocksPerChunk );
+		chunkArray->push_back( chunk );
+
+		// The blocks are linked so that they're handed out in address order.
+		for( int i = blocksPerChunk - 1; i >= 0; i-- )
+		{
+			FreeBlock* freeBlock = ( FreeBlock* )( chunk + i * blockSize );
+			freeBlock->nextBlock = freeBlockList;
+			freeBlockList = freeBlock;
+		}
+	}
+
+	FreeBlock* freeBlock = freeBlockList;
+	freeBlockList = freeBlock->nextBlock;
+	usedBlockCount++;
+	return freeBlock;
+}
+
+void ObjectPool::Free( void* block )
+{
+	if( !block )
+		return;
+
+	std::lock_guard< std::mutex > lock( *mutex );
+
+	FreeBlock* freeBlock = ( FreeBlock* )block;
+	freeBlock->nextBlock = freeBlockList;
+	freeBlockList = freeBlock;
+	usedBlockCount--;
+}
+
+int ObjectPool::GetChunkCount( void ) const
+{
+	std::lock_guard< std::mutex > lock( *mutex );
+	return ( int )chunkArray->size();
+}
+
+int ObjectPool::GetUsedBlockCount( void ) const
+{
+	std::lock_guard< std::mutex > lock( *mutex );
+	return usedBlockCount;
+}
+
+// The pools are made on first use rather than at static initialization, which might come after some
+// other static object has already made a pooled object, and are leaked on purpose.
+static ObjectPool* GetSharedPool( size_t size )
+{
+	static ObjectPool** sharedPoolArray = []() {
+		ObjectPool** poolArray = new ObjectPool*[ SHARED_POOL_COUNT ];
+		for( int i = 0; i < SHARED_POOL_COUNT; i++ )
+			poolArray[i] = new ObjectPool( ( i + 1 ) * ObjectPool::SHARED_SIZE_GRANULARITY );
+		return poolArray;
+	}();
+
+	if( size == 0 || size > ObjectPool::MAX_SHARED_SIZE )
+		return nullptr;
+
+	return sharedPoolArray[ ( size - 1 ) / ObjectPool::SHARED_SIZE_GRANULARITY ];
+}
+
+/*static*/ void* ObjectPool::AllocateShared( size_t size )
+{
+	ObjectPool* pool = GetSharedPool( size );
+	if( !pool )
+		return ::operator new( size );
+
+	return pool->Allocate();
+}
+
+/*static*/ void ObjectPool::FreeShared( void* block, size_t size )
+{
+	ObjectPool* pool = GetSharedPool( size );
+	if( !pool )
+		::operator delete( block );
+	else
+		pool->Free( block );
+}
+
+// ObjectPool.cpp
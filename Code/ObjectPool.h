@@ -0,0 +1,53 @@
+// ObjectPool.h
+
+#pragma once
+
+#include "Defines.h"
+#include <mutex>
+
+namespace _3DMath
+{
+	class ObjectPool;
+}
+
+// This hands out blocks of one size from chunks of many blocks each, keeping freed blocks on a list
+// for reuse, so that objects made and destroyed in great numbers cost neither a heap allocation each
+// nor scattered memory.  Chunks are only given back to the heap when the pool is destroyed.
+class _3DMATH_API _3DMath::ObjectPool
+{
+public:
+
+	ObjectPool( size_t blockSize, int blocksPerChunk = 256 );
+	virtual ~ObjectPool( void );
+
+	void* Allocate( void );
+	void Free( void* block );
+
+	int GetChunkCount( void ) const;
+	int GetUsedBlockCount( void ) const;
+
+	// These go to a pool shared by all objects of about the given size, made the first time it's
+	// needed and never destroyed, so that an object may be freed at any time, even during exit.
+	// Sizes too big for any pool go to the heap.  The size given to free a block must be the size
+	// given to allocate it, as it is with a class's sized operator delete.
+	static void* AllocateShared( size_t size );
+	static void FreeShared( void* block, size_t size );
+
+	enum { SHARED_SIZE_GRANULARITY = 16, MAX_SHARED_SIZE = 512 };
+
+private:
+
+	struct FreeBlock
+	{
+		FreeBlock* nextBlock;
+	};
+
+	size_t blockSize;
+	int blocksPerChunk;
+	int usedBlockCount;
+	FreeBlock* freeBlockList;
+	std::vector< char* >* chunkArray;
+	std::mutex* mutex;
+};
+
+// ObjectPool.h
@@ -0,0 +1,395 @@
+// ParticleArray.cpp
+
+#include "ParticleArray.h"
+#include "VectorKernels.h"
+#include "BatchTransform.h"
+#include "Simd.h"
+
+using namespace _3DMath;
+
+static_assert( sizeof( Vector ) == 3 * sizeof( double ), "Vector must be three packed doubles." );
+
+static inline bool UseAVX2( void )
+{
+	return BatchTransform::GetSupportedInstructions() == BatchTransform::INSTRUCTIONS_AVX2;
+}
+
+static inline uint32_t GetSlot( ParticleId id )
+{
+	return uint32_t( id );
+}
+
+static inline uint32_t GetGeneration( ParticleId id )
+{
+	return uint32_t( id >> 32 );
+}
+
+static inline ParticleId MakeId( uint32_t slot, uint32_t generation )
+{
+	return ( ParticleId( generation ) << 32 ) | slot;
+}
+
+//---------------------------------------------------------------------
+//                              Integration
+//---------------------------------------------------------------------
+
+struct IntegrationConstants
+{
+	double stepTime;
+	double stepTimeSquared;
+	double inverseStepTime;
+	double positionScale;
+	double previousPositionScale;
+	int subSteps;
+};
+
+// The operations and their order are those of ParticleSystem::Particle::Integrate, which the exact
+// kernel below also follows, so that all three agree to the bit.
+static void IntegrateScalar( double* position, double* previousPosition, double* velocity, const double* netForce, const double* inverseMass, int begin, int end, const IntegrationConstants& constants )
+{
+	for( int i = begin; i < end; i++ )
+	{
+		for( int j = 3 * i; j < 3 * i + 3; j++ )
+		{
+			double acceleration = netForce[j] * inverseMass[i];
+
+			for( int k = 0; k < constants.subSteps; k++ )
+			{
+				velocity[j] = ( position[j] - previousPosition[j] ) * constants.inverseStepTime;
+
+				double nextPosition = position[j] * constants.positionScale + previousPosition[j] * constants.previousPositionScale;
+				nextPosition += acceleration * constants.stepTimeSquared;
+
+				previousPosition[j] = position[j];
+				position[j] = nextPosition;
+			}
+		}
+	}
+}
+
+#if defined _3DMATH_X86
+
+// Four particles are twelve doubles, or three registers per field.  The four inverse masses are
+// spread to match the x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 layout, so no transpose is needed.
+_3DMATH_TARGET_AVX2_NOFMA static int IntegrateExactAVX2( double* position, double* previousPosition, double* velocity, const double* netForce, const double* inverseMass, int count, const IntegrationConstants& constants )
+{
+	__m256d inverseStepTime = _mm256_set1_pd( constants.inverseStepTime );
+	__m256d stepTimeSquared = _mm256_set1_pd( constants.stepTimeSquared );
+	__m256d positionScale = _mm256_set1_pd( constants.positionScale );
+	__m256d previousPositionScale = _mm256_set1_pd( constants.previousPositionScale );
+
+	int blockCount = count / 4;
+
+	for( int i = 0; i < blockCount; i++ )
+	{
+		__m256d inverseMass4 = _mm256_loadu_pd( inverseMass + 4 * i );
+		__m256d inverseMassSpread[3];
+		inverseMassSpread[0] = _mm256_permute4x64_pd( inverseMass4, _MM_SHUFFLE( 1, 0, 0, 0 ) );
+		inverseMassSpread[1] = _mm256_permute4x64_pd( inverseMass4, _MM_SHUFFLE( 2, 2, 1, 1 ) );
+		inverseMassSpread[2] = _mm256_permute4x64_pd( inverseMass4, _MM_SHUFFLE( 3, 3, 3, 2 ) );
+
+		for( int j = 0; j < 3; j++ )
+		{
+			int offset = 12 * i + 4 * j;
+
+			__m256d acceleration = _mm256_mul_pd( _mm256_loadu_pd( netForce + offset ), inverseMassSpread[j] );
+			__m256d currentPosition = _mm256_loadu_pd( position + offset );
+			__m256d lastPosition = _mm256_loadu_pd( previousPosition + offset );
+			__m256d currentVelocity = _mm256_setzero_pd();
+
+			for( int k = 0; k < constants.subSteps; k++ )
+			{
+				currentVelocity = _mm256_mul_pd( _mm256_sub_pd( currentPosition, lastPosition ), inverseStepTime );
+
+				__m256d nextPosition = _mm256_add_pd( _mm256_mul_pd( currentPosition, positionScale ), _mm256_mul_pd( lastPosition, previousPositionScale ) );
+				nextPosition = _mm256_add_pd( nextPosition, _mm256_mul_pd( acceleration, stepTimeSquared ) );
+
+				lastPosition = currentPosition;
+				currentPosition = nextPosition;
+			}
+
+			_mm256_storeu_pd( position + offset, currentPosition );
+			_mm256_storeu_pd( previousPosition + offset, lastPosition );
+			_mm256_storeu_pd( velocity + offset, currentVelocity );
+		}
+	}
+
+	return 4 * blockCount;
+}
+
+// This is the same, but with fused multiply-adds.
+_3DMATH_TARGET_AVX2 static int IntegrateFastAVX2( double* position, double* previousPosition, double* velocity, const double* netForce, const double* inverseMass, int count, const IntegrationConstants& constants )
+{
+	__m256d inverseStepTime = _mm256_set1_pd( constants.inverseStepTime );
+	__m256d stepTimeSquared = _mm256_set1_pd( constants.stepTimeSquared );
+	__m256d positionScale = _mm256_set1_pd( constants.positionScale );
+	__m256d previousPositionScale = _mm256_set1_pd( constants.previousPositionScale );
+
+	int blockCount = count / 4;
+
+	for( int i = 0; i < blockCount; i++ )
+	{
+		__m256d inverseMass4 = _mm256_loadu_pd( inverseMass + 4 * i );
+		__m256d inverseMassSpread[3];
+		inverseMassSpread[0] = _mm256_permute4x64_pd( inverseMass4, _MM_SHUFFLE( 1, 0, 0, 0 ) );
+		inverseMassSpread[1] = _mm256_permute4x64_pd( inverseMass4, _MM_SHUFFLE( 2, 2, 1, 1 ) );
+		inverseMassSpread[2] = _mm256_permute4x64_pd( inverseMass4, _MM_SHUFFLE( 3, 3, 3, 2 ) );
+
+		for( int j = 0; j < 3; j++ )
+		{
+			int offset = 12 * i + 4 * j;
+
+			__m256d acceleration = _mm256_mul_pd( _mm256_loadu_pd( netForce + offset ), inverseMassSpread[j] );
+			__m256d currentPosition = _mm256_loadu_pd( position + offset );
+			__m256d lastPosition = _mm256_loadu_pd( previousPosition + offset );
+			__m256d currentVelocity = _mm256_setzero_pd();
+
+			for( int k = 0; k < constants.subSteps; k++ )
+			{
+				currentVelocity = _mm256_mul_pd( _mm256_sub_pd( currentPosition, lastPosition ), inverseStepTime );
+
+				__m256d nextPosition = _mm256_fmadd_pd( currentPosition, positionScale, _mm256_mul_pd( lastPosition, previousPositionScale ) );
+				nextPosition = _mm256_fmadd_pd( acceleration, stepTimeSquared, nextPosition );
+
+				lastPosition = currentPosition;
+				currentPosition = nextPosition;
+			}
+
+			_mm256_storeu_pd( position + offset, currentPosition );
+			_mm256_storeu_pd( previousPosition + offset, lastPosition );
+			_mm256_storeu_pd( velocity + offset, currentVelocity );
+		}
+	}
+
+	return 4 * blockCount;
+}
+
+#endif //_3DMATH_X86
+
+//---------------------------------------------------------------------
+//                             ParticleArray
+//---------------------------------------------------------------------
+
+ParticleArray::ParticleArray( void )
+{
+	positionArray = new VectorArray;
+	previousPositionArray = new VectorArray;
+	velocityArray = new VectorArray;
+	netForceArray = new VectorArray;
+	massArray = new std::vector< double >;
+	inverseMassArray = new std::vector< double >;
+	timeOfDeathArray = new std::vector< double >;
+	frictionArray = new std::vector< double >;
+	idArray = new std::vector< ParticleId >;
+
+	slotIndexArray = new std::vector< int >;
+	slotGenerationArray = new std::vector< uint32_t >;
+	freeSlotArray = new std::vector< uint32_t >;
+}
+
+/*virtual*/ ParticleArray::~ParticleArray( void )
+{
+	delete positionArray;
+	delete previousPositionArray;
+	delete velocityArray;
+	delete netForceArray;
+	delete massArray;
+	delete inverseMassArray;
+	delete timeOfDeathArray;
+	delete frictionArray;
+	delete idArray;
+
+	delete slotIndexArray;
+	delete slotGenerationArray;
+	delete freeSlotArray;
+}
+
+ParticleId ParticleArray::Add( const Vector& position, double mass /*= 1.0*/, double timeOfDeath /*= 0.0*/, double friction /*= 1.0*/ )
+{
+	uint32_t slot;
+	if( freeSlotArray->size() > 0 )
+	{
+		slot = freeSlotArray->back();
+		freeSlotArray->pop_back();
+	}
+	else
+	{
+		// Generations start at one so that no id is ever INVALID_ID.
+		slot = ( uint32_t )slotIndexArray->size();
+		slotIndexArray->push_back( -1 );
+		slotGenerationArray->push_back( 1 );
+	}
+
+	ParticleId id = MakeId( slot, ( *slotGenerationArray )[ slot ] );
+	( *slotIndexArray )[ slot ] = GetCount();
+
+	positionArray->push_back( position );
+	previousPositionArray->push_back( position );
+	velocityArray->push_back( Vector( 0.0, 0.0, 0.0 ) );
+	netForceArray->push_back( Vector( 0.0, 0.0, 0.0 ) );
+	massArray->push_back( mass );
+	inverseMassArray->push_back( 1.0 / mass );
+	timeOfDeathArray->push_back( timeOfDeath );
+	frictionArray->push_back( friction );
+	idArray->push_back( id );
+
+	return id;
+}
+
+bool ParticleArray::Remove( ParticleId id )
+{
+	int index = GetIndex( id );
+	if( index < 0 )
+		return false;
+
+	RemoveAt( index );
+	return true;
+}
+
+void ParticleArray::RemoveAt( int index )
+{
+	uint32_t slot = GetSlot( ( *idArray )[ index ] );
+	( *slotIndexArray )[ slot ] = -1;
+
+	// Skip zero on wrap-around, so that the slot can never produce INVALID_ID.
+	uint32_t& generation = ( *slotGenerationArray )[ slot ];
+	if( ++generation == 0 )
+		generation = 1;
+
+	freeSlotArray->push_back( slot );
+
+	int last = GetCount() - 1;
+	if( index != last )
+	{
+		( *positionArray )[ index ] = ( *positionArray )[ last ];
+		( *previousPositionArray )[ index ] = ( *previousPositionArray )[ last ];
+		( *velocityArray )[ index ] = ( *velocityArray )[ last ];
+		( *netForceArray )[ index ] = ( *netForceArray )[ last ];
+		( *massArray )[ index ] = ( *massArray )[ last ];
+		( *inverseMassArray )[ index ] = ( *inverseMassArray )[ last ];
+		( *timeOfDeathArray )[ index ] = ( *timeOfDeathArray )[ last ];
+		( *frictionArray )[ index ] = ( *frictionArray )[ last ];
+		( *idArray )[ index ] = ( *idArray )[ last ];
+
+		( *slotIndexArray )[ GetSlot( ( *idArray )[ index ] ) ] = index;
+	}
+
+	positionArray->pop_back();
+	previousPositionArray->pop_back();
+	velocityArray->pop_back();
+	netForceArray->pop_back();
+	massArray->pop_back();
+	inverseMassArray->pop_back();
+	timeOfDeathArray->pop_back();
+	frictionArray->pop_back();
+	idArray->pop_back();
+}
+
+void ParticleArray::Clear( void )
+{
+	while( GetCount() > 0 )
+		RemoveAt( GetCount() - 1 );
+}
+
+void ParticleArray::Reserve( int capacity )
+{
+	positionArray->reserve( capacity );
+	previousPositionArray->reserve( capacity );
+	velocityArray->reserve( capacity );
+	netForceArray->reserve( capacity );
+	massArray->reserve( capacity );
+	inverseMassArray->reserve( capacity );
+	timeOfDeathArray->reserve( capacity );
+	frictionArray->reserve( capacity );
+	idArray->reserve( capacity );
+}
+
+int ParticleArray::GetIndex( ParticleId id ) const
+{
+	uint32_t slot = GetSlot( id );
+	if( slot >= slotIndexArray->size() || ( *slotGenerationArray )[ slot ] != GetGeneration( id ) )
+		return -1;
+
+	return ( *slotIndexArray )[ slot ];
+}
+
+int ParticleArray::CullDeadParticles( double currentTime )
+{
+	int count = 0;
+
+	// Going backward, whatever is swapped into a hole has already been looked at.
+	for( int i = GetCount() - 1; i >= 0; i-- )
+	{
+		double timeOfDeath = ( *timeOfDeathArray )[i];
+		if( timeOfDeath != 0.0 && timeOfDeath <= currentTime )
+		{
+			RemoveAt(i);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void ParticleArray::SetMass( int index, double mass )
+{
+	( *massArray )[ index ] = mass;
+	( *inverseMassArray )[ index ] = 1.0 / mass;
+}
+
+void ParticleArray::ResetForces( void )
+{
+	if( GetCount() > 0 )
+		VectorKernels::Fill( &( *netForceArray )[0], Vector( 0.0, 0.0, 0.0 ), GetCount() );
+}
+
+void ParticleArray::ResetMotion( void )
+{
+	int count = GetCount();
+	if( count == 0 )
+		return;
+
+	*previousPositionArray = *positionArray;
+	VectorKernels::Fill( &( *velocityArray )[0], Vector( 0.0, 0.0, 0.0 ), count );
+	VectorKernels::Fill( &( *netForceArray )[0], Vector( 0.0, 0.0, 0.0 ), count );
+}
+
+void ParticleArray::Integrate( double deltaTime, double damping, int subSteps /*= 1*/, FastMath::Precision precision /*= FastMath::PRECISION_DEFAULT*/ )
+{
+	int count = GetCount();
+	if( count == 0 || subSteps < 1 )
+		return;
+
+	if( precision == FastMath::PRECISION_DEFAULT )
+		precision = FastMath::GetDefaultPrecision();
+
+	IntegrationConstants constants;
+	constants.stepTime = deltaTime / double( subSteps );
+	constants.stepTimeSquared = constants.stepTime * constants.stepTime;
+	constants.inverseStepTime = 1.0 / constants.stepTime;
+	constants.positionScale = 2.0 - damping;
+	constants.previousPositionScale = damping - 1.0;
+	constants.subSteps = subSteps;
+
+	double* position = &( *positionArray )[0].x;
+	double* previousPosition = &( *previousPositionArray )[0].x;
+	double* velocity = &( *velocityArray )[0].x;
+	const double* netForce = &( *netForceArray )[0].x;
+	const double* inverseMass = &( *inverseMassArray )[0];
+
+	int i = 0;
+
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+	{
+		if( precision == FastMath::PRECISION_FAST )
+			i = IntegrateFastAVX2( position, previousPosition, velocity, netForce, inverseMass, count, constants );
+		else
+			i = IntegrateExactAVX2( position, previousPosition, velocity, netForce, inverseMass, count, constants );
+	}
+#endif
+
+	IntegrateScalar( position, previousPosition, velocity, netForce, inverseMass, i, count, constants );
+}
+
+// ParticleArray.cpp
@@ -0,0 +1,73 @@
+// ParticleArray.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+#include "FastMath.h"
+
+namespace _3DMath
+{
+	class ParticleArray;
+
+	// The low 32 bits are a slot and the high 32 bits that slot's generation, which changes each
+	// time the slot is freed, so that an id of a removed particle never finds its successor.
+	typedef uint64_t ParticleId;
+}
+
+// This keeps particle state as parallel arrays, one per field, rather than as one heap object per
+// particle, so that each phase of a simulation step is a pass over contiguous memory.  Index i of
+// every array belongs to the same particle.  Removal moves the last particle into the hole, so
+// indices are not stable; hold on to a ParticleId instead and look its index up when needed.
+class _3DMATH_API _3DMath::ParticleArray
+{
+public:
+
+	ParticleArray( void );
+	virtual ~ParticleArray( void );
+
+	enum { INVALID_ID = 0 };
+
+	ParticleId Add( const Vector& position, double mass = 1.0, double timeOfDeath = 0.0, double friction = 1.0 );
+	bool Remove( ParticleId id );
+	void Clear( void );
+	void Reserve( int capacity );
+
+	// This returns -1 for an id whose particle has been removed.
+	int GetIndex( ParticleId id ) const;
+	int GetCount( void ) const { return ( int )idArray->size(); }
+
+	// Particles with a nonzero time of death at or before the given time are removed; the number removed is returned.
+	int CullDeadParticles( double currentTime );
+
+	// Masses should be changed through this, so that the inverse mass is kept with them.
+	void SetMass( int index, double mass );
+
+	void ResetForces( void );
+	void ResetMotion( void );
+
+	// This is the Verlet step of ParticleSystem::Particle::Integrate, run with AVX2 when it's available.
+	// With more than one sub-step, the time step is divided evenly and the net force held over all of them.
+	// Exact precision gives the same bits as the one-particle-at-a-time step; fast allows fused multiply-adds.
+	void Integrate( double deltaTime, double damping, int subSteps = 1, FastMath::Precision precision = FastMath::PRECISION_DEFAULT );
+
+	VectorArray* positionArray;
+	VectorArray* previousPositionArray;
+	VectorArray* velocityArray;
+	VectorArray* netForceArray;
+	std::vector< double >* massArray;
+	std::vector< double >* inverseMassArray;
+	std::vector< double >* timeOfDeathArray;
+	std::vector< double >* frictionArray;
+	std::vector< ParticleId >* idArray;
+
+private:
+
+	void RemoveAt( int index );
+
+	std::vector< int >* slotIndexArray;			// Where each slot's particle is, or -1 if the slot is free.
+	std::vector< uint32_t >* slotGenerationArray;
+	std::vector< uint32_t >* freeSlotArray;
+};
+
+// ParticleArray.h
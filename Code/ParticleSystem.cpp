@@ -4,11 +4,79 @@
 #include "TriangleMesh.h"
 #include "AxisAlignedBox.h"
 #include "BoundingBoxTree.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Ray.h"
 #include "TimeKeeper.h"
+#include "AffineTransform.h"
 #include "ListFunctions.h"
+#include "VectorKernels.h"
+#include "Exception.h"
+#include <thread>
+#include <algorithm>
 
 using namespace _3DMath;
 
+// This splits [0,count) into the given number of contiguous ranges and calls the function on each
+// from its own thread, the last range running on the calling thread, in the way of BatchTransform.
+template< typename Function >
+static void ForEachRange( int threads, int count, const Function& function )
+{
+	if( threads < 2 )
+	{
+		function( 0, 0, count );
+		return;
+	}
+
+	std::vector< std::thread > threadArray;
+	int begin = 0;
+	for( int i = 0; i < threads; i++ )
+	{
+		int end = ( int )( int64_t( count ) * ( i + 1 ) / threads );
+		if( i == threads - 1 )
+			function( i, begin, end );
+		else
+			threadArray.push_back( std::thread( function, i, begin, end ) );
+		begin = end;
+	}
+
+	for( int i = 0; i < ( signed )threadArray.size(); i++ )
+		threadArray[i].join();
+}
+
+// The force F = torque x r / |r|^2, with r the offset from the center of mass, is perpendicular to r, and
+// its moment r x F works out to the part of the torque perpendicular to r.  A particle at the center of
+// mass can't be given any torque by a force, so it's left alone.
+static inline void ApplyTorque( const Vector& torque, const Vector& position, const Vector& centerOfMass, Vector& netForce )
+{
+	Vector vector;
+	vector.Subtract( position, centerOfMass );
+
+	double lengthSquared = vector.Dot( vector );
+	if( lengthSquared == 0.0 )
+		return;
+
+	Vector torqueForce;
+	torqueForce.Cross( torque, vector );
+	netForce.AddScale( torqueForce, 1.0 / lengthSquared );
+}
+
+// This is shared by the friction force and the system's contacts.
+static inline void ApplyFriction( const Vector& netForceAtImpact, const Vector& contactUnitNormal, double friction, const Vector& position, const Vector& previousPosition, Vector& netForce )
+{
+	// TODO: Get out the physics book and check this math.
+
+	double normalForce = contactUnitNormal.Dot( netForceAtImpact );
+	if( normalForce <= 0.0 )
+	{
+		Vector frictionForce;
+		frictionForce.Subtract( previousPosition, position );
+		frictionForce.Normalize();
+		frictionForce.Scale( -friction * normalForce );
+
+		netForce.Add( frictionForce );
+	}
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                        ParticleSystem
 //-------------------------------------------------------------------------------------------------
@@ -16,33 +84,77 @@ using namespace _3DMath;
 ParticleSystem::ParticleSystem( void )
 {
 	damping = 0.01;
+	subSteps = 1;
+	threadCount = 1;
+	minParticlesPerThread = 1 << 14;
 
 	centerOfMass.Set( 0.0, 0.0, 0.0 );
 
+	particleArray = new ParticleArray;
+	spatialHash = new SpatialHash;
 	particleList = new ParticleList;
 	forceList = new ForceList;
 	collisionObjectList = new CollisionObjectList;
 	emitterList = new EmitterList;
+
+	positionArray = new VectorArray;
+	massArray = new std::vector< double >;
+
+	collisionObjectArray = new std::vector< CollisionObject* >;
+	collisionBoxArray = new std::vector< AxisAlignedBox >;
+	boundedCollisionIndexArray = new std::vector< int >;
+	unboundedCollisionIndexArray = new std::vector< int >;
+	collisionHierarchy = new BoundingVolumeHierarchy;
+
+	contactArray = new std::vector< Contact >;
+	contactCount = 0;
 }
 
 /*virtual*/ ParticleSystem::~ParticleSystem( void )
 {
 	Clear();
 
+	delete particleArray;
+	delete spatialHash;
 	delete particleList;
 	delete forceList;
 	delete collisionObjectList;
 	delete emitterList;
+
+	delete positionArray;
+	delete massArray;
+
+	delete collisionObjectArray;
+	delete collisionBoxArray;
+	delete boundedCollisionIndexArray;
+	delete unboundedCollisionIndexArray;
+	delete collisionHierarchy;
+
+	delete contactArray;
 }
 
 void ParticleSystem::Clear( void )
 {
 	centerOfMass.Set( 0.0, 0.0, 0.0 );
 
+	particleArray->Clear();
+	spatialHash->Clear();
 	FreeList< Particle >( *particleList );
 	FreeList< Force >( *forceList );
 	FreeList< CollisionObject >( *collisionObjectList );
 	FreeList< Emitter >( *emitterList );
+
+	contactCount = 0;
+}
+
+int ParticleSystem::GetThreadCount( int workCount ) const
+{
+	int threads = threadCount;
+	if( threads <= 0 )
+		threads = ( int )std::thread::hardware_concurrency();
+
+	threads = MIN( threads, workCount / MAX( minParticlesPerThread, 1 ) );
+	return MAX( threads, 1 );
 }
 
 void ParticleSystem::Simulate( const _3DMath::TimeKeeper& timeKeeper )
@@ -50,6 +162,7 @@ void ParticleSystem::Simulate( const _3DMath::TimeKeeper& timeKeeper )
 	CullDeadParticles( timeKeeper );
 	ResetParticlePhysics();
 	CalculateCenterOfMass();
+	BuildSpatialHash();
 	AccumulateForces();
 	IntegrateParticles( timeKeeper );
 	ResolveCollisions();
@@ -74,6 +187,8 @@ void ParticleSystem::CullDeadParticles( const _3DMath::TimeKeeper& timeKeeper )
 
 		iter = nextIter;
 	}
+
+	particleArray->CullDeadParticles( currentTime );
 }
 
 void ParticleSystem::ResetParticlePhysics( void )
@@ -85,6 +200,8 @@ void ParticleSystem::ResetParticlePhysics( void )
 		particle->netForce.Set( 0.0, 0.0, 0.0 );
 		iter++;
 	}
+
+	particleArray->ResetForces();
 }
 
 void ParticleSystem::AccumulateForces( void )
@@ -106,6 +223,44 @@ void ParticleSystem::AccumulateForces( void )
 
 		iter = nextIter;
 	}
+
+	ApplyContactFriction();
+}
+
+// The contacts were found in the order the friction forces that used to stand for them were added to
+// the end of the force list, so they're applied in the same order, after every force of the list.
+void ParticleSystem::ApplyContactFriction( void )
+{
+	for( int i = 0; i < contactCount; i++ )
+	{
+		const Contact& contact = ( *contactArray )[i];
+
+		if( contact.particleId != ParticleArray::INVALID_ID )
+		{
+			int j = particleArray->GetIndex( contact.particleId );
+			if( j >= 0 )
+				ApplyFriction( contact.netForceAtImpact, contact.contactUnitNormal, contact.friction, ( *particleArray->positionArray )[j], ( *particleArray->previousPositionArray )[j], ( *particleArray->netForceArray )[j] );
+			continue;
+		}
+
+		Particle* particle = ( Particle* )HandleObject::Dereference( contact.particleHandle );
+		if( particle )
+		{
+			Vector position;
+			particle->GetPosition( position );
+			ApplyFriction( contact.netForceAtImpact, contact.contactUnitNormal, contact.friction, position, particle->previousPosition, particle->netForce );
+		}
+	}
+
+	contactCount = 0;
+}
+
+ParticleSystem::Contact* ParticleSystem::AddContact( void )
+{
+	if( contactCount == ( signed )contactArray->size() )
+		contactArray->resize( MAX( 2 * contactCount, 64 ) );
+
+	return &( *contactArray )[ contactCount++ ];
 }
 
 void ParticleSystem::ResetMotion( void )
@@ -123,6 +278,8 @@ void ParticleSystem::ResetMotion( void )
 		iter++;
 	}
 
+	particleArray->ResetMotion();
+
 	// Should we remove certain forces here too?
 	// We can't remove them all; some were added by the user.
 	// We should maybe delete all friction and torque forces.
@@ -137,10 +294,16 @@ void ParticleSystem::IntegrateParticles( const _3DMath::TimeKeeper& timeKeeper )
 		particle->Integrate( timeKeeper, damping );
 		iter++;
 	}
+
+	particleArray->Integrate( timeKeeper.GetDeltaTimeSeconds(), damping, subSteps );
 }
 
 void ParticleSystem::ResolveCollisions( void )
 {
+	BuildCollisionHierarchy();
+
+	std::vector< int > candidateArray;
+
 	ParticleList::iterator iter = particleList->begin();
 	while( iter != particleList->end() )
 	{
@@ -150,10 +313,11 @@ void ParticleSystem::ResolveCollisions( void )
 		lineOfMotion.vertex[0] = particle->previousPosition;
 		particle->GetPosition( lineOfMotion.vertex[1] );
 
-		CollisionObjectList::iterator collisionIter = collisionObjectList->begin();
-		while( collisionIter != collisionObjectList->end() )
+		FindCollisionCandidates( lineOfMotion, candidateArray );
+
+		for( int j = 0; j < ( signed )candidateArray.size(); j++ )
 		{
-			CollisionObject* collisionObject = ( CollisionObject* )*collisionIter;
+			CollisionObject* collisionObject = ( *collisionObjectArray )[ candidateArray[j] ];
 
 			Vector contactPosition, contactUnitNormal;
 			if( collisionObject->ResolveCollision( lineOfMotion, contactPosition, contactUnitNormal ) )
@@ -163,46 +327,154 @@ void ParticleSystem::ResolveCollisions( void )
 				double friction = collisionObject->friction * particle->friction;
 				if( friction != 0.0 )
 				{
-					FrictionForce* frictionForce = new FrictionForce( this );
-					frictionForce->netForceAtImpact = particle->netForce;
-					frictionForce->particleHandle = particle->GetHandle();
-					frictionForce->contactUnitNormal = contactUnitNormal;
-					frictionForce->friction = friction;
-					forceList->push_back( frictionForce );
+					Contact* contact = AddContact();
+					contact->particleHandle = particle->GetHandle();
+					contact->particleId = ParticleArray::INVALID_ID;
+					contact->netForceAtImpact = particle->netForce;
+					contact->contactUnitNormal = contactUnitNormal;
+					contact->friction = friction;
 				}
 			}
-
-			collisionIter++;
 		}
 
 		iter++;
 	}
+
+	for( int i = 0; i < particleArray->GetCount(); i++ )
+	{
+		LineSegment lineOfMotion( ( *particleArray->previousPositionArray )[i], ( *particleArray->positionArray )[i] );
+
+		FindCollisionCandidates( lineOfMotion, candidateArray );
+
+		for( int j = 0; j < ( signed )candidateArray.size(); j++ )
+		{
+			CollisionObject* collisionObject = ( *collisionObjectArray )[ candidateArray[j] ];
+
+			Vector contactPosition, contactUnitNormal;
+			if( collisionObject->ResolveCollision( lineOfMotion, contactPosition, contactUnitNormal ) )
+			{
+				( *particleArray->positionArray )[i] = contactPosition;
+
+				double friction = collisionObject->friction * ( *particleArray->frictionArray )[i];
+				if( friction != 0.0 )
+				{
+					Contact* contact = AddContact();
+					contact->particleHandle = 0;
+					contact->particleId = ( *particleArray->idArray )[i];
+					contact->netForceAtImpact = ( *particleArray->netForceArray )[i];
+					contact->contactUnitNormal = contactUnitNormal;
+					contact->friction = friction;
+				}
+			}
+		}
+	}
+}
+
+void ParticleSystem::BuildCollisionHierarchy( void )
+{
+	collisionObjectArray->clear();
+	collisionBoxArray->clear();
+	boundedCollisionIndexArray->clear();
+	unboundedCollisionIndexArray->clear();
+
+	for( CollisionObjectList::iterator iter = collisionObjectList->begin(); iter != collisionObjectList->end(); iter++ )
+	{
+		CollisionObject* collisionObject = ( CollisionObject* )*iter;
+		collisionObject->Update();
+
+		int index = ( int )collisionObjectArray->size();
+		collisionObjectArray->push_back( collisionObject );
+
+		AxisAlignedBox boundingBox;
+		if( collisionObject->GetBoundingBox( boundingBox ) )
+		{
+			collisionBoxArray->push_back( boundingBox );
+			boundedCollisionIndexArray->push_back( index );
+		}
+		else
+			unboundedCollisionIndexArray->push_back( index );
+	}
+
+	if( collisionBoxArray->size() > 0 )
+		collisionHierarchy->Build( &( *collisionBoxArray )[0], ( int )collisionBoxArray->size() );
+	else
+		collisionHierarchy->Clear();
+}
+
+// Collisions are resolved in the order of the collision object list, as they always have been, since
+// a later object's contact position wins; so the candidates are put back in that order.
+int ParticleSystem::FindCollisionCandidates( const LineSegment& lineOfMotion, std::vector< int >& candidateArray ) const
+{
+	candidateArray.clear();
+
+	AxisAlignedBox motionBox( lineOfMotion.vertex[0], lineOfMotion.vertex[0] );
+	motionBox.GrowToIncludePoint( lineOfMotion.vertex[1] );
+
+	int boundedCount = collisionHierarchy->FindOverlaps( motionBox, candidateArray );
+	for( int i = 0; i < boundedCount; i++ )
+		candidateArray[i] = ( *boundedCollisionIndexArray )[ candidateArray[i] ];
+
+	candidateArray.insert( candidateArray.end(), unboundedCollisionIndexArray->begin(), unboundedCollisionIndexArray->end() );
+
+	if( boundedCount > 0 )
+		std::sort( candidateArray.begin(), candidateArray.end() );
+
+	return ( int )candidateArray.size();
 }
 
 void ParticleSystem::CalculateCenterOfMass( void )
 {
+	// Positions may live elsewhere (e.g., in a mesh), so they're gathered before being summed.
+	positionArray->resize( particleList->size() );
+	massArray->resize( particleList->size() );
+
 	double totalMass = 0.0;
-	Vector totalMoments( 0.0, 0.0, 0.0 );
+	int i = 0;
 
-	ParticleList::iterator iter = particleList->begin();
-	while( iter != particleList->end() )
+	for( ParticleList::iterator iter = particleList->begin(); iter != particleList->end(); iter++, i++ )
 	{
-		Particle* particle = ( Particle* )*iter;
-
+		const Particle* particle = *iter;
+		particle->GetPosition( ( *positionArray )[i] );
+		( *massArray )[i] = particle->mass;
 		totalMass += particle->mass;
+	}
 
-		Vector moment;
-		particle->GetPosition( moment );
-		moment.Scale( particle->mass );
+	Vector totalMoments( 0.0, 0.0, 0.0 );
+	if( i > 0 )
+		VectorKernels::WeightedSum( &( *positionArray )[0], &( *massArray )[0], i, totalMoments );
 
-		totalMoments.Add( moment );
+	// The particle array's state is already flat, so it is summed in place.
+	int count = particleArray->GetCount();
+	if( count > 0 )
+	{
+		Vector arrayMoments;
+		VectorKernels::WeightedSum( &( *particleArray->positionArray )[0], &( *particleArray->massArray )[0], count, arrayMoments );
+		totalMoments.Add( arrayMoments );
 
-		iter++;
+		for( int j = 0; j < count; j++ )
+			totalMass += ( *particleArray->massArray )[j];
 	}
 
 	centerOfMass.SetScaled( totalMoments, 1.0 / totalMass );
 }
 
+void ParticleSystem::BuildSpatialHash( void )
+{
+	double radius = 0.0;
+
+	for( ForceList::iterator iter = forceList->begin(); iter != forceList->end(); iter++ )
+	{
+		const Force* force = ( const Force* )*iter;
+		radius = MAX( radius, force->GetNeighborhoodRadius() );
+	}
+
+	int count = particleArray->GetCount();
+	if( radius > 0.0 && count > 0 )
+		spatialHash->Build( &( *particleArray->positionArray )[0], count, radius );
+	else
+		spatialHash->Clear();
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                          Particle
 //-------------------------------------------------------------------------------------------------
@@ -309,6 +581,7 @@ ParticleSystem::Force::Force( ParticleSystem* system )
 	this->system = system;
 	enabled = true;
 	transient = false;
+	threadSafe = false;
 }
 
 /*virtual*/ ParticleSystem::Force::~Force( void )
@@ -324,12 +597,29 @@ ParticleSystem::Force::Force( ParticleSystem* system )
 		Apply( particle );
 		iter++;
 	}
+
+	ParticleArray& particleArray = *system->particleArray;
+	int count = particleArray.GetCount();
+	int threads = threadSafe ? system->GetThreadCount( count ) : 1;
+
+	ForEachRange( threads, count, [ this, &particleArray ]( int /*thread*/, int begin, int end ) {
+		Apply( particleArray, begin, end );
+	} );
 }
 
 /*virtual*/ void ParticleSystem::Force::Apply( Particle* particle )
 {
 }
 
+/*virtual*/ void ParticleSystem::Force::Apply( ParticleArray& particleArray, int begin, int end )
+{
+}
+
+/*virtual*/ double ParticleSystem::Force::GetNeighborhoodRadius( void ) const
+{
+	return 0.0;
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                           GenericForce
 //-------------------------------------------------------------------------------------------------
@@ -337,6 +627,7 @@ ParticleSystem::Force::Force( ParticleSystem* system )
 ParticleSystem::GenericForce::GenericForce( ParticleSystem* system ) : Force( system )
 {
 	force.Set( 0.0, 0.0, 0.0 );
+	threadSafe = true;
 }
 
 /*virtual*/ ParticleSystem::GenericForce::~GenericForce( void )
@@ -348,6 +639,12 @@ ParticleSystem::GenericForce::GenericForce( ParticleSystem* system ) : Force( sy
 	particle->netForce.Add( force );
 }
 
+/*virtual*/ void ParticleSystem::GenericForce::Apply( ParticleArray& particleArray, int begin, int end )
+{
+	for( int i = begin; i < end; i++ )
+		( *particleArray.netForceArray )[i].Add( force );
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                            WindForce
 //-------------------------------------------------------------------------------------------------
@@ -372,6 +669,17 @@ ParticleSystem::WindForce::WindForce( ParticleSystem* system ) : Force( system )
 	particle->netForce.Add( windForce );
 }
 
+/*virtual*/ void ParticleSystem::WindForce::Apply( ParticleArray& particleArray, int begin, int end )
+{
+	for( int i = begin; i < end; i++ )
+	{
+		Vector windForce;
+		system->random.VectorInCone( generalUnitDir, coneAngle, windForce );
+		windForce.Scale( system->random.Float( minStrength, maxStrength ) );
+		( *particleArray.netForceArray )[i].Add( windForce );
+	}
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                          ResistanceForce
 //-------------------------------------------------------------------------------------------------
@@ -379,6 +687,7 @@ ParticleSystem::WindForce::WindForce( ParticleSystem* system ) : Force( system )
 ParticleSystem::ResistanceForce::ResistanceForce( ParticleSystem* system ) : Force( system )
 {
 	resistance = 0.5;
+	threadSafe = true;
 }
 
 /*virtual*/ ParticleSystem::ResistanceForce::~ResistanceForce( void )
@@ -392,6 +701,12 @@ ParticleSystem::ResistanceForce::ResistanceForce( ParticleSystem* system ) : For
 	particle->netForce.Add( resistanceForce );
 }
 
+/*virtual*/ void ParticleSystem::ResistanceForce::Apply( ParticleArray& particleArray, int begin, int end )
+{
+	for( int i = begin; i < end; i++ )
+		( *particleArray.netForceArray )[i].AddScale( ( *particleArray.velocityArray )[i], -resistance );
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                            GravityForce
 //-------------------------------------------------------------------------------------------------
@@ -399,6 +714,7 @@ ParticleSystem::ResistanceForce::ResistanceForce( ParticleSystem* system ) : For
 ParticleSystem::GravityForce::GravityForce( ParticleSystem* system ) : Force( system )
 {
 	accelDueToGravity.Set( 0.0, -1.0, 0.0 );
+	threadSafe = true;
 }
 
 /*virtual*/ ParticleSystem::GravityForce::~GravityForce( void )
@@ -412,6 +728,12 @@ ParticleSystem::GravityForce::GravityForce( ParticleSystem* system ) : Force( sy
 	particle->netForce.Add( gravityForce );
 }
 
+/*virtual*/ void ParticleSystem::GravityForce::Apply( ParticleArray& particleArray, int begin, int end )
+{
+	for( int i = begin; i < end; i++ )
+		( *particleArray.netForceArray )[i].AddScale( accelDueToGravity, ( *particleArray.massArray )[i] );
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                            TorqueForce
 //-------------------------------------------------------------------------------------------------
@@ -419,6 +741,7 @@ ParticleSystem::GravityForce::GravityForce( ParticleSystem* system ) : Force( sy
 ParticleSystem::TorqueForce::TorqueForce( ParticleSystem* system ) : Force( system )
 {
 	torque.Set( 0.0, 0.0, 0.0 );
+	threadSafe = true;
 }
 
 /*virtual*/ ParticleSystem::TorqueForce::~TorqueForce( void )
@@ -430,15 +753,13 @@ ParticleSystem::TorqueForce::TorqueForce( ParticleSystem* system ) : Force( syst
 	Vector position;
 	particle->GetPosition( position );
 
-	Vector vector;
-	vector.Subtract( position, system->centerOfMass );
-
-	// TODO: Look this up in a textbook to verify its correctness.
-	Vector torqueForce;
-	torqueForce.Cross( torque, vector );
-	torqueForce.Scale( 1.0 / vector.Dot( vector ) );
+	ApplyTorque( torque, position, system->centerOfMass, particle->netForce );
+}
 
-	particle->netForce.Add( torqueForce );
+/*virtual*/ void ParticleSystem::TorqueForce::Apply( ParticleArray& particleArray, int begin, int end )
+{
+	for( int i = begin; i < end; i++ )
+		ApplyTorque( torque, ( *particleArray.positionArray )[i], system->centerOfMass, ( *particleArray.netForceArray )[i] );
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -523,6 +844,206 @@ void ParticleSystem::SpringForce::ResetEquilibriumLength( void )
 	}
 }
 
+//-------------------------------------------------------------------------------------------------
+//                                           NeighborForce
+//-------------------------------------------------------------------------------------------------
+
+ParticleSystem::NeighborForce::NeighborForce( ParticleSystem* system ) : Force( system )
+{
+	radius = 1.0;
+	threadSafe = true;
+}
+
+/*virtual*/ ParticleSystem::NeighborForce::~NeighborForce( void )
+{
+}
+
+/*virtual*/ void ParticleSystem::NeighborForce::Apply( void )
+{
+	// This is checked here, rather than only on the worker threads, so that the exception reaches the caller.
+	if( system->particleArray->GetCount() > 0 )
+		CheckSpatialHash( *system->particleArray );
+
+	Force::Apply();
+}
+
+/*virtual*/ void ParticleSystem::NeighborForce::Apply( ParticleArray& particleArray, int begin, int end )
+{
+	if( begin >= end )
+		return;
+
+	CheckSpatialHash( particleArray );
+
+	const SpatialHash& spatialHash = *system->spatialHash;
+	std::vector< int > neighborIndexArray;
+
+	for( int i = begin; i < end; i++ )
+	{
+		neighborIndexArray.clear();
+		spatialHash.FindNeighbors( ( *particleArray.positionArray )[i], radius, neighborIndexArray );
+
+		// The particle finds itself, and is left out.
+		int neighborCount = 0;
+		for( int j = 0; j < ( signed )neighborIndexArray.size(); j++ )
+			if( neighborIndexArray[j] != i )
+				neighborIndexArray[ neighborCount++ ] = neighborIndexArray[j];
+
+		if( neighborCount > 0 )
+			Apply( particleArray, i, &neighborIndexArray[0], neighborCount );
+	}
+}
+
+/*virtual*/ void ParticleSystem::NeighborForce::Apply( ParticleArray& particleArray, int index, const int* neighborIndexArray, int neighborCount )
+{
+}
+
+/*virtual*/ double ParticleSystem::NeighborForce::GetNeighborhoodRadius( void ) const
+{
+	return radius;
+}
+
+void ParticleSystem::NeighborForce::CheckSpatialHash( const ParticleArray& particleArray ) const
+{
+	// The hash is only good for the particles it was built over, and can only find neighbors as far away as its cell size.
+	const SpatialHash& spatialHash = *system->spatialHash;
+
+	if( spatialHash.GetPointCount() != particleArray.GetCount() )
+		throw new Exception( "The spatial hash was not built over the given particle array." );
+
+	if( radius > spatialHash.GetCellSize() )
+		throw new Exception( "The neighbor force radius exceeds the spatial hash cell size." );
+}
+
+//-------------------------------------------------------------------------------------------------
+//                                           RepulsionForce
+//-------------------------------------------------------------------------------------------------
+
+ParticleSystem::RepulsionForce::RepulsionForce( ParticleSystem* system ) : NeighborForce( system )
+{
+	strength = 1.0;
+}
+
+/*virtual*/ ParticleSystem::RepulsionForce::~RepulsionForce( void )
+{
+}
+
+/*virtual*/ void ParticleSystem::RepulsionForce::Apply( ParticleArray& particleArray, int index, const int* neighborIndexArray, int neighborCount )
+{
+	const Vector* position = &( *particleArray.positionArray )[0];
+	Vector& netForce = ( *particleArray.netForceArray )[ index ];
+
+	for( int k = 0; k < neighborCount; k++ )
+	{
+		Vector vector;
+		vector.Subtract( position[ index ], position[ neighborIndexArray[k] ] );
+
+		// Coincident particles have no direction to be pushed in.
+		double length = vector.Length();
+		if( length == 0.0 )
+			continue;
+
+		netForce.AddScale( vector, strength * ( 1.0 - length / radius ) / length );
+	}
+}
+
+//-------------------------------------------------------------------------------------------------
+//                                         SpringNetworkForce
+//-------------------------------------------------------------------------------------------------
+
+ParticleSystem::SpringNetworkForce::SpringNetworkForce( ParticleSystem* system ) : Force( system )
+{
+	springArray = new std::vector< Spring >;
+	forceBufferArray = new std::vector< VectorArray >;
+}
+
+/*virtual*/ ParticleSystem::SpringNetworkForce::~SpringNetworkForce( void )
+{
+	delete springArray;
+	delete forceBufferArray;
+}
+
+bool ParticleSystem::SpringNetworkForce::AddSpring( ParticleId particleIdA, ParticleId particleIdB, double stiffness /*= 1.0*/ )
+{
+	const ParticleArray& particleArray = *system->particleArray;
+
+	int i = particleArray.GetIndex( particleIdA );
+	int j = particleArray.GetIndex( particleIdB );
+	if( i < 0 || j < 0 )
+		return false;
+
+	Vector vector;
+	vector.Subtract( ( *particleArray.positionArray )[j], ( *particleArray.positionArray )[i] );
+
+	Spring spring;
+	spring.endPointParticleIds[0] = particleIdA;
+	spring.endPointParticleIds[1] = particleIdB;
+	spring.equilibriumLength = vector.Length();
+	spring.stiffness = stiffness;
+	springArray->push_back( spring );
+
+	return true;
+}
+
+/*virtual*/ void ParticleSystem::SpringNetworkForce::Apply( void )
+{
+	ParticleArray& particleArray = *system->particleArray;
+	int particleCount = particleArray.GetCount();
+	int springCount = ( int )springArray->size();
+	if( particleCount == 0 || springCount == 0 )
+		return;
+
+	int threads = system->GetThreadCount( springCount );
+	if( threads < 2 )
+	{
+		AccumulateSprings( 0, springCount, &( *particleArray.netForceArray )[0] );
+		return;
+	}
+
+	forceBufferArray->resize( threads );
+
+	ForEachRange( threads, springCount, [ this, particleCount ]( int thread, int begin, int end ) {
+		VectorArray& forceBuffer = ( *forceBufferArray )[ thread ];
+		forceBuffer.resize( particleCount );
+		VectorKernels::Fill( &forceBuffer[0], Vector( 0.0, 0.0, 0.0 ), particleCount );
+		AccumulateSprings( begin, end, &forceBuffer[0] );
+	} );
+
+	// The buffers are added in the same order for every particle, so the result doesn't depend on
+	// how the particles are split here, only on how the springs were.
+	ForEachRange( system->GetThreadCount( particleCount ), particleCount, [ this, &particleArray, threads ]( int /*thread*/, int begin, int end ) {
+		Vector* netForce = &( *particleArray.netForceArray )[0];
+		for( int i = 0; i < threads; i++ )
+			VectorKernels::AddScale( netForce + begin, &( *forceBufferArray )[i][ begin ], 1.0, end - begin );
+	} );
+}
+
+void ParticleSystem::SpringNetworkForce::AccumulateSprings( int begin, int end, Vector* forceBuffer ) const
+{
+	const ParticleArray& particleArray = *system->particleArray;
+	const Vector* position = &( *particleArray.positionArray )[0];
+
+	for( int k = begin; k < end; k++ )
+	{
+		const Spring& spring = ( *springArray )[k];
+
+		int i = particleArray.GetIndex( spring.endPointParticleIds[0] );
+		int j = particleArray.GetIndex( spring.endPointParticleIds[1] );
+		if( i < 0 || j < 0 )
+			continue;
+
+		Vector vector;
+		vector.Subtract( position[j], position[i] );
+
+		double length = vector.Length();
+
+		Vector springForce;
+		springForce.SetScaled( vector, spring.stiffness * ( length - spring.equilibriumLength ) );
+
+		forceBuffer[i].Add( springForce );
+		forceBuffer[j].Subtract( springForce );
+	}
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                            FrictionForce
 //-------------------------------------------------------------------------------------------------
@@ -530,6 +1051,7 @@ void ParticleSystem::SpringForce::ResetEquilibriumLength( void )
 ParticleSystem::FrictionForce::FrictionForce( ParticleSystem* system ) : Force( system )
 {
 	particleHandle = 0;
+	particleId = ParticleArray::INVALID_ID;
 	contactUnitNormal.Set( 0.0, 0.0, 0.0 );
 	netForceAtImpact.Set( 0.0, 0.0, 0.0 );
 	friction = 0.0;
@@ -542,27 +1064,28 @@ ParticleSystem::FrictionForce::FrictionForce( ParticleSystem* system ) : Force(
 
 /*virtual*/ void ParticleSystem::FrictionForce::Apply( void )
 {
+	if( particleId != ParticleArray::INVALID_ID )
+	{
+		int i = system->particleArray->GetIndex( particleId );
+		if( i >= 0 )
+			Apply( ( *system->particleArray->positionArray )[i], ( *system->particleArray->previousPositionArray )[i], ( *system->particleArray->netForceArray )[i] );
+		return;
+	}
+
 	Particle* particle = ( Particle* )HandleObject::Dereference( particleHandle );
 	if( particle )
 	{
-		// TODO: Get out the physics book and check this math.
-
-		double normalForce = contactUnitNormal.Dot( netForceAtImpact );
-		if( normalForce <= 0.0 )
-		{
-			Vector position;
-			particle->GetPosition( position );
-
-			Vector frictionForce;
-			frictionForce.Subtract( particle->previousPosition, position );
-			frictionForce.Normalize();
-			frictionForce.Scale( -friction * normalForce );
-
-			particle->netForce.Add( frictionForce );
-		}
+		Vector position;
+		particle->GetPosition( position );
+		Apply( position, particle->previousPosition, particle->netForce );
 	}
 }
 
+void ParticleSystem::FrictionForce::Apply( const Vector& position, const Vector& previousPosition, Vector& netForce ) const
+{
+	ApplyFriction( netForceAtImpact, contactUnitNormal, friction, position, previousPosition, netForce );
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                            CollisionObject
 //-------------------------------------------------------------------------------------------------
@@ -576,6 +1099,15 @@ ParticleSystem::CollisionObject::CollisionObject( void )
 {
 }
 
+/*virtual*/ void ParticleSystem::CollisionObject::Update( void )
+{
+}
+
+/*virtual*/ bool ParticleSystem::CollisionObject::GetBoundingBox( AxisAlignedBox& boundingBox ) const
+{
+	return false;
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                            CollisionPlane
 //-------------------------------------------------------------------------------------------------
@@ -608,56 +1140,175 @@ ParticleSystem::ConvexTriangleMeshCollisionObject::ConvexTriangleMeshCollisionOb
 {
 	mesh = nullptr;
 	boundingBox = nullptr;
+	transform = nullptr;
+
+	facePlaneArray = new std::vector< Plane >;
+	facePlaneBlockArray = new std::vector< PlaneBlock >;
+	meshBoundingBox = new AxisAlignedBox;
+	planeMeshVersion = 0;
+	planeTransform = new AffineTransform;
+	planeTransformUsed = false;
 }
 
 /*virtual*/ ParticleSystem::ConvexTriangleMeshCollisionObject::~ConvexTriangleMeshCollisionObject( void )
 {
+	delete facePlaneArray;
+	delete facePlaneBlockArray;
+	delete meshBoundingBox;
+	delete planeTransform;
 }
 
-/*virtual*/ bool ParticleSystem::ConvexTriangleMeshCollisionObject::ResolveCollision( const LineSegment& lineOfMotion, Vector& contactPosition, Vector& contactUnitNormal )
+// Transforms are compared exactly, since the planes of any other transform would differ in some bit.
+static inline bool TransformsAreEqual( const AffineTransform& transformA, const AffineTransform& transformB )
 {
-	if( boundingBox && !boundingBox->ContainsPoint( lineOfMotion.vertex[1] ) )
-		return false;
+	const Vector* vectorA[4] = { &transformA.linearTransform.xAxis, &transformA.linearTransform.yAxis, &transformA.linearTransform.zAxis, &transformA.translation };
+	const Vector* vectorB[4] = { &transformB.linearTransform.xAxis, &transformB.linearTransform.yAxis, &transformB.linearTransform.zAxis, &transformB.translation };
+
+	for( int i = 0; i < 4; i++ )
+		if( vectorA[i]->x != vectorB[i]->x || vectorA[i]->y != vectorB[i]->y || vectorA[i]->z != vectorB[i]->z )
+			return false;
+
+	return true;
+}
 
+// This costs a comparison of a dozen numbers rather than a look at the whole mesh, but it misses a
+// change made to the mesh's arrays directly unless the mesh is told of it with MarkChanged.
+bool ParticleSystem::ConvexTriangleMeshCollisionObject::PlanesAreStale( void ) const
+{
+	if( planeMeshVersion != mesh->GetVersion() )
+		return true;
+
+	if( planeTransformUsed != ( transform != nullptr ) )
+		return true;
+
+	return transform && !TransformsAreEqual( *transform, *planeTransform );
+}
+
+/*virtual*/ void ParticleSystem::ConvexTriangleMeshCollisionObject::Update( void )
+{
 	if( !mesh )
-		return false;
+	{
+		facePlaneArray->clear();
+		facePlaneBlockArray->clear();
+		planeMeshVersion = 0;
+		return;
+	}
+
+	if( !PlanesAreStale() )
+		return;
 
-	int count = 0;
+	planeMeshVersion = mesh->GetVersion();
+	planeTransformUsed = ( transform != nullptr );
+	if( transform )
+		*planeTransform = *transform;
+
+	facePlaneArray->clear();
+	facePlaneBlockArray->clear();
+
+	bool haveBounds = false;
 
 	for( IndexTriangleList::const_iterator iter = mesh->triangleList->cbegin(); iter != mesh->triangleList->cend(); iter++ )
 	{
 		const IndexTriangle& indexTriangle = *iter;
-		
+
+		Triangle triangle;
+		if( !indexTriangle.GetTriangle( triangle, mesh->vertexArray ) )
+			continue;
+
+		for( int i = 0; i < 3; i++ )
+		{
+			if( transform )
+				transform->Transform( triangle.vertex[i] );
+
+			if( !haveBounds )
+				*meshBoundingBox = AxisAlignedBox( triangle.vertex[i], triangle.vertex[i] );
+			else
+				meshBoundingBox->GrowToIncludePoint( triangle.vertex[i] );
+
+			haveBounds = true;
+		}
+
+		// A degenerate triangle has no plane, and, having no area, bounds nothing.
+		if( triangle.IsDegenerate() )
+			continue;
+
 		Plane plane;
-		indexTriangle.GetPlane( plane, mesh->vertexArray );
+		triangle.GetPlane( plane );
 
-		if( Plane::SIDE_BACK == plane.GetSide( lineOfMotion.vertex[1], 0.0 ) )
-			count++;
+		// The triangles of a polygonal face all give the same plane, which need only be tested once.
+		int i;
+		for( i = 0; i < ( signed )facePlaneArray->size(); i++ )
+			if( ( *facePlaneArray )[i].IsEqualTo( plane ) )
+				break;
+
+		if( i < ( signed )facePlaneArray->size() )
+			continue;
+
+		facePlaneArray->push_back( plane );
+
+		if( facePlaneBlockArray->size() == 0 || !facePlaneBlockArray->back().Add( plane ) )
+		{
+			facePlaneBlockArray->push_back( PlaneBlock() );
+			facePlaneBlockArray->back().Add( plane );
+		}
 	}
+}
 
-	if( count < ( signed )mesh->triangleList->size() )
+/*virtual*/ bool ParticleSystem::ConvexTriangleMeshCollisionObject::GetBoundingBox( AxisAlignedBox& boundingBox ) const
+{
+	if( facePlaneArray->size() == 0 )
 		return false;
 
-	double smallestDistance = -1.0;
+	// Points on the faces count as inside them.
+	boundingBox.negCorner.Set( meshBoundingBox->negCorner.x - EPSILON, meshBoundingBox->negCorner.y - EPSILON, meshBoundingBox->negCorner.z - EPSILON );
+	boundingBox.posCorner.Set( meshBoundingBox->posCorner.x + EPSILON, meshBoundingBox->posCorner.y + EPSILON, meshBoundingBox->posCorner.z + EPSILON );
+	return true;
+}
 
-	for( IndexTriangleList::const_iterator iter = mesh->triangleList->cbegin(); iter != mesh->triangleList->cend(); iter++ )
+// The point must be behind every face; the nearest face is then the one it's least far behind.
+// Both are found in one pass over the planes, four at a time.
+/*virtual*/ bool ParticleSystem::ConvexTriangleMeshCollisionObject::ResolveCollision( const LineSegment& lineOfMotion, Vector& contactPosition, Vector& contactUnitNormal )
+{
+	if( boundingBox && !boundingBox->ContainsPoint( lineOfMotion.vertex[1] ) )
+		return false;
+
+	if( !mesh )
+		return false;
+
+	// The planes are normally made by the system at the start of a step, but this may be called on its own.
+	if( planeMeshVersion == 0 )
+		Update();
+
+	int blockCount = ( int )facePlaneBlockArray->size();
+	if( blockCount == 0 )
+		return false;
+
+	const PlaneBlock* block = &( *facePlaneBlockArray )[0];
+	double largestDistance = -HUGE_VAL;
+	int nearestPlane = -1;
+
+	for( int i = 0; i < blockCount; i++ )
 	{
-		const IndexTriangle& indexTriangle = *iter;
-		
-		Plane plane;
-		indexTriangle.GetPlane( plane, mesh->vertexArray );
+		double distanceArray[ PlaneBlock::SIZE ];
+		int backMask = block[i].Distance( lineOfMotion.vertex[1], distanceArray );
+		if( backMask != ( 1 << block[i].count ) - 1 )
+			return false;
 
-		Vector nearestPointOnPlane = lineOfMotion.vertex[1];
-		plane.NearestPoint( nearestPointOnPlane );
-		double distance = lineOfMotion.vertex[1].Distance( nearestPointOnPlane );
-		if( smallestDistance < 0.0 || distance < smallestDistance )
+		for( int j = 0; j < block[i].count; j++ )
 		{
-			smallestDistance = distance;
-			contactPosition = nearestPointOnPlane;
-			contactUnitNormal = plane.normal;
+			if( distanceArray[j] > largestDistance )
+			{
+				largestDistance = distanceArray[j];
+				nearestPlane = i * PlaneBlock::SIZE + j;
+			}
 		}
 	}
 
+	const Plane& plane = ( *facePlaneArray )[ nearestPlane ];
+
+	contactPosition = lineOfMotion.vertex[1];
+	plane.NearestPoint( contactPosition );
+	contactUnitNormal = plane.normal;
 	return true;
 }
 
@@ -675,14 +1326,20 @@ ParticleSystem::BoundingBoxTreeCollisionObject::BoundingBoxTreeCollisionObject(
 {
 }
 
+// A swept test catches a particle however fast it moves; the nearest-triangle test remains for one
+// that starts at or just behind a surface, such as one resting on it, which the swept test can miss.
 /*virtual*/ bool ParticleSystem::BoundingBoxTreeCollisionObject::ResolveCollision( const LineSegment& lineOfMotion, Vector& contactPosition, Vector& contactUnitNormal )
 {
 	if( !boxTree )
 		return false;
 
+	double timeOfImpact;
 	const Triangle* nearestTriangle = nullptr;
-	if( !boxTree->FindNearestTriangle( lineOfMotion.vertex[1], nearestTriangle, detectionDistance ) )
-		return false;
+	if( !FindTimeOfImpact( lineOfMotion, timeOfImpact, nearestTriangle ) )
+	{
+		if( !boxTree->FindNearestTriangle( lineOfMotion.vertex[1], nearestTriangle, detectionDistance ) )
+			return false;
+	}
 
 	Plane plane;
 	nearestTriangle->GetPlane( plane );
@@ -697,6 +1354,45 @@ ParticleSystem::BoundingBoxTreeCollisionObject::BoundingBoxTreeCollisionObject(
 	return true;
 }
 
+bool ParticleSystem::BoundingBoxTreeCollisionObject::FindTimeOfImpact( const LineSegment& lineOfMotion, double& timeOfImpact, const Triangle*& triangle ) const
+{
+	if( !boxTree )
+		return false;
+
+	Ray ray( lineOfMotion );
+	double tMin = 0.0;
+
+	// A particle leaving through the back of a triangle isn't stopped by it, but may yet hit
+	// something further on, so the search resumes past such a crossing a few times.
+	for( int i = 0; i < 4; i++ )
+	{
+		timeOfImpact = 1.0;
+		if( !boxTree->FindFirstIntersection( ray, tMin, timeOfImpact, triangle ) )
+			return false;
+
+		Vector normal;
+		triangle->GetNormal( normal );
+		if( normal.Dot( ray.direction ) < 0.0 )
+			return true;
+
+		tMin = timeOfImpact + EPSILON;
+	}
+
+	return false;
+}
+
+/*virtual*/ bool ParticleSystem::BoundingBoxTreeCollisionObject::GetBoundingBox( AxisAlignedBox& boundingBox ) const
+{
+	if( !boxTree || !boxTree->GetBoundingBox( boundingBox ) )
+		return false;
+
+	// No triangle further than the detection distance from a point is found for it.
+	double margin = detectionDistance + EPSILON;
+	boundingBox.negCorner.Set( boundingBox.negCorner.x - margin, boundingBox.negCorner.y - margin, boundingBox.negCorner.z - margin );
+	boundingBox.posCorner.Set( boundingBox.posCorner.x + margin, boundingBox.posCorner.y + margin, boundingBox.posCorner.z + margin );
+	return true;
+}
+
 //-------------------------------------------------------------------------------------------------
 //                                                Emitter
 //-------------------------------------------------------------------------------------------------
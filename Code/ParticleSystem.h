@@ -8,14 +8,19 @@
 #include "Random.h"
 #include "LineSegment.h"
 #include "HandleObject.h"
+#include "ParticleArray.h"
+#include "SpatialHash.h"
+#include "ObjectPool.h"
 
 namespace _3DMath
 {
 	class ParticleSystem;
 	class LineSegment;
 	class TriangleMesh;
+	class AffineTransform;
 	class BoundingBoxTree;
 	class AxisAlignedBox;
+	class BoundingVolumeHierarchy;
 	class TimeKeeper;
 }
 
@@ -38,6 +43,10 @@ public:
 
 		virtual void Integrate( const _3DMath::TimeKeeper& timeKeeper, double damping = 0.0 );
 
+		// These come from the shared object pools, since many particles may be made and destroyed each step.
+		static void* operator new( size_t size ) { return ObjectPool::AllocateShared( size ); }
+		static void operator delete( void* pointer, size_t size ) { ObjectPool::FreeShared( pointer, size ); }
+
 		Vector velocity;
 		Vector acceleration;
 		Vector netForce;
@@ -81,12 +90,23 @@ public:
 		Force( ParticleSystem* system );
 		virtual ~Force( void );
 
+		// The default applies the force to each particle of the list, then to all of the system's particle array.
 		virtual void Apply( void );
 		virtual void Apply( Particle* particle );
+		virtual void Apply( ParticleArray& particleArray, int begin, int end );
+
+		// A force that looks at the particles around each particle returns how far it looks, so that
+		// the system knows to build its spatial hash, and with what cell size.
+		virtual double GetNeighborhoodRadius( void ) const;
+
+		// Transient forces come and go every step, so forces are pooled like particles.
+		static void* operator new( size_t size ) { return ObjectPool::AllocateShared( size ); }
+		static void operator delete( void* pointer, size_t size ) { ObjectPool::FreeShared( pointer, size ); }
 
 		ParticleSystem* system;
 		bool enabled;
 		bool transient;
+		bool threadSafe;	// Set this if Apply( ParticleArray&, begin, end ) may run on disjoint ranges at once.
 	};
 
 	class _3DMATH_API GenericForce : public Force
@@ -97,6 +117,7 @@ public:
 		virtual ~GenericForce( void );
 
 		virtual void Apply( Particle* particle ) override;
+		virtual void Apply( ParticleArray& particleArray, int begin, int end ) override;
 
 		Vector force;
 	};
@@ -109,6 +130,7 @@ public:
 		virtual ~WindForce( void );
 
 		virtual void Apply( Particle* particle ) override;
+		virtual void Apply( ParticleArray& particleArray, int begin, int end ) override;
 
 		Vector generalUnitDir;
 		double coneAngle;
@@ -123,6 +145,7 @@ public:
 		virtual ~ResistanceForce( void );
 
 		virtual void Apply( Particle* particle ) override;
+		virtual void Apply( ParticleArray& particleArray, int begin, int end ) override;
 
 		double resistance;
 	};
@@ -135,6 +158,7 @@ public:
 		virtual ~GravityForce( void );
 
 		virtual void Apply( Particle* particle ) override;
+		virtual void Apply( ParticleArray& particleArray, int begin, int end ) override;
 
 		Vector accelDueToGravity;
 	};
@@ -147,6 +171,7 @@ public:
 		virtual ~TorqueForce( void );
 
 		virtual void Apply( Particle* particle ) override;
+		virtual void Apply( ParticleArray& particleArray, int begin, int end ) override;
 
 		Vector torque;
 	};
@@ -163,11 +188,83 @@ public:
 
 		void ResetEquilibriumLength( void );
 
-		int endPointParticleHandles[2];
+		ObjectHandle endPointParticleHandles[2];
 		double equilibriumLength;
 		double stiffness;
 	};
 
+	// This is the base for forces between nearby particles of the system's particle array, such as
+	// repulsion, flocking or SPH pressure.  Each particle is handed the indices of the others within
+	// the radius, found with the system's spatial hash, so the cost grows with the particle count
+	// rather than its square.  Only the given particle's net force should be changed, which leaves
+	// the work free to be split across threads; a symmetric force is then found once from each side.
+	// Particles of the system's list are neither given this force nor seen as neighbors.  An exception
+	// is thrown if the spatial hash wasn't built over the given array, or the radius has grown past the
+	// hash's cell size since it was built, rather than silently missing neighbors.
+	class _3DMATH_API NeighborForce : public Force
+	{
+	public:
+
+		NeighborForce( ParticleSystem* system );
+		virtual ~NeighborForce( void );
+
+		virtual void Apply( void ) override;
+		virtual void Apply( ParticleArray& particleArray, int begin, int end ) override;
+		virtual void Apply( ParticleArray& particleArray, int index, const int* neighborIndexArray, int neighborCount );
+		virtual double GetNeighborhoodRadius( void ) const override;
+
+		double radius;
+
+	private:
+
+		void CheckSpatialHash( const ParticleArray& particleArray ) const;
+	};
+
+	// Particles closer than the radius push each other apart, with a strength falling linearly to zero at the radius.
+	class _3DMATH_API RepulsionForce : public NeighborForce
+	{
+	public:
+
+		RepulsionForce( ParticleSystem* system );
+		virtual ~RepulsionForce( void );
+
+		virtual void Apply( ParticleArray& particleArray, int index, const int* neighborIndexArray, int neighborCount ) override;
+
+		double strength;
+	};
+
+	// This holds many springs between particles of the system's particle array, which is far cheaper
+	// than a SpringForce each.  The springs are split across threads, each of which sums its forces
+	// into a buffer of its own, so that two threads never write the same particle; the buffers are
+	// then added to the particles' net forces, also split across threads.
+	class _3DMATH_API SpringNetworkForce : public Force
+	{
+	public:
+
+		SpringNetworkForce( ParticleSystem* system );
+		virtual ~SpringNetworkForce( void );
+
+		virtual void Apply( void ) override;
+
+		// The equilibrium length is taken from the particles' current positions.
+		bool AddSpring( ParticleId particleIdA, ParticleId particleIdB, double stiffness = 1.0 );
+
+		struct Spring
+		{
+			ParticleId endPointParticleIds[2];
+			double equilibriumLength;
+			double stiffness;
+		};
+
+		std::vector< Spring >* springArray;
+
+	private:
+
+		void AccumulateSprings( int begin, int end, Vector* forceBuffer ) const;
+
+		std::vector< VectorArray >* forceBufferArray;
+	};
+
 	class _3DMATH_API FrictionForce : public Force
 	{
 	public:
@@ -177,7 +274,10 @@ public:
 
 		virtual void Apply( void ) override;
 
-		int particleHandle;
+		void Apply( const Vector& position, const Vector& previousPosition, Vector& netForce ) const;
+
+		ObjectHandle particleHandle;
+		ParticleId particleId;		// This is used instead of the handle for a particle of the system's particle array.
 		Vector netForceAtImpact;
 		Vector contactUnitNormal;
 		double friction;
@@ -192,6 +292,13 @@ public:
 
 		virtual bool ResolveCollision( const LineSegment& lineOfMotion, Vector& contactPosition, Vector& contactUnitNormal ) = 0;
 
+		// This is called once a step before any collisions are resolved, so that an object can cache what it derives from its geometry.
+		virtual void Update( void );
+
+		// No collision is resolved for a line of motion whose box doesn't overlap this one.  False
+		// is returned by objects with no bounds, which are tried against every particle.
+		virtual bool GetBoundingBox( AxisAlignedBox& boundingBox ) const;
+
 		double friction;
 	};
 
@@ -215,9 +322,26 @@ public:
 		virtual ~ConvexTriangleMeshCollisionObject( void );
 
 		virtual bool ResolveCollision( const LineSegment& lineOfMotion, Vector& contactPosition, Vector& contactUnitNormal ) override;
+		virtual void Update( void ) override;
+		virtual bool GetBoundingBox( AxisAlignedBox& boundingBox ) const override;
 
-		AxisAlignedBox* boundingBox;	// It is up to the user to keep this bounding box in sync with the mesh.
+		AxisAlignedBox* boundingBox;	// This is optional now that the mesh's own bounds are tracked; if given, it is up to the user to keep it in sync with the mesh.
 		TriangleMesh* mesh;	// We assume the mesh forms a convex shape; if it doesn't, the behavior is left undefined.
+		AffineTransform* transform;		// If given, this takes the mesh into world space.
+
+	private:
+
+		bool PlanesAreStale( void ) const;
+
+		// The faces' planes, less duplicates from coplanar triangles, are derived from the mesh and
+		// transform by Update, and again only once the mesh's version or the transform changes.  The
+		// blocks hold the same planes as the array, in the same order.
+		std::vector< Plane >* facePlaneArray;
+		std::vector< PlaneBlock >* facePlaneBlockArray;
+		AxisAlignedBox* meshBoundingBox;
+		uint64_t planeMeshVersion;				// This is zero if there are no planes yet.
+		AffineTransform* planeTransform;		// This is a copy of the transform the planes were made with.
+		bool planeTransformUsed;
 	};
 
 	class _3DMATH_API BoundingBoxTreeCollisionObject : public CollisionObject
@@ -228,9 +352,14 @@ public:
 		virtual ~BoundingBoxTreeCollisionObject( void );
 
 		virtual bool ResolveCollision( const LineSegment& lineOfMotion, Vector& contactPosition, Vector& contactUnitNormal ) override;
+		virtual bool GetBoundingBox( AxisAlignedBox& boundingBox ) const override;
+
+		// This is the earliest time, as a fraction of the line of motion, at which it crosses a
+		// triangle from the triangle's front, however far it moves in a step.
+		bool FindTimeOfImpact( const LineSegment& lineOfMotion, double& timeOfImpact, const Triangle*& triangle ) const;
 
 		BoundingBoxTree* boxTree;
-		double detectionDistance;
+		double detectionDistance;	// This now only matters for particles that start a step at or behind a surface.
 	};
 
 	class _3DMATH_API Emitter : public HandleObject
@@ -241,6 +370,10 @@ public:
 		virtual ~Emitter( void );
 
 		virtual void EmitParticles( ParticleSystem* system, double currentTime ) = 0;
+
+		// Emitters share the particles' and forces' pools.
+		static void* operator new( size_t size ) { return ObjectPool::AllocateShared( size ); }
+		static void operator delete( void* pointer, size_t size ) { ObjectPool::FreeShared( pointer, size ); }
 	};
 
 	void Clear( void );
@@ -252,15 +385,29 @@ public:
 	typedef std::list< CollisionObject* > CollisionObjectList;
 	typedef std::list< Emitter* > EmitterList;
 
+	// Particles that need no behavior of their own are best kept here rather than in the list;
+	// they take part in every phase of a step the same way, but without a heap object each.
+	ParticleArray* particleArray;
+
+	// This is rebuilt over the particle array's positions each step that some force asks for it,
+	// with the largest neighborhood radius of the forces as its cell size.
+	SpatialHash* spatialHash;
+
 	ParticleList* particleList;
 	ForceList* forceList;
 	CollisionObjectList* collisionObjectList;
 	EmitterList* emitterList;
 
 	double damping;
+	int subSteps;		// Verlet steps per time step for the particle array.
+	int threadCount;			// Zero means use the hardware concurrency.
+	int minParticlesPerThread;	// Work smaller than twice this is never split.
 	Vector centerOfMass;
 	Random random;
 
+	// This is how many threads to split the given amount of work across, per the two settings above.
+	int GetThreadCount( int workCount ) const;
+
 private:
 
 	void CullDeadParticles( const _3DMath::TimeKeeper& timeKeeper );
@@ -268,7 +415,39 @@ private:
 	void AccumulateForces( void );
 	void IntegrateParticles( const _3DMath::TimeKeeper& timeKeeper );
 	void ResolveCollisions( void );
+	void BuildCollisionHierarchy( void );
+	int FindCollisionCandidates( const LineSegment& lineOfMotion, std::vector< int >& candidateArray ) const;
 	void CalculateCenterOfMass( void );
+	void BuildSpatialHash( void );
+	void ApplyContactFriction( void );
+
+	// Scratch space for gathering particle state into flat arrays for the batch kernels.
+	VectorArray* positionArray;
+	std::vector< double >* massArray;
+
+	// The collision objects are put in an array, in list order, each step; the bounded ones are put in
+	// a hierarchy by their boxes, and the rest are tried against every particle.
+	std::vector< CollisionObject* >* collisionObjectArray;
+	std::vector< AxisAlignedBox >* collisionBoxArray;
+	std::vector< int >* boundedCollisionIndexArray;		// The collision object of each box.
+	std::vector< int >* unboundedCollisionIndexArray;
+	BoundingVolumeHierarchy* collisionHierarchy;
+
+	// Each contact with friction found while resolving collisions is applied as a force the next
+	// step, then forgotten.  The array only grows, and is reset by zeroing the count.
+	struct Contact
+	{
+		ObjectHandle particleHandle;
+		ParticleId particleId;		// This is used instead of the handle for a particle of the system's particle array.
+		Vector netForceAtImpact;
+		Vector contactUnitNormal;
+		double friction;
+	};
+
+	Contact* AddContact( void );
+
+	std::vector< Contact >* contactArray;
+	int contactCount;
 };
 
 // ParticleSystem.h
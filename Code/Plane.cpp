@@ -5,9 +5,20 @@
 #include "Line.h"
 #include "AffineTransform.h"
 #include "Matrix4x4.h"
+#include "BatchTransform.h"
+#include "Simd.h"
 
 using namespace _3DMath;
 
+static inline bool UseAVX2( void )
+{
+	return BatchTransform::GetSupportedInstructions() == BatchTransform::INSTRUCTIONS_AVX2;
+}
+
+//---------------------------------------------------------------------
+//                                Plane
+//---------------------------------------------------------------------
+
 Plane::Plane( void )
 {
 	normal.Set( 0.0, 0.0, 1.0 );
@@ -228,4 +239,95 @@ bool Plane::FitToPoints( const VectorList& vectorList ) // TODO: Debug this rout
 	return true;
 }
 
-// Plane.cpp
\ No newline at end of file
+//---------------------------------------------------------------------
+//                              PlaneBlock
+//---------------------------------------------------------------------
+
+#if defined _3DMATH_X86
+
+// The products are summed in the order Vector::Dot sums them, and without fused multiply-adds, so
+// that the distances are those of Plane::Distance.
+_3DMATH_TARGET_AVX2_NOFMA static int DistanceAVX2( const PlaneBlock& block, const Vector& point, double* distanceArray )
+{
+	__m256d distance = _mm256_mul_pd( _mm256_set1_pd( point.x ), _mm256_loadu_pd( block.normal[0] ) );
+	distance = _mm256_add_pd( distance, _mm256_mul_pd( _mm256_set1_pd( point.y ), _mm256_loadu_pd( block.normal[1] ) ) );
+	distance = _mm256_add_pd( distance, _mm256_mul_pd( _mm256_set1_pd( point.z ), _mm256_loadu_pd( block.normal[2] ) ) );
+	distance = _mm256_sub_pd( distance, _mm256_loadu_pd( block.centerDotNormal ) );
+
+	int usedMask = ( 1 << block.count ) - 1;
+	__m256d used = _mm256_castsi256_pd( _mm256_cmpgt_epi64( _mm256_set1_epi64x( block.count ), _mm256_setr_epi64x( 0, 1, 2, 3 ) ) );
+	distance = _mm256_blendv_pd( _mm256_set1_pd( -HUGE_VAL ), distance, used );
+
+	_mm256_storeu_pd( distanceArray, distance );
+
+	return _mm256_movemask_pd( _mm256_cmp_pd( distance, _mm256_setzero_pd(), _CMP_LT_OQ ) ) & usedMask;
+}
+
+#endif //_3DMATH_X86
+
+PlaneBlock::PlaneBlock( void )
+{
+	Clear();
+}
+
+PlaneBlock::~PlaneBlock( void )
+{
+}
+
+void PlaneBlock::Clear( void )
+{
+	for( int j = 0; j < SIZE; j++ )
+	{
+		for( int i = 0; i < 3; i++ )
+			normal[i][j] = 0.0;
+
+		centerDotNormal[j] = 0.0;
+	}
+
+	count = 0;
+}
+
+bool PlaneBlock::Add( const Plane& plane )
+{
+	if( count == SIZE )
+		return false;
+
+	normal[0][ count ] = plane.normal.x;
+	normal[1][ count ] = plane.normal.y;
+	normal[2][ count ] = plane.normal.z;
+	centerDotNormal[ count ] = plane.centerDotNormal;
+
+	count++;
+	return true;
+}
+
+int PlaneBlock::Distance( const Vector& point, double* distanceArray ) const
+{
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		return DistanceAVX2( *this, point, distanceArray );
+#endif
+
+	int backMask = 0;
+
+	for( int i = 0; i < SIZE; i++ )
+	{
+		if( i >= count )
+		{
+			distanceArray[i] = -HUGE_VAL;
+			continue;
+		}
+
+		Plane plane;
+		plane.normal.Set( normal[0][i], normal[1][i], normal[2][i] );
+		plane.centerDotNormal = centerDotNormal[i];
+
+		distanceArray[i] = plane.Distance( point );
+		if( distanceArray[i] < 0.0 )
+			backMask |= 1 << i;
+	}
+
+	return backMask;
+}
+
+// Plane.cpp
@@ -9,6 +9,7 @@
 namespace _3DMath
 {
 	class Plane;
+	class PlaneBlock;
 	class LineSegment;
 	class Line;
 	class AffineTransform;
@@ -49,6 +50,32 @@ public:
 	double centerDotNormal;
 };
 
+// This holds up to SIZE planes, one component per array, so that a point can be measured against
+// all of them at once with AVX2, as when testing it against the faces of a convex shape.
+class _3DMATH_API _3DMath::PlaneBlock
+{
+public:
+
+	enum { SIZE = 4 };
+
+	PlaneBlock( void );
+	~PlaneBlock( void );
+
+	void Clear( void );
+
+	// False is returned if the block is full.
+	bool Add( const Plane& plane );
+
+	// Plane i's signed distance to the point goes in distanceArray[i], bit for bit what Plane::Distance
+	// gives, and -HUGE_VAL goes in the unused slots.  Bit i of the result is set if the point is
+	// behind plane i, which is to say, if its distance is negative.
+	int Distance( const Vector& point, double* distanceArray ) const;
+
+	double normal[3][SIZE];
+	double centerDotNormal[SIZE];
+	int count;
+};
+
 namespace _3DMath
 {
 	typedef std::list< Plane > PlaneList;
@@ -9,6 +9,8 @@
 #include "Graph.h"
 #include "Exception.h"
 #include "ListFunctions.h"
+#include "VectorKernels.h"
+#include "Predicates.h"
 
 using namespace _3DMath;
 
@@ -58,8 +60,8 @@ bool Polygon::GetPlane( Plane& plane ) const
 void Polygon::GetCenter( Vector& center ) const
 {
 	center.Set( 0.0, 0.0, 0.0 );
-	for( int i = 0; i < ( signed )vertexArray->size(); i++ )
-		center.Add( ( *vertexArray )[i] );
+	if( vertexArray->size() > 0 )
+		VectorKernels::Sum( &( *vertexArray )[0], ( int )vertexArray->size(), center );
 	center.Scale( 1.0 / double( vertexArray->size() ) );
 }
 
@@ -320,7 +322,8 @@ bool Polygon::SplitInTwoAgainstSurface( const Surface* surface, Polygon*& polygo
 	if( insideCount == 0 || outsideCount == 0 || intersectionArray.size() < 2 )
 		return false;
 
-	if( !Tessellate() )	// TODO: Tessellation sometimes fails when it shouldn't.  Fix it.
+	// The EPSILON tests can reject every ear of a nearly degenerate polygon; the exact ones can't.
+	if( !Tessellate() && !Tessellate( true ) )
 		return false;
 
 	_3DMath::Plane plane;
@@ -473,12 +476,22 @@ double Polygon::GetArea( void ) const
 	return totalArea;
 }
 
-bool Polygon::Tessellate( void ) const
+bool Polygon::Tessellate( bool robust /*= false*/ ) const
 {
 	Plane plane;
 	if( !GetPlane( plane ) )
 		return false;
 
+	// The exact tests work in the coordinate plane most nearly parallel to the polygon.
+	int dropAxis = 2;
+	if( fabs( plane.normal.x ) >= fabs( plane.normal.y ) && fabs( plane.normal.x ) >= fabs( plane.normal.z ) )
+		dropAxis = 0;
+	else if( fabs( plane.normal.y ) >= fabs( plane.normal.z ) )
+		dropAxis = 1;
+
+	double dropComponent = ( dropAxis == 0 ) ? plane.normal.x : ( ( dropAxis == 1 ) ? plane.normal.y : plane.normal.z );
+	double normalSign = ( dropComponent < 0.0 ) ? -1.0 : 1.0;
+
 	indexTriangleList->clear();
 
 	std::vector< int > indexArray;
@@ -498,13 +511,20 @@ bool Polygon::Tessellate( void ) const
 			Triangle triangle;
 			indexTriangle.GetTriangle( triangle, vertexArray );
 
-			Vector edge[2];
-			edge[0].Subtract( triangle.vertex[1], triangle.vertex[0] );
-			edge[1].Subtract( triangle.vertex[2], triangle.vertex[1] );
+			double dot;
+			if( robust )
+				dot = normalSign * Predicates::Orient2D( triangle.vertex[0], triangle.vertex[1], triangle.vertex[2], dropAxis );
+			else
+			{
+				Vector edge[2];
+				edge[0].Subtract( triangle.vertex[1], triangle.vertex[0] );
+				edge[1].Subtract( triangle.vertex[2], triangle.vertex[1] );
+
+				Vector cross;
+				cross.Cross( edge[0], edge[1] );
+				dot = cross.Dot( plane.normal );
+			}
 
-			Vector cross;
-			cross.Cross( edge[0], edge[1] );
-			double dot = cross.Dot( plane.normal );
 			if( dot < 0.0 )
 				continue;
 
@@ -513,7 +533,19 @@ bool Polygon::Tessellate( void ) const
 			{
 				if( j == i || j == ( i + 1 ) % indexArray.size() || j == ( i + 2 ) % indexArray.size() )
 					continue;
-				if( triangle.ContainsPoint( ( *vertexArray )[ indexArray[j] ] ) )
+
+				const Vector& point = ( *vertexArray )[ indexArray[j] ];
+				if( robust )
+				{
+					int k;
+					for( k = 0; k < 3; k++ )
+						if( normalSign * Predicates::Orient2D( triangle.vertex[k], triangle.vertex[ ( k + 1 ) % 3 ], point, dropAxis ) < 0.0 )
+							break;
+
+					if( k == 3 )
+						break;
+				}
+				else if( triangle.ContainsPoint( point ) )
 					break;
 			}
 
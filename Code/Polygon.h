@@ -27,7 +27,8 @@ public:
 	virtual ~Polygon( void );
 
 	bool SplitAgainstSurface( const Surface* surface, PolygonList& polygonList, double minDistance, double maxDistance, double eps = EPSILON ) const;
-	bool Tessellate( void ) const;
+	// The robust mode decides convexity and containment with exact predicates instead of EPSILON tests.
+	bool Tessellate( bool robust = false ) const;
 	bool GetPlane( Plane& plane ) const;
 	void GetCenter( Vector& center ) const;
 	bool GetTriangleAverageCenter( Vector& center ) const;
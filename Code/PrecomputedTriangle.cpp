@@ -0,0 +1,383 @@
+// PrecomputedTriangle.cpp
+
+#include "PrecomputedTriangle.h"
+#include "Triangle.h"
+#include "BatchTransform.h"
+#include "Simd.h"
+
+using namespace _3DMath;
+
+static inline bool UseAVX2( void )
+{
+	return BatchTransform::GetSupportedInstructions() == BatchTransform::INSTRUCTIONS_AVX2;
+}
+
+//---------------------------------------------------------------------
+//                         PrecomputedTriangle
+//---------------------------------------------------------------------
+
+PrecomputedTriangle::PrecomputedTriangle( void )
+{
+}
+
+PrecomputedTriangle::PrecomputedTriangle( const Triangle& triangle )
+{
+	Set( triangle );
+}
+
+PrecomputedTriangle::~PrecomputedTriangle( void )
+{
+}
+
+void PrecomputedTriangle::Set( const Triangle& triangle )
+{
+	vertex0 = triangle.vertex[0];
+	edge1.Subtract( triangle.vertex[1], triangle.vertex[0] );
+	edge2.Subtract( triangle.vertex[2], triangle.vertex[0] );
+	normal.Cross( edge1, edge2 );
+}
+
+// By Cramer's rule on v0 + u e1 + v e2 = o + t d, with the triple products rearranged around n = e1 x e2 and q = ( o - v0 ) x d.
+bool PrecomputedTriangle::IntersectRay( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin /*= 0.0*/, double tMax /*= HUGE_VAL*/ ) const
+{
+	double det = -direction.Dot( normal );
+	if( det == 0.0 )
+		return false;
+
+	Vector originVector, cross;
+	originVector.Subtract( origin, vertex0 );
+	cross.Cross( originVector, direction );
+
+	double invDet = 1.0 / det;
+	u = edge2.Dot( cross ) * invDet;
+	if( u < 0.0 || u > 1.0 )
+		return false;
+
+	v = -edge1.Dot( cross ) * invDet;
+	if( v < 0.0 || u + v > 1.0 )
+		return false;
+
+	t = originVector.Dot( normal ) * invDet;
+	return t >= tMin && t <= tMax;
+}
+
+//---------------------------------------------------------------------
+//                       PrecomputedTriangleBlock
+//---------------------------------------------------------------------
+
+#if defined _3DMATH_X86
+
+// Each lane does the arithmetic of Triangle::IntersectRayWatertight in the same order, without fused
+// multiply-adds, so that a hit on an edge shared by two triangles doesn't depend on the CPU.
+_3DMATH_TARGET_AVX2_NOFMA static int IntersectRayAVX2( const PrecomputedTriangleBlock& block, const Vector& origin, int kx, int ky, int kz, double shearX, double shearY, double shearZ, double& t, double& u, double& v, double tMin, double tMax )
+{
+	const double ( *vertex[3] )[ PrecomputedTriangleBlock::SIZE ] = { block.vertex0, block.vertex1, block.vertex2 };
+	double rayOrigin[3] = { origin.x, origin.y, origin.z };
+
+	__m256d sx = _mm256_set1_pd( shearX );
+	__m256d sy = _mm256_set1_pd( shearY );
+	__m256d sz = _mm256_set1_pd( shearZ );
+
+	__m256d x[3], y[3], z[3];
+	for( int i = 0; i < 3; i++ )
+	{
+		__m256d relativeX = _mm256_sub_pd( _mm256_loadu_pd( vertex[i][ kx ] ), _mm256_set1_pd( rayOrigin[ kx ] ) );
+		__m256d relativeY = _mm256_sub_pd( _mm256_loadu_pd( vertex[i][ ky ] ), _mm256_set1_pd( rayOrigin[ ky ] ) );
+		__m256d relativeZ = _mm256_sub_pd( _mm256_loadu_pd( vertex[i][ kz ] ), _mm256_set1_pd( rayOrigin[ kz ] ) );
+
+		x[i] = _mm256_sub_pd( relativeX, _mm256_mul_pd( sx, relativeZ ) );
+		y[i] = _mm256_sub_pd( relativeY, _mm256_mul_pd( sy, relativeZ ) );
+		z[i] = _mm256_mul_pd( sz, relativeZ );
+	}
+
+	__m256d weight0 = _mm256_sub_pd( _mm256_mul_pd( x[2], y[1] ), _mm256_mul_pd( y[2], x[1] ) );
+	__m256d weight1 = _mm256_sub_pd( _mm256_mul_pd( x[0], y[2] ), _mm256_mul_pd( y[0], x[2] ) );
+	__m256d weight2 = _mm256_sub_pd( _mm256_mul_pd( x[1], y[0] ), _mm256_mul_pd( y[1], x[0] ) );
+
+	__m256d zero = _mm256_setzero_pd();
+	__m256d negative = _mm256_or_pd( _mm256_cmp_pd( weight0, zero, _CMP_LT_OQ ), _mm256_or_pd( _mm256_cmp_pd( weight1, zero, _CMP_LT_OQ ), _mm256_cmp_pd( weight2, zero, _CMP_LT_OQ ) ) );
+	__m256d positive = _mm256_or_pd( _mm256_cmp_pd( weight0, zero, _CMP_GT_OQ ), _mm256_or_pd( _mm256_cmp_pd( weight1, zero, _CMP_GT_OQ ), _mm256_cmp_pd( weight2, zero, _CMP_GT_OQ ) ) );
+
+	__m256d det = _mm256_add_pd( _mm256_add_pd( weight0, weight1 ), weight2 );
+	__m256d invDet = _mm256_div_pd( _mm256_set1_pd( 1.0 ), det );
+
+	__m256d tt = _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( weight0, z[0] ), _mm256_mul_pd( weight1, z[1] ) ), _mm256_mul_pd( weight2, z[2] ) );
+	tt = _mm256_mul_pd( tt, invDet );
+
+	// Empty slots have a zero determinant, as do triangles seen edge on.
+	__m256d hit = _mm256_andnot_pd( _mm256_and_pd( negative, positive ), _mm256_cmp_pd( det, zero, _CMP_NEQ_OQ ) );
+	hit = _mm256_and_pd( hit, _mm256_cmp_pd( tt, _mm256_set1_pd( tMin ), _CMP_GE_OQ ) );
+	hit = _mm256_and_pd( hit, _mm256_cmp_pd( tt, _mm256_set1_pd( tMax ), _CMP_LE_OQ ) );
+
+	int hitMask = _mm256_movemask_pd( hit );
+	if( hitMask == 0 )
+		return -1;
+
+	double tArray[4], uArray[4], vArray[4];
+	_mm256_storeu_pd( tArray, tt );
+	_mm256_storeu_pd( uArray, _mm256_mul_pd( weight1, invDet ) );
+	_mm256_storeu_pd( vArray, _mm256_mul_pd( weight2, invDet ) );
+
+	int nearest = -1;
+	for( int i = 0; i < 4; i++ )
+		if( ( hitMask & ( 1 << i ) ) && ( nearest < 0 || tArray[i] < tArray[ nearest ] ) )
+			nearest = i;
+
+	t = tArray[ nearest ];
+	u = uArray[ nearest ];
+	v = vArray[ nearest ];
+	return nearest;
+}
+
+// Every lane takes the interior solution, then each region of Triangle::ClosestPoint overrides it
+// in reverse order, so that where the regions' tests overlap, the one tested first there wins.
+_3DMATH_TARGET_AVX2 static int ClosestPointAVX2( const PrecomputedTriangleBlock& block, const Vector& point, Vector& closestPoint, double& distanceSquared, double& u, double& v )
+{
+	__m256d ax = _mm256_loadu_pd( block.vertex0[0] );
+	__m256d ay = _mm256_loadu_pd( block.vertex0[1] );
+	__m256d az = _mm256_loadu_pd( block.vertex0[2] );
+
+	__m256d e1x = _mm256_loadu_pd( block.edge1[0] );
+	__m256d e1y = _mm256_loadu_pd( block.edge1[1] );
+	__m256d e1z = _mm256_loadu_pd( block.edge1[2] );
+
+	__m256d e2x = _mm256_loadu_pd( block.edge2[0] );
+	__m256d e2y = _mm256_loadu_pd( block.edge2[1] );
+	__m256d e2z = _mm256_loadu_pd( block.edge2[2] );
+
+	__m256d px = _mm256_sub_pd( _mm256_set1_pd( point.x ), ax );
+	__m256d py = _mm256_sub_pd( _mm256_set1_pd( point.y ), ay );
+	__m256d pz = _mm256_sub_pd( _mm256_set1_pd( point.z ), az );
+
+	__m256d d1 = _mm256_fmadd_pd( e1x, px, _mm256_fmadd_pd( e1y, py, _mm256_mul_pd( e1z, pz ) ) );
+	__m256d d2 = _mm256_fmadd_pd( e2x, px, _mm256_fmadd_pd( e2y, py, _mm256_mul_pd( e2z, pz ) ) );
+
+	__m256d edge11 = _mm256_fmadd_pd( e1x, e1x, _mm256_fmadd_pd( e1y, e1y, _mm256_mul_pd( e1z, e1z ) ) );
+	__m256d edge12 = _mm256_fmadd_pd( e1x, e2x, _mm256_fmadd_pd( e1y, e2y, _mm256_mul_pd( e1z, e2z ) ) );
+	__m256d edge22 = _mm256_fmadd_pd( e2x, e2x, _mm256_fmadd_pd( e2y, e2y, _mm256_mul_pd( e2z, e2z ) ) );
+
+	__m256d d3 = _mm256_sub_pd( d1, edge11 );
+	__m256d d4 = _mm256_sub_pd( d2, edge12 );
+	__m256d d5 = _mm256_sub_pd( d1, edge12 );
+	__m256d d6 = _mm256_sub_pd( d2, edge22 );
+
+	__m256d vc = _mm256_fmsub_pd( d1, d4, _mm256_mul_pd( d3, d2 ) );
+	__m256d vb = _mm256_fmsub_pd( d5, d2, _mm256_mul_pd( d1, d6 ) );
+	__m256d va = _mm256_fmsub_pd( d3, d6, _mm256_mul_pd( d5, d4 ) );
+
+	__m256d zero = _mm256_setzero_pd();
+	__m256d one = _mm256_set1_pd( 1.0 );
+
+	__m256d invDenom = _mm256_div_pd( one, _mm256_add_pd( va, _mm256_add_pd( vb, vc ) ) );
+	__m256d uu = _mm256_mul_pd( vb, invDenom );
+	__m256d vv = _mm256_mul_pd( vc, invDenom );
+
+	// Edge from vertex[1] to vertex[2].
+	__m256d d43 = _mm256_sub_pd( d4, d3 );
+	__m256d d56 = _mm256_sub_pd( d5, d6 );
+	__m256d region = _mm256_and_pd( _mm256_cmp_pd( va, zero, _CMP_LE_OQ ), _mm256_and_pd( _mm256_cmp_pd( d43, zero, _CMP_GE_OQ ), _mm256_cmp_pd( d56, zero, _CMP_GE_OQ ) ) );
+	__m256d w = _mm256_div_pd( d43, _mm256_add_pd( d43, d56 ) );
+	uu = _mm256_blendv_pd( uu, _mm256_sub_pd( one, w ), region );
+	vv = _mm256_blendv_pd( vv, w, region );
+
+	// Edge from vertex[0] to vertex[2].
+	region = _mm256_and_pd( _mm256_cmp_pd( vb, zero, _CMP_LE_OQ ), _mm256_and_pd( _mm256_cmp_pd( d2, zero, _CMP_GE_OQ ), _mm256_cmp_pd( d6, zero, _CMP_LE_OQ ) ) );
+	uu = _mm256_blendv_pd( uu, zero, region );
+	vv = _mm256_blendv_pd( vv, _mm256_div_pd( d2, _mm256_sub_pd( d2, d6 ) ), region );
+
+	// Vertex[2].
+	region = _mm256_and_pd( _mm256_cmp_pd( d6, zero, _CMP_GE_OQ ), _mm256_cmp_pd( d5, d6, _CMP_LE_OQ ) );
+	uu = _mm256_blendv_pd( uu, zero, region );
+	vv = _mm256_blendv_pd( vv, one, region );
+
+	// Edge from vertex[0] to vertex[1].
+	region = _mm256_and_pd( _mm256_cmp_pd( vc, zero, _CMP_LE_OQ ), _mm256_and_pd( _mm256_cmp_pd( d1, zero, _CMP_GE_OQ ), _mm256_cmp_pd( d3, zero, _CMP_LE_OQ ) ) );
+	uu = _mm256_blendv_pd( uu, _mm256_div_pd( d1, _mm256_sub_pd( d1, d3 ) ), region );
+	vv = _mm256_blendv_pd( vv, zero, region );
+
+	// Vertex[1].
+	region = _mm256_and_pd( _mm256_cmp_pd( d3, zero, _CMP_GE_OQ ), _mm256_cmp_pd( d4, d3, _CMP_LE_OQ ) );
+	uu = _mm256_blendv_pd( uu, one, region );
+	vv = _mm256_blendv_pd( vv, zero, region );
+
+	// Vertex[0].
+	region = _mm256_and_pd( _mm256_cmp_pd( d1, zero, _CMP_LE_OQ ), _mm256_cmp_pd( d2, zero, _CMP_LE_OQ ) );
+	uu = _mm256_blendv_pd( uu, zero, region );
+	vv = _mm256_blendv_pd( vv, zero, region );
+
+	__m256d cx = _mm256_fmadd_pd( e1x, uu, _mm256_fmadd_pd( e2x, vv, ax ) );
+	__m256d cy = _mm256_fmadd_pd( e1y, uu, _mm256_fmadd_pd( e2y, vv, ay ) );
+	__m256d cz = _mm256_fmadd_pd( e1z, uu, _mm256_fmadd_pd( e2z, vv, az ) );
+
+	__m256d dx = _mm256_sub_pd( _mm256_set1_pd( point.x ), cx );
+	__m256d dy = _mm256_sub_pd( _mm256_set1_pd( point.y ), cy );
+	__m256d dz = _mm256_sub_pd( _mm256_set1_pd( point.z ), cz );
+	__m256d dd = _mm256_fmadd_pd( dx, dx, _mm256_fmadd_pd( dy, dy, _mm256_mul_pd( dz, dz ) ) );
+
+	double ddArray[4], uArray[4], vArray[4], cArray[3][4];
+	_mm256_storeu_pd( ddArray, dd );
+	_mm256_storeu_pd( uArray, uu );
+	_mm256_storeu_pd( vArray, vv );
+	_mm256_storeu_pd( cArray[0], cx );
+	_mm256_storeu_pd( cArray[1], cy );
+	_mm256_storeu_pd( cArray[2], cz );
+
+	// Unlike the ray test, empty slots give a real answer here (the origin), so they are skipped by count.
+	int nearest = -1;
+	for( int i = 0; i < block.count; i++ )
+		if( nearest < 0 || ddArray[i] < ddArray[ nearest ] )
+			nearest = i;
+
+	if( nearest >= 0 )
+	{
+		distanceSquared = ddArray[ nearest ];
+		u = uArray[ nearest ];
+		v = vArray[ nearest ];
+		closestPoint.Set( cArray[0][ nearest ], cArray[1][ nearest ], cArray[2][ nearest ] );
+	}
+
+	return nearest;
+}
+
+#endif //_3DMATH_X86
+
+PrecomputedTriangleBlock::PrecomputedTriangleBlock( void )
+{
+	Clear();
+}
+
+PrecomputedTriangleBlock::~PrecomputedTriangleBlock( void )
+{
+}
+
+void PrecomputedTriangleBlock::Clear( void )
+{
+	for( int i = 0; i < 3; i++ )
+	{
+		for( int j = 0; j < SIZE; j++ )
+		{
+			vertex0[i][j] = 0.0;
+			vertex1[i][j] = 0.0;
+			vertex2[i][j] = 0.0;
+			edge1[i][j] = 0.0;
+			edge2[i][j] = 0.0;
+		}
+	}
+
+	count = 0;
+}
+
+bool PrecomputedTriangleBlock::Add( const Triangle& triangle )
+{
+	if( count == SIZE )
+		return false;
+
+	PrecomputedTriangle precomputedTriangle( triangle );
+
+	double ( *vertexComponent[3] )[ SIZE ] = { vertex0, vertex1, vertex2 };
+	for( int i = 0; i < 3; i++ )
+	{
+		vertexComponent[i][0][ count ] = triangle.vertex[i].x;
+		vertexComponent[i][1][ count ] = triangle.vertex[i].y;
+		vertexComponent[i][2][ count ] = triangle.vertex[i].z;
+	}
+
+	edge1[0][ count ] = precomputedTriangle.edge1.x;
+	edge1[1][ count ] = precomputedTriangle.edge1.y;
+	edge1[2][ count ] = precomputedTriangle.edge1.z;
+
+	edge2[0][ count ] = precomputedTriangle.edge2.x;
+	edge2[1][ count ] = precomputedTriangle.edge2.y;
+	edge2[2][ count ] = precomputedTriangle.edge2.z;
+
+	count++;
+	return true;
+}
+
+// The ray's shear is found once here, as Triangle::IntersectRayWatertight finds it, and shared by the slots.
+int PrecomputedTriangleBlock::IntersectRay( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin /*= 0.0*/, double tMax /*= HUGE_VAL*/ ) const
+{
+	double rayDirection[3] = { direction.x, direction.y, direction.z };
+
+	int kz = 0;
+	if( fabs( rayDirection[1] ) > fabs( rayDirection[kz] ) )
+		kz = 1;
+	if( fabs( rayDirection[2] ) > fabs( rayDirection[kz] ) )
+		kz = 2;
+
+	if( rayDirection[kz] == 0.0 )
+		return -1;
+
+	int kx = ( kz + 1 ) % 3;
+	int ky = ( kx + 1 ) % 3;
+	if( rayDirection[kz] < 0.0 )
+	{
+		int k = kx;
+		kx = ky;
+		ky = k;
+	}
+
+	double shearX = rayDirection[kx] / rayDirection[kz];
+	double shearY = rayDirection[ky] / rayDirection[kz];
+	double shearZ = 1.0 / rayDirection[kz];
+
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		return IntersectRayAVX2( *this, origin, kx, ky, kz, shearX, shearY, shearZ, t, u, v, tMin, tMax );
+#endif
+
+	int nearest = -1;
+
+	for( int i = 0; i < count; i++ )
+	{
+		Triangle triangle;
+		triangle.vertex[0].Set( vertex0[0][i], vertex0[1][i], vertex0[2][i] );
+		triangle.vertex[1].Set( vertex1[0][i], vertex1[1][i], vertex1[2][i] );
+		triangle.vertex[2].Set( vertex2[0][i], vertex2[1][i], vertex2[2][i] );
+
+		double hitT, hitU, hitV;
+		if( triangle.IntersectRayWatertight( origin, direction, hitT, hitU, hitV, tMin, tMax ) && ( nearest < 0 || hitT < t ) )
+		{
+			nearest = i;
+			t = hitT;
+			u = hitU;
+			v = hitV;
+		}
+	}
+
+	return nearest;
+}
+
+int PrecomputedTriangleBlock::ClosestPoint( const Vector& point, Vector& closestPoint, double& distanceSquared, double& u, double& v ) const
+{
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		return ClosestPointAVX2( *this, point, closestPoint, distanceSquared, u, v );
+#endif
+
+	int nearest = -1;
+
+	for( int i = 0; i < count; i++ )
+	{
+		Triangle triangle;
+		triangle.vertex[0].Set( vertex0[0][i], vertex0[1][i], vertex0[2][i] );
+		triangle.vertex[1].Set( vertex1[0][i], vertex1[1][i], vertex1[2][i] );
+		triangle.vertex[2].Set( vertex2[0][i], vertex2[1][i], vertex2[2][i] );
+
+		Vector point0;
+		double distanceSquared0, u0, v0;
+		distanceSquared0 = triangle.ClosestPoint( point, point0, u0, v0 );
+		if( nearest < 0 || distanceSquared0 < distanceSquared )
+		{
+			nearest = i;
+			closestPoint = point0;
+			distanceSquared = distanceSquared0;
+			u = u0;
+			v = v0;
+		}
+	}
+
+	return nearest;
+}
+
+// PrecomputedTriangle.cpp
@@ -0,0 +1,69 @@
+// PrecomputedTriangle.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+
+namespace _3DMath
+{
+	class PrecomputedTriangle;
+	class PrecomputedTriangleBlock;
+	class Triangle;
+}
+
+// A triangle that is tested against many rays keeps its edges and (unnormalized) normal
+// here, so that each test is one cross product and four dot products.  The conventions
+// are those of Triangle::IntersectRay.
+class _3DMATH_API _3DMath::PrecomputedTriangle
+{
+public:
+
+	PrecomputedTriangle( void );
+	PrecomputedTriangle( const Triangle& triangle );
+	~PrecomputedTriangle( void );
+
+	void Set( const Triangle& triangle );
+
+	bool IntersectRay( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin = 0.0, double tMax = HUGE_VAL ) const;
+
+	Vector vertex0;
+	Vector edge1;
+	Vector edge2;
+	Vector normal;
+};
+
+// This holds up to SIZE precomputed triangles, one component per array, so that a ray can be
+// tested against all of them at once with AVX2.  Unused slots are zero and never hit.  The
+// vertices are kept as given, rather than as edges, which the watertight ray test needs.
+class _3DMATH_API _3DMath::PrecomputedTriangleBlock
+{
+public:
+
+	enum { SIZE = 4 };
+
+	PrecomputedTriangleBlock( void );
+	~PrecomputedTriangleBlock( void );
+
+	void Clear( void );
+
+	// False is returned if the block is full.
+	bool Add( const Triangle& triangle );
+
+	// This is Triangle::IntersectRayWatertight, to the bit, with or without AVX2.  It returns the slot
+	// of the nearest hit in [tMin,tMax], the first of any that tie, or -1 if there is none.
+	int IntersectRay( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin = 0.0, double tMax = HUGE_VAL ) const;
+
+	// This returns the slot of the triangle nearest the given point, or -1 if the block is empty, along
+	// with the squared distance and closest point as given by Triangle::ClosestPoint.
+	int ClosestPoint( const Vector& point, Vector& closestPoint, double& distanceSquared, double& u, double& v ) const;
+
+	double vertex0[3][SIZE];
+	double vertex1[3][SIZE];
+	double vertex2[3][SIZE];
+	double edge1[3][SIZE];
+	double edge2[3][SIZE];
+	int count;
+};
+
+// PrecomputedTriangle.h
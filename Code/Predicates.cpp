@@ -0,0 +1,366 @@
+// Predicates.cpp
+
+#include "Predicates.h"
+
+using namespace _3DMath;
+
+// Half an ulp of one, and Shewchuk's first-stage error bounds built from it.
+static const double epsilon = 1.1102230246251565e-16;
+static const double orient2DErrorBound = ( 3.0 + 16.0 * epsilon ) * epsilon;
+static const double orient3DErrorBound = ( 7.0 + 56.0 * epsilon ) * epsilon;
+static const double inSphereErrorBound = ( 16.0 + 224.0 * epsilon ) * epsilon;
+
+//---------------------------------------------------------------------
+//                          Expansion arithmetic
+//---------------------------------------------------------------------
+
+// An expansion is a sum of doubles, stored in order of increasing magnitude, no two of which
+// overlap in their significant bits.  Any sum or product of doubles can be held exactly this way.
+// The exact stage is rare enough that the simplicity of growable arrays beats fixed buffers.
+typedef std::vector< double > Expansion;
+
+// These rely on strict double-precision rounding, which every SSE2-era compiler gives us.
+static inline void TwoSum( double a, double b, double& sum, double& error )
+{
+	sum = a + b;
+	double virtualB = sum - a;
+	double virtualA = sum - virtualB;
+	error = ( a - virtualA ) + ( b - virtualB );
+}
+
+static inline void TwoDifference( double a, double b, double& difference, double& error )
+{
+	difference = a - b;
+	double virtualB = a - difference;
+	double virtualA = difference + virtualB;
+	error = ( a - virtualA ) + ( virtualB - b );
+}
+
+// Dekker's split of a double into two halves of 26 bits each.
+static inline void Split( double a, double& high, double& low )
+{
+	double c = 134217729.0 * a;		// 2^27 + 1
+	high = c - ( c - a );
+	low = a - high;
+}
+
+static inline void TwoProduct( double a, double b, double& product, double& error )
+{
+	product = a * b;
+
+	double aHigh, aLow, bHigh, bLow;
+	Split( a, aHigh, aLow );
+	Split( b, bHigh, bLow );
+
+	error = aLow * bLow - ( ( ( product - aHigh * bHigh ) - aLow * bHigh ) - aHigh * bLow );
+}
+
+static Expansion Difference( double a, double b )
+{
+	double difference, error;
+	TwoDifference( a, b, difference, error );
+
+	Expansion expansion;
+	if( error != 0.0 )
+		expansion.push_back( error );
+	if( difference != 0.0 )
+		expansion.push_back( difference );
+	return expansion;
+}
+
+// Shewchuk's GROW-EXPANSION with zero elimination, done in place.
+static void Grow( Expansion& expansion, double b )
+{
+	double q = b;
+	int count = 0;
+
+	for( int i = 0; i < ( signed )expansion.size(); i++ )
+	{
+		double sum, error;
+		TwoSum( q, expansion[i], sum, error );
+		q = sum;
+		if( error != 0.0 )
+			expansion[ count++ ] = error;
+	}
+
+	expansion.resize( count );
+	if( q != 0.0 )
+		expansion.push_back( q );
+}
+
+static Expansion Sum( const Expansion& expansionA, const Expansion& expansionB )
+{
+	Expansion sum = expansionA;
+	for( int i = 0; i < ( signed )expansionB.size(); i++ )
+		Grow( sum, expansionB[i] );
+	return sum;
+}
+
+static Expansion Negate( const Expansion& expansion )
+{
+	Expansion negation( expansion.size() );
+	for( int i = 0; i < ( signed )expansion.size(); i++ )
+		negation[i] = -expansion[i];
+	return negation;
+}
+
+// Shewchuk's SCALE-EXPANSION with zero elimination.
+static Expansion Scale( const Expansion& expansion, double b )
+{
+	Expansion product;
+	if( expansion.size() == 0 )
+		return product;
+
+	double q, error;
+	TwoProduct( expansion[0], b, q, error );
+	if( error != 0.0 )
+		product.push_back( error );
+
+	for( int i = 1; i < ( signed )expansion.size(); i++ )
+	{
+		double termHigh, termLow, sum;
+		TwoProduct( expansion[i], b, termHigh, termLow );
+
+		TwoSum( q, termLow, sum, error );
+		if( error != 0.0 )
+			product.push_back( error );
+
+		TwoSum( termHigh, sum, q, error );
+		if( error != 0.0 )
+			product.push_back( error );
+	}
+
+	if( q != 0.0 )
+		product.push_back( q );
+
+	return product;
+}
+
+static Expansion Product( const Expansion& expansionA, const Expansion& expansionB )
+{
+	Expansion product;
+	for( int i = 0; i < ( signed )expansionB.size(); i++ )
+		product = Sum( product, Scale( expansionA, expansionB[i] ) );
+	return product;
+}
+
+// The components don't overlap, so adding them smallest first can't get the sign wrong.
+static double Estimate( const Expansion& expansion )
+{
+	double estimate = 0.0;
+	for( int i = 0; i < ( signed )expansion.size(); i++ )
+		estimate += expansion[i];
+	return estimate;
+}
+
+//---------------------------------------------------------------------
+//                           Exact evaluation
+//---------------------------------------------------------------------
+
+// These evaluate the same determinants as the filters below, on the exact coordinate differences.
+
+static Expansion Minor2( const Expansion& a0, const Expansion& a1, const Expansion& b0, const Expansion& b1 )
+{
+	return Sum( Product( a0, b1 ), Negate( Product( a1, b0 ) ) );
+}
+
+static double Orient2DExact( const double* a, const double* b, const double* c )
+{
+	Expansion acx = Difference( a[0], c[0] ), acy = Difference( a[1], c[1] );
+	Expansion bcx = Difference( b[0], c[0] ), bcy = Difference( b[1], c[1] );
+
+	return Estimate( Minor2( acx, acy, bcx, bcy ) );
+}
+
+static Expansion Orient3DExpansion( const Vector& a, const Vector& b, const Vector& c, const Vector& d )
+{
+	Expansion adx = Difference( a.x, d.x ), ady = Difference( a.y, d.y ), adz = Difference( a.z, d.z );
+	Expansion bdx = Difference( b.x, d.x ), bdy = Difference( b.y, d.y ), bdz = Difference( b.z, d.z );
+	Expansion cdx = Difference( c.x, d.x ), cdy = Difference( c.y, d.y ), cdz = Difference( c.z, d.z );
+
+	Expansion determinant = Product( adz, Minor2( bdx, bdy, cdx, cdy ) );
+	determinant = Sum( determinant, Product( bdz, Minor2( cdx, cdy, adx, ady ) ) );
+	determinant = Sum( determinant, Product( cdz, Minor2( adx, ady, bdx, bdy ) ) );
+	return determinant;
+}
+
+static double InSphereExact( const Vector& a, const Vector& b, const Vector& c, const Vector& d, const Vector& e )
+{
+	const Vector* point[4] = { &a, &b, &c, &d };
+	Expansion x[4], y[4], z[4], lift[4];
+
+	for( int i = 0; i < 4; i++ )
+	{
+		x[i] = Difference( point[i]->x, e.x );
+		y[i] = Difference( point[i]->y, e.y );
+		z[i] = Difference( point[i]->z, e.z );
+		lift[i] = Sum( Sum( Product( x[i], x[i] ), Product( y[i], y[i] ) ), Product( z[i], z[i] ) );
+	}
+
+	Expansion ab = Minor2( x[0], y[0], x[1], y[1] );
+	Expansion bc = Minor2( x[1], y[1], x[2], y[2] );
+	Expansion cd = Minor2( x[2], y[2], x[3], y[3] );
+	Expansion da = Minor2( x[3], y[3], x[0], y[0] );
+	Expansion ac = Minor2( x[0], y[0], x[2], y[2] );
+	Expansion bd = Minor2( x[1], y[1], x[3], y[3] );
+
+	Expansion abc = Sum( Sum( Product( z[0], bc ), Negate( Product( z[1], ac ) ) ), Product( z[2], ab ) );
+	Expansion bcd = Sum( Sum( Product( z[1], cd ), Negate( Product( z[2], bd ) ) ), Product( z[3], bc ) );
+	Expansion cda = Sum( Sum( Product( z[2], da ), Product( z[3], ac ) ), Product( z[0], cd ) );
+	Expansion dab = Sum( Sum( Product( z[3], ab ), Product( z[0], bd ) ), Product( z[1], da ) );
+
+	Expansion determinant = Sum( Product( lift[3], abc ), Negate( Product( lift[2], dab ) ) );
+	determinant = Sum( determinant, Product( lift[1], cda ) );
+	determinant = Sum( determinant, Negate( Product( lift[0], bcd ) ) );
+	return Estimate( determinant );
+}
+
+//---------------------------------------------------------------------
+//                              Predicates
+//---------------------------------------------------------------------
+
+// Internally these follow Shewchuk's sign conventions; the public ones differ only for Orient3D.
+
+static double Orient2D( const double* a, const double* b, const double* c )
+{
+	double left = ( a[0] - c[0] ) * ( b[1] - c[1] );
+	double right = ( a[1] - c[1] ) * ( b[0] - c[0] );
+	double determinant = left - right;
+
+	// When the two products differ in sign, there's no cancellation to worry about.
+	double permanent;
+	if( left > 0.0 )
+	{
+		if( right <= 0.0 )
+			return determinant;
+		permanent = left + right;
+	}
+	else if( left < 0.0 )
+	{
+		if( right >= 0.0 )
+			return determinant;
+		permanent = -left - right;
+	}
+	else
+		return determinant;
+
+	double errorBound = orient2DErrorBound * permanent;
+	if( determinant >= errorBound || -determinant >= errorBound )
+		return determinant;
+
+	return Orient2DExact( a, b, c );
+}
+
+// Positive if d is below the plane of a, b and c, taking above as where they look counter-clockwise.
+static double Orient3DBelow( const Vector& a, const Vector& b, const Vector& c, const Vector& d )
+{
+	double adx = a.x - d.x, ady = a.y - d.y, adz = a.z - d.z;
+	double bdx = b.x - d.x, bdy = b.y - d.y, bdz = b.z - d.z;
+	double cdx = c.x - d.x, cdy = c.y - d.y, cdz = c.z - d.z;
+
+	double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+	double cdxady = cdx * ady, adxcdy = adx * cdy;
+	double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+	double determinant = adz * ( bdxcdy - cdxbdy ) + bdz * ( cdxady - adxcdy ) + cdz * ( adxbdy - bdxady );
+
+	double permanent =
+		( fabs( bdxcdy ) + fabs( cdxbdy ) ) * fabs( adz ) +
+		( fabs( cdxady ) + fabs( adxcdy ) ) * fabs( bdz ) +
+		( fabs( adxbdy ) + fabs( bdxady ) ) * fabs( cdz );
+
+	double errorBound = orient3DErrorBound * permanent;
+	if( determinant > errorBound || -determinant > errorBound )
+		return determinant;
+
+	return Estimate( Orient3DExpansion( a, b, c, d ) );
+}
+
+// Positive if e is inside the sphere, provided Orient3DBelow( a, b, c, d ) is positive.
+static double InSphereOriented( const Vector& a, const Vector& b, const Vector& c, const Vector& d, const Vector& e )
+{
+	double aex = a.x - e.x, aey = a.y - e.y, aez = a.z - e.z;
+	double bex = b.x - e.x, bey = b.y - e.y, bez = b.z - e.z;
+	double cex = c.x - e.x, cey = c.y - e.y, cez = c.z - e.z;
+	double dex = d.x - e.x, dey = d.y - e.y, dez = d.z - e.z;
+
+	double aexbey = aex * bey, bexaey = bex * aey;
+	double bexcey = bex * cey, cexbey = cex * bey;
+	double cexdey = cex * dey, dexcey = dex * cey;
+	double dexaey = dex * aey, aexdey = aex * dey;
+	double aexcey = aex * cey, cexaey = cex * aey;
+	double bexdey = bex * dey, dexbey = dex * bey;
+
+	double ab = aexbey - bexaey;
+	double bc = bexcey - cexbey;
+	double cd = cexdey - dexcey;
+	double da = dexaey - aexdey;
+	double ac = aexcey - cexaey;
+	double bd = bexdey - dexbey;
+
+	double abc = aez * bc - bez * ac + cez * ab;
+	double bcd = bez * cd - cez * bd + dez * bc;
+	double cda = cez * da + dez * ac + aez * cd;
+	double dab = dez * ab + aez * bd + bez * da;
+
+	double aLift = aex * aex + aey * aey + aez * aez;
+	double bLift = bex * bex + bey * bey + bez * bez;
+	double cLift = cex * cex + cey * cey + cez * cez;
+	double dLift = dex * dex + dey * dey + dez * dez;
+
+	double determinant = ( dLift * abc - cLift * dab ) + ( bLift * cda - aLift * bcd );
+
+	double aezPlus = fabs( aez ), bezPlus = fabs( bez ), cezPlus = fabs( cez ), dezPlus = fabs( dez );
+	double abPlus = fabs( aexbey ) + fabs( bexaey );
+	double bcPlus = fabs( bexcey ) + fabs( cexbey );
+	double cdPlus = fabs( cexdey ) + fabs( dexcey );
+	double daPlus = fabs( dexaey ) + fabs( aexdey );
+	double acPlus = fabs( aexcey ) + fabs( cexaey );
+	double bdPlus = fabs( bexdey ) + fabs( dexbey );
+
+	double permanent =
+		( cdPlus * bezPlus + bdPlus * cezPlus + bcPlus * dezPlus ) * aLift +
+		( daPlus * cezPlus + acPlus * dezPlus + cdPlus * aezPlus ) * bLift +
+		( abPlus * dezPlus + bdPlus * aezPlus + daPlus * bezPlus ) * cLift +
+		( bcPlus * aezPlus + acPlus * bezPlus + abPlus * cezPlus ) * dLift;
+
+	double errorBound = inSphereErrorBound * permanent;
+	if( determinant > errorBound || -determinant > errorBound )
+		return determinant;
+
+	return InSphereExact( a, b, c, d, e );
+}
+
+static inline double Component( const Vector& vector, int axis )
+{
+	return ( axis == 0 ) ? vector.x : ( ( axis == 1 ) ? vector.y : vector.z );
+}
+
+/*static*/ double Predicates::Orient2D( const Vector& pointA, const Vector& pointB, const Vector& pointC, int dropAxis /*= 2*/ )
+{
+	int u = ( dropAxis + 1 ) % 3;
+	int v = ( dropAxis + 2 ) % 3;
+
+	double a[2] = { Component( pointA, u ), Component( pointA, v ) };
+	double b[2] = { Component( pointB, u ), Component( pointB, v ) };
+	double c[2] = { Component( pointC, u ), Component( pointC, v ) };
+
+	return ::Orient2D( a, b, c );
+}
+
+/*static*/ double Predicates::Orient3D( const Vector& pointA, const Vector& pointB, const Vector& pointC, const Vector& pointD )
+{
+	return -Orient3DBelow( pointA, pointB, pointC, pointD );
+}
+
+/*static*/ double Predicates::InSphere( const Vector& pointA, const Vector& pointB, const Vector& pointC, const Vector& pointD, const Vector& pointE )
+{
+	double orientation = Orient3DBelow( pointA, pointB, pointC, pointD );
+	if( orientation == 0.0 )
+		return 0.0;
+
+	double inSphere = InSphereOriented( pointA, pointB, pointC, pointD, pointE );
+	return ( orientation > 0.0 ) ? inSphere : -inSphere;
+}
+
+// Predicates.cpp
@@ -0,0 +1,37 @@
+// Predicates.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+
+namespace _3DMath
+{
+	class Predicates;
+}
+
+// These are Shewchuk's orientation and in-sphere tests.  Each is first evaluated in plain
+// floating-point, and that answer is returned whenever a forward error bound proves its sign is
+// right, which is nearly always.  Otherwise the determinant is re-evaluated exactly with
+// expansion arithmetic.  The sign of the result is therefore always correct, and in particular
+// zero means exactly degenerate; the magnitude is only approximate.  Unlike the EPSILON-based
+// tests elsewhere in the library, these never contradict one another, which is what hull
+// construction, BSP splitting and tessellation need to terminate consistently.
+class _3DMATH_API _3DMath::Predicates
+{
+public:
+
+	// Positive if point C is to the left of the directed line from A to B, as seen looking down
+	// the given axis (0, 1 or 2) from its positive end, with that coordinate dropped.
+	static double Orient2D( const Vector& pointA, const Vector& pointB, const Vector& pointC, int dropAxis = 2 );
+
+	// Positive if point D is in front of the triangle ABC, i.e., on the side its right-handed normal
+	// (B-A)x(C-A) points to, the same convention as Plane::GetSide.
+	static double Orient3D( const Vector& pointA, const Vector& pointB, const Vector& pointC, const Vector& pointD );
+
+	// Positive if point E is inside the sphere through A, B, C and D, negative if outside, and zero
+	// if on it or if A, B, C and D are coplanar.
+	static double InSphere( const Vector& pointA, const Vector& pointB, const Vector& pointC, const Vector& pointD, const Vector& pointE );
+};
+
+// Predicates.h
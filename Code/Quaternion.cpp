@@ -0,0 +1,305 @@
+// Quaternion.cpp
+
+#include "Quaternion.h"
+#include "LinearTransform.h"
+#include "AffineTransform.h"
+#include "BatchTransform.h"
+
+using namespace _3DMath;
+
+Quaternion::Quaternion( void )
+{
+	Identity();
+}
+
+Quaternion::Quaternion( const Quaternion& quaternion )
+{
+	Set( quaternion.w, quaternion.x, quaternion.y, quaternion.z );
+}
+
+Quaternion::Quaternion( double w, double x, double y, double z )
+{
+	Set( w, x, y, z );
+}
+
+Quaternion::Quaternion( const Vector& unitAxis, double angle )
+{
+	SetRotation( unitAxis, angle );
+}
+
+Quaternion::~Quaternion( void )
+{
+}
+
+Quaternion& Quaternion::operator=( const Quaternion& quaternion )
+{
+	Set( quaternion.w, quaternion.x, quaternion.y, quaternion.z );
+	return *this;
+}
+
+void Quaternion::Identity( void )
+{
+	Set( 1.0, 0.0, 0.0, 0.0 );
+}
+
+void Quaternion::Set( double w, double x, double y, double z )
+{
+	this->w = w;
+	this->x = x;
+	this->y = y;
+	this->z = z;
+}
+
+void Quaternion::Get( double& w, double& x, double& y, double& z ) const
+{
+	w = this->w;
+	x = this->x;
+	y = this->y;
+	z = this->z;
+}
+
+void Quaternion::SetRotation( const Vector& unitAxis, double angle )
+{
+	double halfAngle = angle / 2.0;
+	double sinHalfAngle = sin( halfAngle );
+	Set( cos( halfAngle ), unitAxis.x * sinHalfAngle, unitAxis.y * sinHalfAngle, unitAxis.z * sinHalfAngle );
+}
+
+bool Quaternion::GetRotation( Vector& unitAxis, double& angle ) const
+{
+	Quaternion unitQuaternion( *this );
+	if( !unitQuaternion.Normalize() )
+		return false;
+
+	// Take the angle in [0,pi] by flipping to the equivalent quaternion with non-negative w.
+	if( unitQuaternion.w < 0.0 )
+		unitQuaternion.Scale( -1.0 );
+
+	unitAxis.Set( unitQuaternion.x, unitQuaternion.y, unitQuaternion.z );
+	double sinHalfAngle = unitAxis.Length();
+	angle = 2.0 * atan2( sinHalfAngle, unitQuaternion.w );
+
+	// With no rotation, any axis will do.
+	if( sinHalfAngle == 0.0 )
+		unitAxis.Set( 0.0, 0.0, 1.0 );
+	else
+		unitAxis.Scale( 1.0 / sinHalfAngle );
+
+	return true;
+}
+
+// This is Shepperd's method, which divides by the largest of the candidate denominators.
+void Quaternion::SetFromLinearTransform( const LinearTransform& linearTransform )
+{
+	const Vector& xAxis = linearTransform.xAxis;
+	const Vector& yAxis = linearTransform.yAxis;
+	const Vector& zAxis = linearTransform.zAxis;
+
+	double trace = xAxis.x + yAxis.y + zAxis.z;
+
+	if( trace > 0.0 )
+	{
+		double scale = 2.0 * sqrt( trace + 1.0 );
+		Set( scale / 4.0, ( yAxis.z - zAxis.y ) / scale, ( zAxis.x - xAxis.z ) / scale, ( xAxis.y - yAxis.x ) / scale );
+	}
+	else if( xAxis.x > yAxis.y && xAxis.x > zAxis.z )
+	{
+		double scale = 2.0 * sqrt( 1.0 + xAxis.x - yAxis.y - zAxis.z );
+		Set( ( yAxis.z - zAxis.y ) / scale, scale / 4.0, ( yAxis.x + xAxis.y ) / scale, ( zAxis.x + xAxis.z ) / scale );
+	}
+	else if( yAxis.y > zAxis.z )
+	{
+		double scale = 2.0 * sqrt( 1.0 + yAxis.y - xAxis.x - zAxis.z );
+		Set( ( zAxis.x - xAxis.z ) / scale, ( yAxis.x + xAxis.y ) / scale, scale / 4.0, ( zAxis.y + yAxis.z ) / scale );
+	}
+	else
+	{
+		double scale = 2.0 * sqrt( 1.0 + zAxis.z - xAxis.x - yAxis.y );
+		Set( ( xAxis.y - yAxis.x ) / scale, ( zAxis.x + xAxis.z ) / scale, ( zAxis.y + yAxis.z ) / scale, scale / 4.0 );
+	}
+
+	Normalize();
+}
+
+void Quaternion::GetLinearTransform( LinearTransform& linearTransform ) const
+{
+	double xx = x * x, yy = y * y, zz = z * z;
+	double xy = x * y, xz = x * z, yz = y * z;
+	double wx = w * x, wy = w * y, wz = w * z;
+
+	linearTransform.xAxis.Set( 1.0 - 2.0 * ( yy + zz ), 2.0 * ( xy + wz ), 2.0 * ( xz - wy ) );
+	linearTransform.yAxis.Set( 2.0 * ( xy - wz ), 1.0 - 2.0 * ( xx + zz ), 2.0 * ( yz + wx ) );
+	linearTransform.zAxis.Set( 2.0 * ( xz + wy ), 2.0 * ( yz - wx ), 1.0 - 2.0 * ( xx + yy ) );
+}
+
+void Quaternion::Multiply( const Quaternion& quaternion )
+{
+	Quaternion product;
+	product.Multiply( *this, quaternion );
+	*this = product;
+}
+
+void Quaternion::Multiply( const Quaternion& quaternionA, const Quaternion& quaternionB )
+{
+	const Quaternion& a = quaternionA;
+	const Quaternion& b = quaternionB;
+
+	Set(
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w );
+}
+
+void Quaternion::Concatinate( const Quaternion& quaternion )
+{
+	Concatinate( Quaternion( *this ), quaternion );
+}
+
+void Quaternion::Concatinate( const Quaternion& quaternionA, const Quaternion& quaternionB )
+{
+	Multiply( quaternionB, quaternionA );
+}
+
+void Quaternion::Conjugate( void )
+{
+	GetConjugate( *this );
+}
+
+void Quaternion::GetConjugate( Quaternion& quaternion ) const
+{
+	quaternion.Set( w, -x, -y, -z );
+}
+
+void Quaternion::SetConjugate( const Quaternion& quaternion )
+{
+	quaternion.GetConjugate( *this );
+}
+
+bool Quaternion::Invert( void )
+{
+	return GetInverse( *this );
+}
+
+bool Quaternion::GetInverse( Quaternion& quaternion ) const
+{
+	double lengthSquared = Dot( *this );
+	if( lengthSquared == 0.0 )
+		return false;
+
+	GetConjugate( quaternion );
+	quaternion.Scale( 1.0 / lengthSquared );
+	return true;
+}
+
+bool Quaternion::SetInverse( const Quaternion& quaternion )
+{
+	return quaternion.GetInverse( *this );
+}
+
+bool Quaternion::Normalize( void )
+{
+	double length = Length();
+	if( length == 0.0 )
+		return false;
+
+	Scale( 1.0 / length );
+	return true;
+}
+
+double Quaternion::Length( void ) const
+{
+	return sqrt( Dot( *this ) );
+}
+
+double Quaternion::Dot( const Quaternion& quaternion ) const
+{
+	return w * quaternion.w + x * quaternion.x + y * quaternion.y + z * quaternion.z;
+}
+
+void Quaternion::Add( const Quaternion& quaternion )
+{
+	Set( w + quaternion.w, x + quaternion.x, y + quaternion.y, z + quaternion.z );
+}
+
+void Quaternion::Scale( double scale )
+{
+	Set( w * scale, x * scale, y * scale, z * scale );
+}
+
+void Quaternion::Rotate( Vector& vector ) const
+{
+	Rotate( vector, vector );
+}
+
+// This expands q v q* into two cross products, which is cheaper than two Hamilton products.
+void Quaternion::Rotate( const Vector& vectorA, Vector& vectorB ) const
+{
+	Vector axis( x, y, z );
+
+	Vector twiceCross;
+	twiceCross.Cross( axis, vectorA );
+	twiceCross.Scale( 2.0 );
+
+	Vector crossTwiceCross;
+	crossTwiceCross.Cross( axis, twiceCross );
+
+	vectorB.AddScale( vectorA, 1.0, twiceCross, w );
+	vectorB.Add( crossTwiceCross );
+}
+
+void Quaternion::Rotate( Vector* vectorArray, int arraySize ) const
+{
+	AffineTransform affineTransform;
+	GetLinearTransform( affineTransform.linearTransform );
+
+	BatchTransform batchTransform;
+	batchTransform.SetPointTransform( affineTransform );
+	batchTransform.TransformVectors( vectorArray, arraySize );
+}
+
+void Quaternion::Slerp( const Quaternion& unitQuaternionA, const Quaternion& unitQuaternionB, double lambda )
+{
+	double dot = unitQuaternionA.Dot( unitQuaternionB );
+	double signB = ( dot < 0.0 ) ? -1.0 : 1.0;
+	dot *= signB;
+
+	// Close enough to parallel that the sine below loses precision.
+	if( dot > 1.0 - EPSILON )
+	{
+		Nlerp( unitQuaternionA, unitQuaternionB, lambda );
+		return;
+	}
+
+	double angle = acos( dot );
+	double sinAngle = sin( angle );
+	double scaleA = sin( ( 1.0 - lambda ) * angle ) / sinAngle;
+	double scaleB = signB * sin( lambda * angle ) / sinAngle;
+
+	Set(
+		unitQuaternionA.w * scaleA + unitQuaternionB.w * scaleB,
+		unitQuaternionA.x * scaleA + unitQuaternionB.x * scaleB,
+		unitQuaternionA.y * scaleA + unitQuaternionB.y * scaleB,
+		unitQuaternionA.z * scaleA + unitQuaternionB.z * scaleB );
+}
+
+void Quaternion::Nlerp( const Quaternion& unitQuaternionA, const Quaternion& unitQuaternionB, double lambda )
+{
+	double scaleA = 1.0 - lambda;
+	double scaleB = ( unitQuaternionA.Dot( unitQuaternionB ) < 0.0 ) ? -lambda : lambda;
+
+	Set(
+		unitQuaternionA.w * scaleA + unitQuaternionB.w * scaleB,
+		unitQuaternionA.x * scaleA + unitQuaternionB.x * scaleB,
+		unitQuaternionA.y * scaleA + unitQuaternionB.y * scaleB,
+		unitQuaternionA.z * scaleA + unitQuaternionB.z * scaleB );
+
+	Normalize();
+}
+
+bool Quaternion::IsEqualTo( const Quaternion& quaternion, double eps /*= EPSILON*/ ) const
+{
+	return fabs( w - quaternion.w ) < eps && fabs( x - quaternion.x ) < eps && fabs( y - quaternion.y ) < eps && fabs( z - quaternion.z ) < eps;
+}
+
+// Quaternion.cpp
@@ -0,0 +1,88 @@
+// Quaternion.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+
+namespace _3DMath
+{
+	class Quaternion;
+	class LinearTransform;
+}
+
+// Unit quaternions represent rotations more compactly than a LinearTransform, and they compose,
+// invert and interpolate more cheaply.  Rotating a single vector costs about as much as a matrix
+// multiply, so for rotating many vectors at once, Rotate( Vector*, int ) converts to a matrix first.
+class _3DMATH_API _3DMath::Quaternion
+{
+public:
+
+	Quaternion( void );
+	Quaternion( const Quaternion& quaternion );
+	Quaternion( double w, double x, double y, double z );
+	Quaternion( const Vector& unitAxis, double angle );
+	~Quaternion( void );
+
+	Quaternion& operator=( const Quaternion& quaternion );
+
+	void Identity( void );
+
+	void Set( double w, double x, double y, double z );
+	void Get( double& w, double& x, double& y, double& z ) const;
+
+	void SetRotation( const Vector& unitAxis, double angle );
+	bool GetRotation( Vector& unitAxis, double& angle ) const;
+
+	// The given transform is assumed to be a rotation; use Orthogonalize() first if it may not be.
+	void SetFromLinearTransform( const LinearTransform& linearTransform );
+	void GetLinearTransform( LinearTransform& linearTransform ) const;
+
+	// This is the Hamilton product, so that rotating by the result rotates by quaternionB, then quaternionA.
+	void Multiply( const Quaternion& quaternion );
+	void Multiply( const Quaternion& quaternionA, const Quaternion& quaternionB );
+
+	// As with LinearTransform, concatination applies the first rotation, then the second.
+	void Concatinate( const Quaternion& quaternion );
+	void Concatinate( const Quaternion& quaternionA, const Quaternion& quaternionB );
+
+	void Conjugate( void );
+	void GetConjugate( Quaternion& quaternion ) const;
+	void SetConjugate( const Quaternion& quaternion );
+
+	bool Invert( void );
+	bool GetInverse( Quaternion& quaternion ) const;
+	bool SetInverse( const Quaternion& quaternion );
+
+	bool Normalize( void );
+	double Length( void ) const;
+	double Dot( const Quaternion& quaternion ) const;
+
+	void Add( const Quaternion& quaternion );
+	void Scale( double scale );
+
+	// These assume a unit quaternion.
+	void Rotate( Vector& vector ) const;
+	void Rotate( const Vector& vectorA, Vector& vectorB ) const;
+	void Rotate( Vector* vectorArray, int arraySize ) const;
+
+	// Both take the shorter arc.  Nlerp is much cheaper and close enough for small angles or blending.
+	void Slerp( const Quaternion& unitQuaternionA, const Quaternion& unitQuaternionB, double lambda );
+	void Nlerp( const Quaternion& unitQuaternionA, const Quaternion& unitQuaternionB, double lambda );
+
+	bool IsEqualTo( const Quaternion& quaternion, double eps = EPSILON ) const;
+
+	double w, x, y, z;
+};
+
+namespace _3DMath
+{
+	inline Quaternion operator*( const Quaternion& quaternionA, const Quaternion& quaternionB )
+	{
+		Quaternion product;
+		product.Multiply( quaternionA, quaternionB );
+		return product;
+	}
+}
+
+// Quaternion.h
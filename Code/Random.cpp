@@ -2,6 +2,7 @@
 
 #include "Random.h"
 #include "Vector.h"
+#include "FastMath.h"
 
 using namespace _3DMath;
 
@@ -38,8 +39,23 @@ double Random::Float( double min, double max )
 
 void Random::VectorInCone( const Vector& unitAxis, double coneAngle, Vector& randomVector )
 {
-	double angle = Float( 0.0, coneAngle );
-	//...
+	// Taking the cosine of the polar angle uniformly spreads the vectors evenly over the spherical cap.
+	double sinConeAngle, cosConeAngle;
+	FastMath::SinCos( coneAngle, sinConeAngle, cosConeAngle );
+
+	double cosPolarAngle = Float( cosConeAngle, 1.0 );
+	double sinPolarAngle = sqrt( MAX( 0.0, 1.0 - cosPolarAngle * cosPolarAngle ) );
+
+	double sinAzimuthAngle, cosAzimuthAngle;
+	FastMath::SinCos( Float( 0.0, 2.0 * M_PI ), sinAzimuthAngle, cosAzimuthAngle );
+
+	Vector xAxis, yAxis;
+	unitAxis.Orthogonal( xAxis );
+	xAxis.Normalize();
+	yAxis.Cross( unitAxis, xAxis );
+
+	randomVector.AddScale( xAxis, cosAzimuthAngle, yAxis, sinAzimuthAngle );
+	randomVector.AddScale( unitAxis, cosPolarAngle, randomVector, sinPolarAngle );
 }
 
 void Random::VectorInBox( const AxisAlignedBox& box, Vector& randomVector )
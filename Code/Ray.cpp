@@ -0,0 +1,178 @@
+// Ray.cpp
+
+#include "Ray.h"
+#include "LineSegment.h"
+#include "AxisAlignedBox.h"
+#include "BatchTransform.h"
+#include "Simd.h"
+
+using namespace _3DMath;
+
+static inline bool UseAVX2( void )
+{
+	return BatchTransform::GetSupportedInstructions() == BatchTransform::INSTRUCTIONS_AVX2;
+}
+
+//---------------------------------------------------------------------
+//                                 Ray
+//---------------------------------------------------------------------
+
+Ray::Ray( void )
+{
+	Set( Vector( 0.0, 0.0, 0.0 ), Vector( 0.0, 0.0, 1.0 ) );
+}
+
+Ray::Ray( const Ray& ray )
+{
+	origin = ray.origin;
+	direction = ray.direction;
+	inverseDirection = ray.inverseDirection;
+
+	for( int i = 0; i < 3; i++ )
+		sign[i] = ray.sign[i];
+}
+
+Ray::Ray( const Vector& origin, const Vector& direction )
+{
+	Set( origin, direction );
+}
+
+Ray::Ray( const LineSegment& lineSegment )
+{
+	Vector direction;
+	direction.Subtract( lineSegment.vertex[1], lineSegment.vertex[0] );
+	Set( lineSegment.vertex[0], direction );
+}
+
+Ray::~Ray( void )
+{
+}
+
+void Ray::Set( const Vector& origin, const Vector& direction )
+{
+	this->origin = origin;
+	this->direction = direction;
+
+	inverseDirection.Set( 1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z );
+
+	sign[0] = ( inverseDirection.x < 0.0 ) ? 1 : 0;
+	sign[1] = ( inverseDirection.y < 0.0 ) ? 1 : 0;
+	sign[2] = ( inverseDirection.z < 0.0 ) ? 1 : 0;
+}
+
+void Ray::GetPoint( double t, Vector& point ) const
+{
+	point = origin;
+	point.AddScale( direction, t );
+}
+
+//---------------------------------------------------------------------
+//                               RayBlock
+//---------------------------------------------------------------------
+
+#if defined _3DMATH_X86
+
+// The lanes' signs differ, so each slab is ordered with a min and max rather than chosen by sign.
+// Where a ray lies in a slab's plane the product is a NaN, and max_pd/min_pd return their second
+// operand, the running interval, for it.
+_3DMATH_TARGET_AVX2 static int IntersectBoxAVX2( const RayBlock& block, const AxisAlignedBox& box, double* tEntryArray, double* tExitArray, double tMin, double tMax )
+{
+	const double negCorner[3] = { box.negCorner.x, box.negCorner.y, box.negCorner.z };
+	const double posCorner[3] = { box.posCorner.x, box.posCorner.y, box.posCorner.z };
+
+	__m256d tEntry = _mm256_set1_pd( tMin );
+	__m256d tExit = _mm256_set1_pd( tMax );
+
+	for( int i = 0; i < 3; i++ )
+	{
+		__m256d origin = _mm256_loadu_pd( block.origin[i] );
+		__m256d inverseDirection = _mm256_loadu_pd( block.inverseDirection[i] );
+
+		__m256d tNeg = _mm256_mul_pd( _mm256_sub_pd( _mm256_set1_pd( negCorner[i] ), origin ), inverseDirection );
+		__m256d tPos = _mm256_mul_pd( _mm256_sub_pd( _mm256_set1_pd( posCorner[i] ), origin ), inverseDirection );
+
+		// Each lane's sign picks its near and far planes, as in AxisAlignedBox::IntersectRay, rather than
+		// ordering the two with min and max, which would let a NaN through for a ray lying in a slab plane.
+		__m256d negative = _mm256_cmp_pd( inverseDirection, _mm256_setzero_pd(), _CMP_LT_OQ );
+		__m256d t0 = _mm256_blendv_pd( tNeg, tPos, negative );
+		__m256d t1 = _mm256_blendv_pd( tPos, tNeg, negative );
+
+		// With a NaN in either operand, these return the second, the running interval.
+		tEntry = _mm256_max_pd( t0, tEntry );
+		tExit = _mm256_min_pd( t1, tExit );
+	}
+
+	_mm256_storeu_pd( tEntryArray, tEntry );
+	_mm256_storeu_pd( tExitArray, tExit );
+
+	return _mm256_movemask_pd( _mm256_cmp_pd( tEntry, tExit, _CMP_LE_OQ ) ) & ( ( 1 << block.count ) - 1 );
+}
+
+#endif //_3DMATH_X86
+
+RayBlock::RayBlock( void )
+{
+	Clear();
+}
+
+RayBlock::~RayBlock( void )
+{
+}
+
+void RayBlock::Clear( void )
+{
+	for( int i = 0; i < 3; i++ )
+	{
+		for( int j = 0; j < SIZE; j++ )
+		{
+			origin[i][j] = 0.0;
+			inverseDirection[i][j] = 0.0;
+		}
+	}
+
+	count = 0;
+}
+
+bool RayBlock::Add( const Ray& ray )
+{
+	if( count == SIZE )
+		return false;
+
+	origin[0][ count ] = ray.origin.x;
+	origin[1][ count ] = ray.origin.y;
+	origin[2][ count ] = ray.origin.z;
+
+	inverseDirection[0][ count ] = ray.inverseDirection.x;
+	inverseDirection[1][ count ] = ray.inverseDirection.y;
+	inverseDirection[2][ count ] = ray.inverseDirection.z;
+
+	count++;
+	return true;
+}
+
+int RayBlock::IntersectBox( const AxisAlignedBox& box, double* tEntryArray, double* tExitArray, double tMin /*= 0.0*/, double tMax /*= HUGE_VAL*/ ) const
+{
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		return IntersectBoxAVX2( *this, box, tEntryArray, tExitArray, tMin, tMax );
+#endif
+
+	int hitMask = 0;
+
+	for( int i = 0; i < count; i++ )
+	{
+		Ray ray;
+		ray.origin.Set( origin[0][i], origin[1][i], origin[2][i] );
+		ray.inverseDirection.Set( inverseDirection[0][i], inverseDirection[1][i], inverseDirection[2][i] );
+		ray.sign[0] = ( ray.inverseDirection.x < 0.0 ) ? 1 : 0;
+		ray.sign[1] = ( ray.inverseDirection.y < 0.0 ) ? 1 : 0;
+		ray.sign[2] = ( ray.inverseDirection.z < 0.0 ) ? 1 : 0;
+
+		if( box.IntersectRay( ray, tEntryArray[i], tExitArray[i], tMin, tMax ) )
+			hitMask |= 1 << i;
+	}
+
+	return hitMask;
+}
+
+// Ray.cpp
@@ -0,0 +1,67 @@
+// Ray.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+
+namespace _3DMath
+{
+	class Ray;
+	class RayBlock;
+	class LineSegment;
+	class AxisAlignedBox;
+}
+
+// A ray carries the reciprocal of its direction and the sign of each component, which is what
+// the slab test against axis-aligned boxes needs; set up once, a ray is cheap to test against many
+// boxes.  Points on the ray are origin + t * direction.  A zero direction component gives an
+// infinite reciprocal, which the slab tests handle.
+class _3DMATH_API _3DMath::Ray
+{
+public:
+
+	Ray( void );
+	Ray( const Ray& ray );
+	Ray( const Vector& origin, const Vector& direction );
+
+	// The ray runs from the first vertex and reaches the second at t = 1.
+	Ray( const LineSegment& lineSegment );
+
+	~Ray( void );
+
+	void Set( const Vector& origin, const Vector& direction );
+	void GetPoint( double t, Vector& point ) const;
+
+	Vector origin;
+	Vector direction;
+	Vector inverseDirection;
+	int sign[3];	// One where the direction component is negative.
+};
+
+// This holds up to SIZE rays, one component per array, so that they can all be tested against one
+// box at once with AVX2, as when a bundle of coherent rays descends a tree together.
+class _3DMATH_API _3DMath::RayBlock
+{
+public:
+
+	enum { SIZE = 4 };
+
+	RayBlock( void );
+	~RayBlock( void );
+
+	void Clear( void );
+
+	// False is returned if the block is full.
+	bool Add( const Ray& ray );
+
+	// Bit i of the result is set if ray i meets the box within [tMin,tMax], in which case
+	// tEntryArray[i] and tExitArray[i] give where.
+	int IntersectBox( const AxisAlignedBox& box, double* tEntryArray, double* tExitArray, double tMin = 0.0, double tMax = HUGE_VAL ) const;
+
+	double origin[3][SIZE];
+	double inverseDirection[3][SIZE];
+	int count;
+};
+
+// Ray.h
@@ -0,0 +1,80 @@
+// Simd.h
+
+#pragma once
+
+// This is an internal header for translation units that carry hand-vectorized kernels.  The
+// library itself is built for the baseline instruction set, so each wider kernel is compiled
+// for its own target and only called after BatchTransform::GetSupportedInstructions() says so.
+// Kernels that must round exactly as scalar code does use the target without FMA, since GCC
+// will otherwise contract a multiply and an add, even written as intrinsics, into one.
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#	define _3DMATH_X86
+#	define _3DMATH_TARGET_SSE2		__attribute__(( target( "sse2" ) ))
+#	define _3DMATH_TARGET_AVX2		__attribute__(( target( "avx2,fma" ) ))
+#	define _3DMATH_TARGET_AVX2_NOFMA	__attribute__(( target( "avx2" ) ))
+#	include <immintrin.h>
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#	define _3DMATH_X86
+#	define _3DMATH_TARGET_SSE2
+#	define _3DMATH_TARGET_AVX2
+#	define _3DMATH_TARGET_AVX2_NOFMA
+#	include <intrin.h>
+#	include <immintrin.h>
+#endif
+
+#if defined _3DMATH_X86
+
+// Four packed Vectors are twelve doubles: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3.  These transpose
+// them to and from one register per component.
+_3DMATH_TARGET_AVX2 static inline void LoadPackedVectors( const double* data, __m256d& x, __m256d& y, __m256d& z )
+{
+	__m256d a = _mm256_loadu_pd( data );
+	__m256d b = _mm256_loadu_pd( data + 4 );
+	__m256d c = _mm256_loadu_pd( data + 8 );
+
+	__m256d u = _mm256_permute2f128_pd( a, b, 0x30 );	// x0 y0 x2 y2
+	__m256d v = _mm256_permute2f128_pd( a, c, 0x21 );	// z0 x1 z2 x3
+	__m256d w = _mm256_permute2f128_pd( b, c, 0x30 );	// y1 z1 y3 z3
+
+	x = _mm256_blend_pd( u, v, 0xA );
+	y = _mm256_shuffle_pd( u, w, 0x5 );
+	z = _mm256_blend_pd( v, w, 0xA );
+}
+
+_3DMATH_TARGET_AVX2 static inline void StorePackedVectors( double* data, __m256d x, __m256d y, __m256d z )
+{
+	__m256d u = _mm256_unpacklo_pd( x, y );
+	__m256d v = _mm256_blend_pd( z, x, 0xA );
+	__m256d w = _mm256_unpackhi_pd( y, z );
+
+	_mm256_storeu_pd( data, _mm256_permute2f128_pd( u, v, 0x20 ) );
+	_mm256_storeu_pd( data + 4, _mm256_permute2f128_pd( w, u, 0x30 ) );
+	_mm256_storeu_pd( data + 8, _mm256_permute2f128_pd( v, w, 0x31 ) );
+}
+
+// A single Vector occupies the low three lanes; the masked forms never touch the double beyond it.
+_3DMATH_TARGET_AVX2 static inline __m256i VectorMask( void )
+{
+	return _mm256_set_epi64x( 0, -1, -1, -1 );
+}
+
+_3DMATH_TARGET_AVX2 static inline __m256d LoadVector( const double* data )
+{
+	return _mm256_maskload_pd( data, VectorMask() );
+}
+
+_3DMATH_TARGET_AVX2 static inline void StoreVector( double* data, __m256d vector )
+{
+	_mm256_maskstore_pd( data, VectorMask(), vector );
+}
+
+_3DMATH_TARGET_AVX2 static inline double HorizontalSum( __m256d vector )
+{
+	__m128d sum = _mm_add_pd( _mm256_castpd256_pd128( vector ), _mm256_extractf128_pd( vector, 1 ) );
+	return _mm_cvtsd_f64( _mm_add_sd( sum, _mm_unpackhi_pd( sum, sum ) ) );
+}
+
+#endif //_3DMATH_X86
+
+// Simd.h
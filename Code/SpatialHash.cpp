@@ -0,0 +1,172 @@
+// SpatialHash.cpp
+
+#include "SpatialHash.h"
+
+using namespace _3DMath;
+
+#define MAX_VISITED_BUCKETS		64
+
+SpatialHash::SpatialHash( void )
+{
+	cellSize = 1.0;
+	inverseCellSize = 1.0;
+	bucketMask = 0;
+
+	bucketStartArray = new std::vector< int >;
+	sortedIndexArray = new std::vector< int >;
+	sortedPointArray = new VectorArray;
+	pointBucketArray = new std::vector< uint32_t >;
+
+	Clear();
+}
+
+/*virtual*/ SpatialHash::~SpatialHash( void )
+{
+	delete bucketStartArray;
+	delete sortedIndexArray;
+	delete sortedPointArray;
+	delete pointBucketArray;
+}
+
+void SpatialHash::Clear( void )
+{
+	bucketMask = 0;
+
+	bucketStartArray->assign( 2, 0 );
+	sortedIndexArray->clear();
+	sortedPointArray->clear();
+	pointBucketArray->clear();
+}
+
+void SpatialHash::GetCell( const Vector& point, int* cell ) const
+{
+	cell[0] = ( int )int64_t( floor( point.x * inverseCellSize ) );
+	cell[1] = ( int )int64_t( floor( point.y * inverseCellSize ) );
+	cell[2] = ( int )int64_t( floor( point.z * inverseCellSize ) );
+}
+
+uint32_t SpatialHash::GetBucket( const int* cell ) const
+{
+	uint32_t hash = ( uint32_t( cell[0] ) * 73856093u ) ^ ( uint32_t( cell[1] ) * 19349663u ) ^ ( uint32_t( cell[2] ) * 83492791u );
+	return hash & bucketMask;
+}
+
+void SpatialHash::Build( const Vector* pointArray, int pointCount, double cellSize )
+{
+	this->cellSize = cellSize;
+	inverseCellSize = 1.0 / cellSize;
+
+	uint32_t bucketCount = 16;
+	while( bucketCount < 2 * uint32_t( pointCount ) )
+		bucketCount <<= 1;
+
+	bucketMask = bucketCount - 1;
+
+	bucketStartArray->assign( bucketCount + 1, 0 );
+	sortedIndexArray->resize( pointCount );
+	sortedPointArray->resize( pointCount );
+	pointBucketArray->resize( pointCount );
+
+	int* bucketStart = &( *bucketStartArray )[0];
+	uint32_t* pointBucket = pointCount > 0 ? &( *pointBucketArray )[0] : nullptr;
+
+	for( int i = 0; i < pointCount; i++ )
+	{
+		int cell[3];
+		GetCell( pointArray[i], cell );
+		pointBucket[i] = GetBucket( cell );
+		bucketStart[ pointBucket[i] ]++;
+	}
+
+	// After this, each entry is the end of its bucket; filling the buckets from the back then leaves
+	// each entry at the start of its bucket, with the points of a bucket in their original order.
+	int sum = 0;
+	for( uint32_t i = 0; i <= bucketCount; i++ )
+	{
+		sum += bucketStart[i];
+		bucketStart[i] = sum;
+	}
+
+	for( int i = pointCount - 1; i >= 0; i-- )
+	{
+		int j = --bucketStart[ pointBucket[i] ];
+		( *sortedIndexArray )[j] = i;
+		( *sortedPointArray )[j] = pointArray[i];
+	}
+}
+
+int SpatialHash::FindNeighbors( const Vector& point, double radius, std::vector< int >& indexArray ) const
+{
+	int pointCount = GetPointCount();
+	if( pointCount == 0 )
+		return 0;
+
+	const int* bucketStart = &( *bucketStartArray )[0];
+	double radiusSquared = radius * radius;
+
+	int minCell[3], maxCell[3];
+	GetCell( Vector( point.x - radius, point.y - radius, point.z - radius ), minCell );
+	GetCell( Vector( point.x + radius, point.y + radius, point.z + radius ), maxCell );
+
+	int64_t cellCount = 1;
+	for( int i = 0; i < 3; i++ )
+		cellCount *= int64_t( maxCell[i] ) - int64_t( minCell[i] ) + 1;
+
+	// Past a handful of cells it's no slower to just look at every point.
+	if( cellCount > MAX_VISITED_BUCKETS )
+		return FindNeighbors( 0, pointCount, point, radiusSquared, indexArray );
+
+	// Distinct cells can share a bucket, and each bucket must be visited only once.
+	uint32_t visitedBucketArray[ MAX_VISITED_BUCKETS ];
+	int visitedBucketCount = 0;
+	int foundCount = 0;
+
+	int cell[3];
+	for( cell[0] = minCell[0]; cell[0] <= maxCell[0]; cell[0]++ )
+	{
+		for( cell[1] = minCell[1]; cell[1] <= maxCell[1]; cell[1]++ )
+		{
+			for( cell[2] = minCell[2]; cell[2] <= maxCell[2]; cell[2]++ )
+			{
+				uint32_t bucket = GetBucket( cell );
+
+				int i;
+				for( i = 0; i < visitedBucketCount; i++ )
+					if( visitedBucketArray[i] == bucket )
+						break;
+
+				if( i < visitedBucketCount )
+					continue;
+
+				visitedBucketArray[ visitedBucketCount++ ] = bucket;
+				foundCount += FindNeighbors( bucketStart[ bucket ], bucketStart[ bucket + 1 ], point, radiusSquared, indexArray );
+			}
+		}
+	}
+
+	return foundCount;
+}
+
+int SpatialHash::FindNeighbors( int begin, int end, const Vector& point, double radiusSquared, std::vector< int >& indexArray ) const
+{
+	int foundCount = 0;
+
+	for( int i = begin; i < end; i++ )
+	{
+		const Vector& sortedPoint = ( *sortedPointArray )[i];
+
+		double dx = sortedPoint.x - point.x;
+		double dy = sortedPoint.y - point.y;
+		double dz = sortedPoint.z - point.z;
+
+		if( dx * dx + dy * dy + dz * dz <= radiusSquared )
+		{
+			indexArray.push_back( ( *sortedIndexArray )[i] );
+			foundCount++;
+		}
+	}
+
+	return foundCount;
+}
+
+// SpatialHash.cpp
@@ -0,0 +1,53 @@
+// SpatialHash.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+
+namespace _3DMath
+{
+	class SpatialHash;
+}
+
+// This buckets points by the cell of a uniform grid they fall in, hashing the cells into a table
+// about twice the size of the point set so that an unbounded grid costs memory only where there are
+// points.  It's rebuilt from scratch with a counting sort rather than updated, which for points that
+// all move every step is both simpler and faster, and leaves each bucket's points contiguous.
+class _3DMATH_API _3DMath::SpatialHash
+{
+public:
+
+	SpatialHash( void );
+	virtual ~SpatialHash( void );
+
+	void Build( const Vector* pointArray, int pointCount, double cellSize );
+	void Clear( void );
+
+	// The indices of the points within the given radius of the given point are appended to the given
+	// array, in no particular order; the number appended is returned.  A radius no bigger than the
+	// cell size visits at most 27 cells.
+	int FindNeighbors( const Vector& point, double radius, std::vector< int >& indexArray ) const;
+
+	int GetPointCount( void ) const { return ( int )sortedIndexArray->size(); }
+	double GetCellSize( void ) const { return cellSize; }
+
+private:
+
+	void GetCell( const Vector& point, int* cell ) const;
+	uint32_t GetBucket( const int* cell ) const;
+
+	// This looks over [begin,end) of the sorted points.
+	int FindNeighbors( int begin, int end, const Vector& point, double radiusSquared, std::vector< int >& indexArray ) const;
+
+	double cellSize;
+	double inverseCellSize;
+	uint32_t bucketMask;
+
+	std::vector< int >* bucketStartArray;		// Bucket b's points are [bucketStartArray[b],bucketStartArray[b+1]) of the sorted arrays.
+	std::vector< int >* sortedIndexArray;
+	VectorArray* sortedPointArray;
+	std::vector< uint32_t >* pointBucketArray;
+};
+
+// SpatialHash.h
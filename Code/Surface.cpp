@@ -13,7 +13,7 @@ using namespace _3DMath;
 //                                  SurfacePoint
 //-------------------------------------------------------------------------------
 
-SurfacePoint::SurfacePoint( int surfaceHandle )
+SurfacePoint::SurfacePoint( ObjectHandle surfaceHandle )
 {
 	this->surfaceHandle = surfaceHandle;
 }
@@ -26,7 +26,7 @@ SurfacePoint::SurfacePoint( int surfaceHandle )
 //                               GenericSurfacePoint
 //-------------------------------------------------------------------------------
 
-GenericSurfacePoint::GenericSurfacePoint( int surfaceHandle ) : SurfacePoint( surfaceHandle )
+GenericSurfacePoint::GenericSurfacePoint( ObjectHandle surfaceHandle ) : SurfacePoint( surfaceHandle )
 {
 }
 
@@ -132,7 +132,7 @@ Surface::Surface( void )
 //                            PlaneSurface::Point
 //-------------------------------------------------------------------------------
 
-PlaneSurface::Point::Point( int surfaceHandle ) : SurfacePoint( surfaceHandle )
+PlaneSurface::Point::Point( ObjectHandle surfaceHandle ) : SurfacePoint( surfaceHandle )
 {
 }
 
@@ -234,7 +234,7 @@ PlaneSurface::PlaneSurface( const Plane& plane )
 //                              SphereSurface::Point
 //-------------------------------------------------------------------------------
 
-SphereSurface::Point::Point( int surfaceHandle ) : SurfacePoint( surfaceHandle )
+SphereSurface::Point::Point( ObjectHandle surfaceHandle ) : SurfacePoint( surfaceHandle )
 {
 }
 
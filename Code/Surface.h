@@ -33,20 +33,20 @@ class _3DMATH_API _3DMath::SurfacePoint
 {
 public:
 
-	SurfacePoint( int surfaceHandle );
+	SurfacePoint( ObjectHandle surfaceHandle );
 	virtual ~SurfacePoint( void );
 
 	virtual bool GetLocation( Vector& location ) const = 0;
 	virtual bool GetTangentSpace( LinearTransform& tangentSpace ) const = 0;
 
-	int surfaceHandle;
+	ObjectHandle surfaceHandle;
 };
 
 class _3DMATH_API _3DMath::GenericSurfacePoint : public SurfacePoint
 {
 public:
 
-	GenericSurfacePoint( int surfaceHandle );
+	GenericSurfacePoint( ObjectHandle surfaceHandle );
 	virtual ~GenericSurfacePoint( void );
 
 	virtual bool GetLocation( Vector& location ) const override;
@@ -97,7 +97,7 @@ public:
 	{
 	public:
 
-		Point( int surfaceHandle );
+		Point( ObjectHandle surfaceHandle );
 		virtual ~Point( void );
 
 		virtual bool GetLocation( Vector& location ) const override;
@@ -126,7 +126,7 @@ public:
 	{
 	public:
 
-		Point( int surfaceHandle );
+		Point( ObjectHandle surfaceHandle );
 		virtual ~Point( void );
 
 		virtual bool GetLocation( Vector& location ) const override;
@@ -103,15 +103,111 @@ bool Triangle::IsDegenerate( double eps /*= EPSILON*/ ) const
 	return false;
 }
 
+// With the normal n = e1 x e2 in hand, the Moller-Trumbore determinants reduce to one cross product and four dot products.
+static inline bool IntersectRayWithSlack( const Vector& vertex0, const Vector& edge1, const Vector& edge2, const Vector& origin, const Vector& direction, double slack, double tMin, double tMax, double& t, double& u, double& v )
+{
+	Vector normal;
+	normal.Cross( edge1, edge2 );
+
+	double det = -direction.Dot( normal );
+	if( det == 0.0 )
+		return false;
+
+	Vector originVector, cross;
+	originVector.Subtract( origin, vertex0 );
+	cross.Cross( originVector, direction );
+
+	double invDet = 1.0 / det;
+	u = edge2.Dot( cross ) * invDet;
+	v = -edge1.Dot( cross ) * invDet;
+	t = originVector.Dot( normal ) * invDet;
+
+	return u >= -slack && v >= -slack && u + v <= 1.0 + slack && t >= tMin && t <= tMax;
+}
+
 bool Triangle::Intersect( const LineSegment& lineSegment, Vector& intersectionPoint, double eps /*= EPSILON*/ ) const
 {
-	Plane plane;
-	GetPlane( plane );
+	Vector edge1, edge2, direction;
+	edge1.Subtract( vertex[1], vertex[0] );
+	edge2.Subtract( vertex[2], vertex[0] );
+	direction.Subtract( lineSegment.vertex[1], lineSegment.vertex[0] );
 
-	if( !plane.Intersect( lineSegment, intersectionPoint, eps ) )
+	double t, u, v;
+	if( !IntersectRayWithSlack( vertex[0], edge1, edge2, lineSegment.vertex[0], direction, eps, -eps, 1.0 + eps, t, u, v ) )
 		return false;
 
-	return ContainsPoint( intersectionPoint, eps );
+	lineSegment.Lerp( t, intersectionPoint );
+	return true;
+}
+
+bool Triangle::IntersectRay( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin /*= 0.0*/, double tMax /*= HUGE_VAL*/ ) const
+{
+	Vector edge1, edge2;
+	edge1.Subtract( vertex[1], vertex[0] );
+	edge2.Subtract( vertex[2], vertex[0] );
+
+	return IntersectRayWithSlack( vertex[0], edge1, edge2, origin, direction, 0.0, tMin, tMax, t, u, v );
+}
+
+// The vertices are moved into a frame where the ray starts at the origin and runs along +z, by a
+// permutation of the axes and a shear.  The edge tests are then 2D and made on the very same
+// numbers for both triangles that share an edge, so the two can't both reject a ray through it.
+bool Triangle::IntersectRayWatertight( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin /*= 0.0*/, double tMax /*= HUGE_VAL*/ ) const
+{
+	double rayDirection[3] = { direction.x, direction.y, direction.z };
+
+	int kz = 0;
+	if( fabs( rayDirection[1] ) > fabs( rayDirection[kz] ) )
+		kz = 1;
+	if( fabs( rayDirection[2] ) > fabs( rayDirection[kz] ) )
+		kz = 2;
+
+	if( rayDirection[kz] == 0.0 )
+		return false;
+
+	// Swapping the other two axes keeps the winding, and with it the sign of the determinant, the same.
+	int kx = ( kz + 1 ) % 3;
+	int ky = ( kx + 1 ) % 3;
+	if( rayDirection[kz] < 0.0 )
+	{
+		int k = kx;
+		kx = ky;
+		ky = k;
+	}
+
+	double shearX = rayDirection[kx] / rayDirection[kz];
+	double shearY = rayDirection[ky] / rayDirection[kz];
+	double shearZ = 1.0 / rayDirection[kz];
+
+	double x[3], y[3], z[3];
+	for( int i = 0; i < 3; i++ )
+	{
+		double relative[3] = { vertex[i].x - origin.x, vertex[i].y - origin.y, vertex[i].z - origin.z };
+		x[i] = relative[kx] - shearX * relative[kz];
+		y[i] = relative[ky] - shearY * relative[kz];
+		z[i] = shearZ * relative[kz];
+	}
+
+	// Scaled barycentric weights of vertex 0, 1 and 2.
+	double weight0 = x[2] * y[1] - y[2] * x[1];
+	double weight1 = x[0] * y[2] - y[0] * x[2];
+	double weight2 = x[1] * y[0] - y[1] * x[0];
+
+	if( ( weight0 < 0.0 || weight1 < 0.0 || weight2 < 0.0 ) && ( weight0 > 0.0 || weight1 > 0.0 || weight2 > 0.0 ) )
+		return false;
+
+	double det = weight0 + weight1 + weight2;
+	if( det == 0.0 )
+		return false;
+
+	double invDet = 1.0 / det;
+	t = ( weight0 * z[0] + weight1 * z[1] + weight2 * z[2] ) * invDet;
+	if( t < tMin || t > tMax )
+		return false;
+
+	u = weight1 * invDet;
+	v = weight2 * invDet;
+	return true;
 }
 
 void Triangle::GetEdges( LineSegment* edges ) const
@@ -124,38 +220,86 @@ void Triangle::GetEdges( LineSegment* edges ) const
 	}
 }
 
-double Triangle::DistanceToPoint( const Vector& point ) const
+// Each region of the triangle's plane (vertex, edge or face) is tested in turn, using the six dot
+// products of the edges from vertex[0] and vertex[1] with the vectors to the point.
+double Triangle::ClosestPoint( const Vector& point, Vector& closestPoint, double& u, double& v ) const
 {
-	Plane plane;
-	GetPlane( plane );
+	Vector edge1, edge2, pointVector;
+	edge1.Subtract( vertex[1], vertex[0] );
+	edge2.Subtract( vertex[2], vertex[0] );
+	pointVector.Subtract( point, vertex[0] );
 
-	double distance = fabs( plane.Distance( point ) );
-	Vector nearestPoint = point;
-	plane.NearestPoint( nearestPoint );
-	if( ContainsPoint( nearestPoint ) )
-		return distance;
+	double d1 = edge1.Dot( pointVector );
+	double d2 = edge2.Dot( pointVector );
 
-	LineSegment edges[3];
-	GetEdges( edges );
-
-	for( int i = 0; i < 3; i++ )
+	if( d1 <= 0.0 && d2 <= 0.0 )
 	{
-		Line line( edges[i] );
-		distance = line.ShortestDistance( point );
-		if( edges[i].ContainsPoint( point ) )
-			return distance;
+		u = 0.0;
+		v = 0.0;
 	}
+	else
+	{
+		// The dot products taken from vertex[1] and vertex[2] follow from those taken from vertex[0].
+		double edge11 = edge1.Dot( edge1 );
+		double edge12 = edge1.Dot( edge2 );
+		double edge22 = edge2.Dot( edge2 );
 
-	double smallestDistance = 0.0;
+		double d3 = d1 - edge11;
+		double d4 = d2 - edge12;
+		double d5 = d1 - edge12;
+		double d6 = d2 - edge22;
 
-	for( int i = 0; i < 3; i++ )
-	{
-		distance = vertex[i].Distance( point );
-		if( distance < smallestDistance || smallestDistance == 0.0 )
-			smallestDistance = distance;
+		double vc = d1 * d4 - d3 * d2;
+		double vb = d5 * d2 - d1 * d6;
+		double va = d3 * d6 - d5 * d4;
+
+		if( d3 >= 0.0 && d4 <= d3 )
+		{
+			u = 1.0;
+			v = 0.0;
+		}
+		else if( vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0 )
+		{
+			u = d1 / ( d1 - d3 );
+			v = 0.0;
+		}
+		else if( d6 >= 0.0 && d5 <= d6 )
+		{
+			u = 0.0;
+			v = 1.0;
+		}
+		else if( vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0 )
+		{
+			u = 0.0;
+			v = d2 / ( d2 - d6 );
+		}
+		else if( va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0 )
+		{
+			v = ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) );
+			u = 1.0 - v;
+		}
+		else
+		{
+			double invDenom = 1.0 / ( va + vb + vc );
+			u = vb * invDenom;
+			v = vc * invDenom;
+		}
 	}
 
-	return smallestDistance;
+	closestPoint = vertex[0];
+	closestPoint.AddScale( edge1, u );
+	closestPoint.AddScale( edge2, v );
+
+	Vector delta;
+	delta.Subtract( point, closestPoint );
+	return delta.Dot( delta );
+}
+
+double Triangle::DistanceToPoint( const Vector& point ) const
+{
+	Vector closestPoint;
+	double u, v;
+	return sqrt( ClosestPoint( point, closestPoint, u, v ) );
 }
 
 // Triangle.cpp
\ No newline at end of file
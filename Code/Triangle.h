@@ -29,6 +29,18 @@ public:
 	bool ProperlyContainsPoint( const Vector& point, double eps = EPSILON ) const;
 	bool IsDegenerate( double eps = EPSILON ) const;
 	bool Intersect( const LineSegment& lineSegment, Vector& intersectionPoint, double eps = EPSILON ) const;
+
+	// This is the Moller-Trumbore test.  A hit at t in [tMin,tMax] is at origin + t * direction, which is also
+	// ( 1 - u - v ) * vertex[0] + u * vertex[1] + v * vertex[2].  Either side of the triangle counts.
+	bool IntersectRay( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin = 0.0, double tMax = HUGE_VAL ) const;
+
+	// This is Woop, Benthin and Wald's watertight test, with the same conventions.  It costs a bit more, but
+	// a ray through an edge or vertex shared by several triangles is guaranteed to hit at least one of them.
+	bool IntersectRayWatertight( const Vector& origin, const Vector& direction, double& t, double& u, double& v, double tMin = 0.0, double tMax = HUGE_VAL ) const;
+
+	// This finds the point of the triangle nearest the given point by Ericson's Voronoi region test, and
+	// returns the squared distance to it.  The barycentrics u and v are those of vertex[1] and vertex[2].
+	double ClosestPoint( const Vector& point, Vector& closestPoint, double& u, double& v ) const;
 	double DistanceToPoint( const Vector& point ) const;
 
 	Vector vertex[3];
@@ -7,13 +7,22 @@
 #include "AffineTransform.h"
 #include "Renderer.h"
 #include "AxisAlignedBox.h"
+#include "VectorKernels.h"
+#include "FastMath.h"
+#include "Predicates.h"
+#include <atomic>
 
 using namespace _3DMath;
 
+// Versions are drawn from this rather than counted per mesh, so that a mesh made where another was
+// destroyed can't be mistaken for it.  Zero is never a version.
+static std::atomic< uint64_t > lastVersion( 0 );
+
 TriangleMesh::TriangleMesh( void )
 {
 	vertexArray = new VertexArray();
 	triangleList = new IndexTriangleList();
+	version = ++lastVersion;
 }
 
 /*virtual*/ TriangleMesh::~TriangleMesh( void )
@@ -26,6 +35,12 @@ void TriangleMesh::Clear( void )
 {
 	vertexArray->clear();
 	triangleList->clear();
+	MarkChanged();
+}
+
+void TriangleMesh::MarkChanged( void )
+{
+	version = ++lastVersion;
 }
 
 void TriangleMesh::Clone( const TriangleMesh& triangleMesh )
@@ -37,6 +52,8 @@ void TriangleMesh::Clone( const TriangleMesh& triangleMesh )
 
 	for( IndexTriangleList::const_iterator iter = triangleMesh.triangleList->cbegin(); iter != triangleMesh.triangleList->cend(); iter++ )
 		triangleList->push_back( *iter );
+
+	MarkChanged();
 }
 
 bool TriangleMesh::GenerateBoundingBox( AxisAlignedBox& boundingBox ) const
@@ -44,13 +61,7 @@ bool TriangleMesh::GenerateBoundingBox( AxisAlignedBox& boundingBox ) const
 	if( vertexArray->size() == 0 )
 		return false;
 
-	boundingBox.negCorner = ( *vertexArray )[0].position;
-	boundingBox.posCorner = boundingBox.negCorner;
-
-	for( int i = 1; i < ( signed )vertexArray->size(); i++ )
-		boundingBox.GrowToIncludePoint( ( *vertexArray )[i].position );
-
-	return true;
+	return VectorKernels::MinMax( &( *vertexArray )[0].position, ( int )vertexArray->size(), boundingBox.negCorner, boundingBox.posCorner, sizeof( Vertex ) );
 }
 
 void TriangleMesh::GenerateTriangleList( TriangleList& triangleList, bool skipDegenerates /*= true*/ ) const
@@ -66,12 +77,13 @@ void TriangleMesh::GenerateTriangleList( TriangleList& triangleList, bool skipDe
 	}
 }
 
-bool TriangleMesh::FindConvexHull( void )
+bool TriangleMesh::FindConvexHull( bool robust /*= false*/ )
 {
 	if( vertexArray->size() < 4 )
 		return false;
 
 	triangleList->clear();
+	MarkChanged();
 
 	VertexArray* newVertexArray = nullptr;
 
@@ -96,15 +108,28 @@ bool TriangleMesh::FindConvexHull( void )
 					if( i3 == i0 || i3 == i1 || i3 == i2 )
 						continue;
 
-					LinearTransform linearTransform;
-
-					linearTransform.xAxis.Subtract( ( *vertexArray )[i1].position, ( *vertexArray )[i0].position );
-					linearTransform.yAxis.Subtract( ( *vertexArray )[i2].position, ( *vertexArray )[i0].position );
-					linearTransform.zAxis.Subtract( ( *vertexArray )[i3].position, ( *vertexArray )[i0].position );
+					const Vector& point0 = ( *vertexArray )[i0].position;
+					const Vector& point1 = ( *vertexArray )[i1].position;
+					const Vector& point2 = ( *vertexArray )[i2].position;
+					const Vector& point3 = ( *vertexArray )[i3].position;
 
 					// In the strictest sense, it need only be greater than zero,
 					// but I want a tetrahedron that is no where near degenerate.
-					double det = linearTransform.Determinant();
+					// The exact test can afford to take the strict sense.
+					double det;
+					if( robust )
+						det = Predicates::Orient3D( point0, point1, point2, point3 ) > 0.0 ? 1.0 : 0.0;
+					else
+					{
+						LinearTransform linearTransform;
+
+						linearTransform.xAxis.Subtract( point1, point0 );
+						linearTransform.yAxis.Subtract( point2, point0 );
+						linearTransform.zAxis.Subtract( point3, point0 );
+
+						det = linearTransform.Determinant();
+					}
+
 					if( det > EPSILON )
 					{
 						newVertexArray = new VertexArray();
@@ -172,10 +197,21 @@ bool TriangleMesh::FindConvexHull( void )
 
 				if( !indexTriangle.HasVertex( index ) )
 				{
-					Plane plane;
-					indexTriangle.GetPlane( plane, newVertexArray );
+					bool inFront;
+					if( robust )
+					{
+						Triangle triangle;
+						indexTriangle.GetTriangle( triangle, newVertexArray );
+						inFront = Predicates::Orient3D( triangle.vertex[0], triangle.vertex[1], triangle.vertex[2], point.position ) > 0.0;
+					}
+					else
+					{
+						Plane plane;
+						indexTriangle.GetPlane( plane, newVertexArray );
+						inFront = plane.GetSide( point.position ) == Plane::SIDE_FRONT;
+					}
 
-					if( plane.GetSide( point.position ) == Plane::SIDE_FRONT )
+					if( inFront )
 					{
 						AddOrRemoveTriangle( IndexTriangle( index, indexTriangle.vertex[0], indexTriangle.vertex[1] ) );
 						AddOrRemoveTriangle( IndexTriangle( index, indexTriangle.vertex[1], indexTriangle.vertex[2] ) );
@@ -203,11 +239,13 @@ void TriangleMesh::AddOrRemoveTriangle( const IndexTriangle& givenIndexTriangle
 		if( givenIndexTriangle.CoincidentWith( indexTriangle ) )
 		{
 			triangleList->erase( iter );
+			MarkChanged();
 			return;
 		}
 	}
 
 	triangleList->push_back( givenIndexTriangle );
+	MarkChanged();
 }
 
 void TriangleMesh::CalculateCenter( Vector& center ) const
@@ -216,20 +254,17 @@ void TriangleMesh::CalculateCenter( Vector& center ) const
 
 	if( vertexArray->size() > 0 )
 	{
-		for( int i = 0; i < ( int )vertexArray->size(); i++ )
-			center.Add( ( *vertexArray )[i].position );
-
+		VectorKernels::Sum( &( *vertexArray )[0].position, ( int )vertexArray->size(), center, sizeof( Vertex ) );
 		center.Scale( 1.0 / double( vertexArray->size() ) );
 	}
 }
 
 void TriangleMesh::CalculateNormals( void )
 {
-	for( int i = 0; i < ( int )vertexArray->size(); i++ )
-	{
-		Vertex* vertex = &( *vertexArray )[i];
-		vertex->normal.Set( 0.0, 0.0, 0.0 );
-	}
+	if( vertexArray->size() == 0 )
+		return;
+
+	VectorKernels::Fill( &( *vertexArray )[0].normal, Vector( 0.0, 0.0, 0.0 ), ( int )vertexArray->size(), sizeof( Vertex ) );
 
 	for( IndexTriangleList::iterator iter = triangleList->begin(); iter != triangleList->end(); iter++ )
 	{
@@ -245,24 +280,38 @@ void TriangleMesh::CalculateNormals( void )
 		}
 	}
 
-	for( int i = 0; i < ( int )vertexArray->size(); i++ )
-	{
-		Vertex* vertex = &( *vertexArray )[i];
-		vertex->normal.Normalize();
-	}
+	VectorKernels::Normalize( &( *vertexArray )[0].normal, ( int )vertexArray->size(), sizeof( Vertex ) );
 }
 
+// The angles are taken over whole arrays so that the fast math tier, if enabled, can vectorize them.
 void TriangleMesh::CalculateSphericalUVs( void )
 {
-	for( int i = 0; i < ( int )vertexArray->size(); i++ )
-	{
-		Vertex* vertex = &( *vertexArray )[i];
+	int arraySize = ( int )vertexArray->size();
+	if( arraySize == 0 )
+		return;
+
+	std::vector< double > xArray( arraySize ), yArray( arraySize ), zArray( arraySize );
 
+	for( int i = 0; i < arraySize; i++ )
+	{
 		Vector unitSpherePoint;
-		vertex->position.GetNormalized( unitSpherePoint );
+		( *vertexArray )[i].position.GetNormalized( unitSpherePoint );
+
+		xArray[i] = unitSpherePoint.x;
+		yArray[i] = unitSpherePoint.y;
+		zArray[i] = unitSpherePoint.z;
+	}
 
-		double lattitudeAngle = acos( unitSpherePoint.y );
-		double longitudeAngle = atan2( unitSpherePoint.z, unitSpherePoint.x );
+	// The lattitude angles overwrite the y components and the longitude angles the z components.
+	FastMath::ACos( &yArray[0], &yArray[0], arraySize );
+	FastMath::ATan2( &zArray[0], &xArray[0], &zArray[0], arraySize );
+
+	for( int i = 0; i < arraySize; i++ )
+	{
+		Vertex* vertex = &( *vertexArray )[i];
+
+		double lattitudeAngle = yArray[i];
+		double longitudeAngle = zArray[i];
 		if( longitudeAngle < 0.0 )
 			longitudeAngle += 2.0 * M_PI;
 
@@ -303,11 +352,14 @@ void TriangleMesh::SubdivideAllTriangles( double radius )
 
 		iter = nextIter;
 	}
+
+	MarkChanged();
 }
 
 void TriangleMesh::Transform( const AffineTransform& affineTransform )
 {
 	affineTransform.Transform( *vertexArray );
+	MarkChanged();
 }
 
 bool TriangleMesh::SetVertexPosition( int index, const Vector& position )
@@ -316,6 +368,7 @@ bool TriangleMesh::SetVertexPosition( int index, const Vector& position )
 		return false;
 
 	( *vertexArray )[ index ].position = position;
+	MarkChanged();
 	return true;
 }
 
@@ -334,6 +387,7 @@ bool TriangleMesh::SetVertex( int index, const Vertex& vertex )
 		return false;
 
 	( *vertexArray )[ index ] = vertex;
+	MarkChanged();
 	return true;
 }
 
@@ -439,6 +493,8 @@ void TriangleMesh::AddSymmetricVertices( const Vector& vector )
 
 		vertexArray->push_back( vertex );
 	}
+
+	MarkChanged();
 }
 
 void TriangleMesh::Compress( void )
@@ -473,6 +529,7 @@ void TriangleMesh::Compress( void )
 
 	delete vertexArray;
 	vertexArray = compressedVertexArray;
+	MarkChanged();
 }
 
 bool TriangleMesh::GeneratePolygonFaceList( PolygonList& polygonFaceList, double eps /*= EPSILON*/ ) const
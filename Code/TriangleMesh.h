@@ -28,7 +28,8 @@ public:
 
 	void Clear( void );
 	void Clone( const TriangleMesh& triangleMesh );
-	bool FindConvexHull( void );
+	// The robust mode makes every above-or-below decision with exact predicates instead of EPSILON tests.
+	bool FindConvexHull( bool robust = false );
 	void AddOrRemoveTriangle( const IndexTriangle& givenIndexTriangle );
 	void CalculateNormals( void );
 	void CalculateSphericalUVs( void );
@@ -62,10 +63,20 @@ public:
 
 	bool ValidIndex( int index ) const;
 
+	// This changes each time a method here changes the vertex positions or the triangles, and no two
+	// meshes ever share one, so that whatever is derived from the geometry can be cached against it.
+	// Code that changes the arrays directly must call MarkChanged itself.
+	uint64_t GetVersion( void ) const { return version; }
+	void MarkChanged( void );
+
 	// TODO: May want to write a tri-stripper one day.
 
 	std::vector< Vertex >* vertexArray;
 	IndexTriangleList* triangleList;
+
+private:
+
+	uint64_t version;
 };
 
 // TriangleMesh.h
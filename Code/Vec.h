@@ -0,0 +1,295 @@
+// Vec.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+
+// These are header-only, fixed-size counterparts to the Vector class.  Everything here is
+// inline, and whatever can be is constexpr (C++11 flavor, so each function is a single return
+// statement), which lets the compiler fold and vectorize hot geometry loops instead of calling
+// across the library boundary.  Vec is an aggregate, so it can be brace-initialized: Vec3d{ { 1.0, 2.0, 3.0 } }.
+
+namespace _3DMath
+{
+	template< int... Indices >
+	struct IndexSequence
+	{
+	};
+
+	template< int Count, int... Indices >
+	struct MakeIndexSequence : MakeIndexSequence< Count - 1, Count - 1, Indices... >
+	{
+	};
+
+	template< int... Indices >
+	struct MakeIndexSequence< 0, Indices... >
+	{
+		typedef IndexSequence< Indices... > Type;
+	};
+
+	template< typename Type, int Size >
+	struct Vec
+	{
+		constexpr Type operator[]( int i ) const & { return c[i]; }
+		Type& operator[]( int i ) & { return c[i]; }
+
+		Type c[ Size ];
+	};
+
+	typedef Vec< float, 2 > Vec2f;
+	typedef Vec< float, 3 > Vec3f;
+	typedef Vec< float, 4 > Vec4f;
+	typedef Vec< double, 2 > Vec2d;
+	typedef Vec< double, 3 > Vec3d;
+	typedef Vec< double, 4 > Vec4d;
+
+	namespace VecDetail
+	{
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Fill( Type value, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { ( ( void )I, value )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Add( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { ( vecA.c[I] + vecB.c[I] )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Subtract( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { ( vecA.c[I] - vecB.c[I] )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Multiply( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { ( vecA.c[I] * vecB.c[I] )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Scale( const Vec< Type, Size >& vec, Type scale, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { ( vec.c[I] * scale )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Negate( const Vec< Type, Size >& vec, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { ( -vec.c[I] )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Min( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { MIN( vecA.c[I], vecB.c[I] )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Max( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { MAX( vecA.c[I], vecB.c[I] )... } };
+		}
+
+		template< typename Type, int Size, int... I >
+		constexpr Vec< Type, Size > Lerp( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, Type lambda, IndexSequence< I... > )
+		{
+			return Vec< Type, Size >{ { ( vecA.c[I] + ( vecB.c[I] - vecA.c[I] ) * lambda )... } };
+		}
+
+		template< typename ToType, typename FromType, int Size, int... I >
+		constexpr Vec< ToType, Size > Cast( const Vec< FromType, Size >& vec, IndexSequence< I... > )
+		{
+			return Vec< ToType, Size >{ { ToType( vec.c[I] )... } };
+		}
+
+		template< typename Type, int Size >
+		constexpr Type Dot( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, int i )
+		{
+			return( i == Size ) ? Type(0) : ( vecA.c[i] * vecB.c[i] + Dot( vecA, vecB, i + 1 ) );
+		}
+
+		template< typename Type, int Size >
+		constexpr bool Equal( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, int i )
+		{
+			return( i == Size ) ? true : ( vecA.c[i] == vecB.c[i] && Equal( vecA, vecB, i + 1 ) );
+		}
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > VecFill( Type value )
+	{
+		return VecDetail::Fill< Type, Size >( value, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename ToType, typename FromType, int Size >
+	constexpr Vec< ToType, Size > VecCast( const Vec< FromType, Size >& vec )
+	{
+		return VecDetail::Cast< ToType >( vec, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > operator+( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return VecDetail::Add( vecA, vecB, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > operator-( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return VecDetail::Subtract( vecA, vecB, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > operator-( const Vec< Type, Size >& vec )
+	{
+		return VecDetail::Negate( vec, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	// As with Vector, this is the component-wise product.
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > operator*( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return VecDetail::Multiply( vecA, vecB, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > operator*( const Vec< Type, Size >& vec, Type scale )
+	{
+		return VecDetail::Scale( vec, scale, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > operator*( Type scale, const Vec< Type, Size >& vec )
+	{
+		return VecDetail::Scale( vec, scale, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr bool operator==( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return VecDetail::Equal( vecA, vecB, 0 );
+	}
+
+	template< typename Type, int Size >
+	constexpr bool operator!=( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return !VecDetail::Equal( vecA, vecB, 0 );
+	}
+
+	template< typename Type, int Size >
+	constexpr Type Dot( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return VecDetail::Dot( vecA, vecB, 0 );
+	}
+
+	template< typename Type >
+	constexpr Vec< Type, 3 > Cross( const Vec< Type, 3 >& vecA, const Vec< Type, 3 >& vecB )
+	{
+		return Vec< Type, 3 >{ {
+			vecA.c[1] * vecB.c[2] - vecA.c[2] * vecB.c[1],
+			vecA.c[2] * vecB.c[0] - vecA.c[0] * vecB.c[2],
+			vecA.c[0] * vecB.c[1] - vecA.c[1] * vecB.c[0] } };
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > Min( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return VecDetail::Min( vecA, vecB, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > Max( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return VecDetail::Max( vecA, vecB, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Vec< Type, Size > Lerp( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB, Type lambda )
+	{
+		return VecDetail::Lerp( vecA, vecB, lambda, typename MakeIndexSequence< Size >::Type() );
+	}
+
+	template< typename Type, int Size >
+	constexpr Type LengthSquared( const Vec< Type, Size >& vec )
+	{
+		return Dot( vec, vec );
+	}
+
+	// The square root keeps these from being constexpr.
+
+	template< typename Type, int Size >
+	inline Type Length( const Vec< Type, Size >& vec )
+	{
+		return sqrt( Dot( vec, vec ) );
+	}
+
+	template< typename Type, int Size >
+	inline Type Distance( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return Length( vecA - vecB );
+	}
+
+	// Like Vector::Normalize, this leaves the vector alone and returns false if it has zero length.
+	template< typename Type, int Size >
+	inline bool Normalize( Vec< Type, Size >& vec )
+	{
+		Type length = Length( vec );
+		if( length == Type(0) )
+			return false;
+
+		vec = vec * ( Type(1) / length );
+		return true;
+	}
+
+	template< typename Type, int Size >
+	inline Vec< Type, Size >& operator+=( Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		for( int i = 0; i < Size; i++ )
+			vecA.c[i] += vecB.c[i];
+		return vecA;
+	}
+
+	template< typename Type, int Size >
+	inline Vec< Type, Size >& operator-=( Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		for( int i = 0; i < Size; i++ )
+			vecA.c[i] -= vecB.c[i];
+		return vecA;
+	}
+
+	template< typename Type, int Size >
+	inline Vec< Type, Size >& operator*=( Vec< Type, Size >& vec, Type scale )
+	{
+		for( int i = 0; i < Size; i++ )
+			vec.c[i] *= scale;
+		return vec;
+	}
+
+	template< typename Type >
+	inline Vec< Type, 3 > ToVec( const Vector& vector )
+	{
+		return Vec< Type, 3 >{ { Type( vector.x ), Type( vector.y ), Type( vector.z ) } };
+	}
+
+	inline Vec3d ToVec3d( const Vector& vector )
+	{
+		return ToVec< double >( vector );
+	}
+
+	inline Vec3f ToVec3f( const Vector& vector )
+	{
+		return ToVec< float >( vector );
+	}
+
+	template< typename Type >
+	inline Vector ToVector( const Vec< Type, 3 >& vec )
+	{
+		return Vector( double( vec.c[0] ), double( vec.c[1] ), double( vec.c[2] ) );
+	}
+}
+
+// Vec.h
@@ -0,0 +1,332 @@
+// VecGeometry.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vec.h"
+#include "Mat.h"
+#include "Vertex.h"
+#include "AxisAlignedBox.h"
+#include "Triangle.h"
+#include "Plane.h"
+#include "AffineTransform.h"
+
+// These are precision-parameterized, plain-data counterparts to Vertex, AxisAlignedBox, Triangle,
+// Plane and AffineTransform.  The float flavors halve the memory of the double-based classes and
+// double the SIMD width, which is plenty for rendering, particles and broad-phase work.  Convert at
+// the edges with the To.../From... functions below and keep the double-based classes for anything
+// that needs the extra precision.
+//
+// Mixed precision is supported by letting the reductions that are prone to cancellation, like
+// plane distances and triangle normals, accumulate in a wider type than the one stored.  The
+// accumulation type is always given explicitly, e.g. PlaneDistance< double >( planef, pointf ).
+
+namespace _3DMath
+{
+	// EPSILON is too tight to be meaningful at single precision.
+	template< typename Type >
+	constexpr Type VecEpsilon( void );
+
+	template<>
+	constexpr float VecEpsilon< float >( void ) { return 1e-4f; }
+
+	template<>
+	constexpr double VecEpsilon< double >( void ) { return EPSILON; }
+
+	template< typename Type >
+	struct VecVertex
+	{
+		Vec< Type, 3 > position;
+		Vec< Type, 3 > normal;
+		Vec< Type, 3 > color;
+		Vec< Type, 3 > texCoords;
+		Type alpha;
+	};
+
+	template< typename Type >
+	struct VecBox
+	{
+		Vec< Type, 3 > negCorner;
+		Vec< Type, 3 > posCorner;
+	};
+
+	template< typename Type >
+	struct VecTriangle
+	{
+		Vec< Type, 3 > vertex[3];
+	};
+
+	template< typename Type >
+	struct VecPlane
+	{
+		Vec< Type, 3 > normal;
+		Type centerDotNormal;
+	};
+
+	template< typename Type >
+	struct VecAffine
+	{
+		Mat< Type, 3, 3 > linear;
+		Vec< Type, 3 > translation;
+	};
+
+	typedef VecVertex< float > VecVertexf;
+	typedef VecVertex< double > VecVertexd;
+	typedef VecBox< float > VecBoxf;
+	typedef VecBox< double > VecBoxd;
+	typedef VecTriangle< float > VecTrianglef;
+	typedef VecTriangle< double > VecTriangled;
+	typedef VecPlane< float > VecPlanef;
+	typedef VecPlane< double > VecPlaned;
+	typedef VecAffine< float > VecAffinef;
+	typedef VecAffine< double > VecAffined;
+
+	//----------------------------------------------------------------------------------
+	//                                      Mixed precision
+	//----------------------------------------------------------------------------------
+
+	template< typename AccumType, typename Type, int Size >
+	constexpr Vec< AccumType, Size > Widen( const Vec< Type, Size >& vec )
+	{
+		return VecCast< AccumType >( vec );
+	}
+
+	template< typename AccumType, typename Type, int Size >
+	constexpr AccumType DotAccumulate( const Vec< Type, Size >& vecA, const Vec< Type, Size >& vecB )
+	{
+		return Dot( Widen< AccumType >( vecA ), Widen< AccumType >( vecB ) );
+	}
+
+	//----------------------------------------------------------------------------------
+	//                                           Boxes
+	//----------------------------------------------------------------------------------
+
+	template< typename Type >
+	constexpr VecBox< Type > BoxAroundPoint( const Vec< Type, 3 >& point )
+	{
+		return VecBox< Type >{ point, point };
+	}
+
+	template< typename Type >
+	constexpr VecBox< Type > BoxCombine( const VecBox< Type >& boxA, const VecBox< Type >& boxB )
+	{
+		return VecBox< Type >{ Min( boxA.negCorner, boxB.negCorner ), Max( boxA.posCorner, boxB.posCorner ) };
+	}
+
+	template< typename Type >
+	constexpr Vec< Type, 3 > BoxCenter( const VecBox< Type >& box )
+	{
+		return Lerp( box.negCorner, box.posCorner, Type( 0.5 ) );
+	}
+
+	template< typename Type >
+	inline void BoxGrowToIncludePoint( VecBox< Type >& box, const Vec< Type, 3 >& point )
+	{
+		box.negCorner = Min( box.negCorner, point );
+		box.posCorner = Max( box.posCorner, point );
+	}
+
+	template< typename Type >
+	inline bool BoxContainsPoint( const VecBox< Type >& box, const Vec< Type, 3 >& point, Type eps = VecEpsilon< Type >() )
+	{
+		for( int i = 0; i < 3; i++ )
+			if( point.c[i] < box.negCorner.c[i] - eps || point.c[i] > box.posCorner.c[i] + eps )
+				return false;
+		return true;
+	}
+
+	template< typename Type >
+	inline bool BoxOverlapsBox( const VecBox< Type >& boxA, const VecBox< Type >& boxB )
+	{
+		for( int i = 0; i < 3; i++ )
+			if( boxA.posCorner.c[i] < boxB.negCorner.c[i] || boxB.posCorner.c[i] < boxA.negCorner.c[i] )
+				return false;
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------
+	//                                  Triangles and planes
+	//----------------------------------------------------------------------------------
+
+	// As with Triangle::GetNormal, this is not normalized; its length is twice the area.  The vertices
+	// are widened before the edges are taken, so that the subtraction doesn't cancel at storage precision.
+	template< typename AccumType, typename Type >
+	constexpr Vec< AccumType, 3 > TriangleNormal( const VecTriangle< Type >& triangle )
+	{
+		return Cross( Widen< AccumType >( triangle.vertex[1] ) - Widen< AccumType >( triangle.vertex[0] ), Widen< AccumType >( triangle.vertex[2] ) - Widen< AccumType >( triangle.vertex[0] ) );
+	}
+
+	template< typename AccumType, typename Type >
+	inline AccumType TriangleArea( const VecTriangle< Type >& triangle )
+	{
+		return Length( TriangleNormal< AccumType >( triangle ) ) / AccumType(2);
+	}
+
+	template< typename Type >
+	constexpr VecPlane< Type > PlaneFromCenterAndUnitNormal( const Vec< Type, 3 >& center, const Vec< Type, 3 >& unitNormal )
+	{
+		return VecPlane< Type >{ unitNormal, Dot( center, unitNormal ) };
+	}
+
+	// The normal is computed in the accumulation type and only then rounded to storage precision.
+	template< typename AccumType, typename Type >
+	inline bool PlaneFromTriangle( const VecTriangle< Type >& triangle, VecPlane< Type >& plane )
+	{
+		Vec< AccumType, 3 > normal = TriangleNormal< AccumType >( triangle );
+		if( !Normalize( normal ) )
+			return false;
+
+		plane.normal = VecCast< Type >( normal );
+		plane.centerDotNormal = Type( DotAccumulate< AccumType >( triangle.vertex[0], plane.normal ) );
+		return true;
+	}
+
+	template< typename AccumType, typename Type >
+	constexpr AccumType PlaneDistance( const VecPlane< Type >& plane, const Vec< Type, 3 >& point )
+	{
+		return DotAccumulate< AccumType >( point, plane.normal ) - AccumType( plane.centerDotNormal );
+	}
+
+	template< typename Type >
+	inline Plane::Side PlaneSide( const VecPlane< Type >& plane, const Vec< Type, 3 >& point, Type eps = VecEpsilon< Type >() )
+	{
+		Type distance = PlaneDistance< Type >( plane, point );
+		if( distance > eps )
+			return Plane::SIDE_FRONT;
+		else if( distance < -eps )
+			return Plane::SIDE_BACK;
+		return Plane::SIDE_NEITHER;
+	}
+
+	//----------------------------------------------------------------------------------
+	//                                        Transforms
+	//----------------------------------------------------------------------------------
+
+	template< typename Type >
+	constexpr Vec< Type, 3 > TransformPoint( const VecAffine< Type >& affine, const Vec< Type, 3 >& point )
+	{
+		return affine.linear * point + affine.translation;
+	}
+
+	template< typename Type >
+	constexpr Vec< Type, 3 > TransformVector( const VecAffine< Type >& affine, const Vec< Type, 3 >& vector )
+	{
+		return affine.linear * vector;
+	}
+
+	// The caller supplies the normal matrix, as with AffineTransform::Transform( Vertex&, ... ).
+	template< typename Type >
+	inline void TransformVertex( const VecAffine< Type >& affine, const Mat< Type, 3, 3 >& normalMatrix, VecVertex< Type >& vertex )
+	{
+		vertex.position = TransformPoint( affine, vertex.position );
+		vertex.normal = normalMatrix * vertex.normal;
+		Normalize( vertex.normal );
+	}
+
+	//----------------------------------------------------------------------------------
+	//                                        Conversions
+	//----------------------------------------------------------------------------------
+
+	template< typename Type >
+	inline VecVertex< Type > ToVecVertex( const Vertex& vertex )
+	{
+		return VecVertex< Type >{ ToVec< Type >( vertex.position ), ToVec< Type >( vertex.normal ), ToVec< Type >( vertex.color ), ToVec< Type >( vertex.texCoords ), Type( vertex.alpha ) };
+	}
+
+	template< typename Type >
+	inline Vertex ToVertex( const VecVertex< Type >& vecVertex )
+	{
+		Vertex vertex;
+		vertex.position = ToVector( vecVertex.position );
+		vertex.normal = ToVector( vecVertex.normal );
+		vertex.color = ToVector( vecVertex.color );
+		vertex.texCoords = ToVector( vecVertex.texCoords );
+		vertex.alpha = double( vecVertex.alpha );
+		return vertex;
+	}
+
+	template< typename Type >
+	inline void ToVecVertexArray( const VertexArray& vertexArray, std::vector< VecVertex< Type > >& vecVertexArray )
+	{
+		vecVertexArray.resize( vertexArray.size() );
+		for( int i = 0; i < ( signed )vertexArray.size(); i++ )
+			vecVertexArray[i] = ToVecVertex< Type >( vertexArray[i] );
+	}
+
+	template< typename Type >
+	inline void ToVertexArray( const std::vector< VecVertex< Type > >& vecVertexArray, VertexArray& vertexArray )
+	{
+		vertexArray.resize( vecVertexArray.size() );
+		for( int i = 0; i < ( signed )vecVertexArray.size(); i++ )
+			vertexArray[i] = ToVertex( vecVertexArray[i] );
+	}
+
+	template< typename Type >
+	inline VecBox< Type > ToVecBox( const AxisAlignedBox& box )
+	{
+		return VecBox< Type >{ ToVec< Type >( box.negCorner ), ToVec< Type >( box.posCorner ) };
+	}
+
+	// Rounding to float can pull the corners in, so widen the box by an ulp to keep it conservative.
+	template<>
+	inline VecBox< float > ToVecBox< float >( const AxisAlignedBox& box )
+	{
+		VecBox< float > vecBox = { ToVec3f( box.negCorner ), ToVec3f( box.posCorner ) };
+		for( int i = 0; i < 3; i++ )
+		{
+			vecBox.negCorner.c[i] = nextafterf( vecBox.negCorner.c[i], -HUGE_VALF );
+			vecBox.posCorner.c[i] = nextafterf( vecBox.posCorner.c[i], HUGE_VALF );
+		}
+		return vecBox;
+	}
+
+	template< typename Type >
+	inline AxisAlignedBox ToAxisAlignedBox( const VecBox< Type >& vecBox )
+	{
+		return AxisAlignedBox( ToVector( vecBox.negCorner ), ToVector( vecBox.posCorner ) );
+	}
+
+	template< typename Type >
+	inline VecTriangle< Type > ToVecTriangle( const Triangle& triangle )
+	{
+		return VecTriangle< Type >{ { ToVec< Type >( triangle.vertex[0] ), ToVec< Type >( triangle.vertex[1] ), ToVec< Type >( triangle.vertex[2] ) } };
+	}
+
+	template< typename Type >
+	inline Triangle ToTriangle( const VecTriangle< Type >& vecTriangle )
+	{
+		return Triangle( ToVector( vecTriangle.vertex[0] ), ToVector( vecTriangle.vertex[1] ), ToVector( vecTriangle.vertex[2] ) );
+	}
+
+	template< typename Type >
+	inline VecPlane< Type > ToVecPlane( const Plane& plane )
+	{
+		return VecPlane< Type >{ ToVec< Type >( plane.normal ), Type( plane.centerDotNormal ) };
+	}
+
+	template< typename Type >
+	inline Plane ToPlane( const VecPlane< Type >& vecPlane )
+	{
+		Plane plane;
+		plane.normal = ToVector( vecPlane.normal );
+		plane.centerDotNormal = double( vecPlane.centerDotNormal );
+		return plane;
+	}
+
+	template< typename Type >
+	inline VecAffine< Type > ToVecAffine( const AffineTransform& affineTransform )
+	{
+		return VecAffine< Type >{ ToMat< Type >( affineTransform.linearTransform ), ToVec< Type >( affineTransform.translation ) };
+	}
+
+	template< typename Type >
+	inline AffineTransform ToAffineTransform( const VecAffine< Type >& vecAffine )
+	{
+		AffineTransform affineTransform;
+		FromMat( vecAffine.linear, affineTransform.linearTransform );
+		affineTransform.translation = ToVector( vecAffine.translation );
+		return affineTransform;
+	}
+}
+
+// VecGeometry.h
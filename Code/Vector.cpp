@@ -1,6 +1,7 @@
 // Vector.cpp
 
 #include "Vector.h"
+#include "FastMath.h"
 
 using namespace _3DMath;
 
@@ -125,12 +126,12 @@ bool Vector::Normalize( void )
 
 bool Vector::GetNormalized( Vector& vector ) const
 {
-	double length = Length();
-	if( length == 0.0 )
+	double lengthSquared = Dot( *this );
+	if( lengthSquared == 0.0 )
 		return false;
 	
 	vector = *this;
-	vector.Scale( 1.0 / length );
+	vector.Scale( FastMath::InverseSqrt( lengthSquared ) );
 	return true;
 }
 
@@ -202,7 +203,7 @@ double Vector::AngleBetween( const Vector& vector ) const
 	Vector unitVectorA, unitVectorB;
 	GetNormalized( unitVectorA );
 	vector.GetNormalized( unitVectorB );
-	double angle = acos( unitVectorA.Dot( unitVectorB ) );
+	double angle = FastMath::ACos( unitVectorA.Dot( unitVectorB ) );
 	return angle;
 }
 
@@ -220,8 +221,8 @@ void Vector::Rotate( const Vector& unitAxis, double angle, Vector& vector ) cons
 		xAxis.SetScaled( rejVector, 1.0 / rejVectorLength );
 		yAxis.Cross( unitAxis, xAxis );
 
-		double cosAngle = cos( angle );
-		double sinAngle = sin( angle );
+		double cosAngle, sinAngle;
+		FastMath::SinCos( angle, sinAngle, cosAngle );
 
 		rejVector.AddScale( xAxis, cosAngle, yAxis, sinAngle );
 		rejVector.Scale( rejVectorLength );
@@ -307,13 +308,18 @@ void Vector::Lerp( const Vector& vectorA, const Vector& vectorB, double lambda )
 
 bool Vector::Slerp( const Vector& unitVectorA, const Vector& unitVectorB, double lambda )
 {
-	double angle = acos( unitVectorA.Dot( unitVectorB ) );
-	double sinAngle = sin( angle );
+	double angle = FastMath::ACos( unitVectorA.Dot( unitVectorB ) );
+	double sinAngle, cosAngle;
+	FastMath::SinCos( angle, sinAngle, cosAngle );
 	if( sinAngle == 0.0 )
 		return false;
 
-	double scaleA = sin( ( 1.0 - lambda ) * angle ) / sinAngle;
-	double scaleB = sin( lambda * angle ) / sinAngle;
+	double sinAngleA, sinAngleB;
+	FastMath::SinCos( ( 1.0 - lambda ) * angle, sinAngleA, cosAngle );
+	FastMath::SinCos( lambda * angle, sinAngleB, cosAngle );
+
+	double scaleA = sinAngleA / sinAngle;
+	double scaleB = sinAngleB / sinAngle;
 	AddScale( unitVectorA, scaleA, unitVectorB, scaleB );
 	return true;
 }
@@ -0,0 +1,536 @@
+// VectorKernels.cpp
+
+#include "VectorKernels.h"
+#include "BatchTransform.h"
+#include "Simd.h"
+#include <stddef.h>
+
+using namespace _3DMath;
+
+static_assert( sizeof( Vector ) == 3 * sizeof( double ), "Vector must be three packed doubles." );
+
+static inline bool UseAVX2( void )
+{
+	return BatchTransform::GetSupportedInstructions() == BatchTransform::INSTRUCTIONS_AVX2;
+}
+
+static inline Vector& At( Vector* vectorArray, int i, int stride )
+{
+	return *( Vector* )( ( char* )vectorArray + ( ptrdiff_t )i * stride );
+}
+
+static inline const Vector& At( const Vector* vectorArray, int i, int stride )
+{
+	return *( const Vector* )( ( const char* )vectorArray + ( ptrdiff_t )i * stride );
+}
+
+//---------------------------------------------------------------------
+//                                Scalar
+//---------------------------------------------------------------------
+
+static void DotScalar( const Vector* vectorArrayA, const Vector* vectorArrayB, double* dotArray, int begin, int end )
+{
+	for( int i = begin; i < end; i++ )
+		dotArray[i] = vectorArrayA[i].Dot( vectorArrayB[i] );
+}
+
+static void CrossScalar( const Vector* vectorArrayA, const Vector* vectorArrayB, Vector* crossArray, int begin, int end )
+{
+	for( int i = begin; i < end; i++ )
+	{
+		// The output may alias either input.
+		Vector cross;
+		cross.Cross( vectorArrayA[i], vectorArrayB[i] );
+		crossArray[i] = cross;
+	}
+}
+
+static void LengthScalar( const Vector* vectorArray, double* lengthArray, int begin, int end, int stride )
+{
+	for( int i = begin; i < end; i++ )
+		lengthArray[i] = At( vectorArray, i, stride ).Length();
+}
+
+static void NormalizeScalar( Vector* vectorArray, int begin, int end, int stride )
+{
+	for( int i = begin; i < end; i++ )
+		At( vectorArray, i, stride ).Normalize();
+}
+
+static void SumScalar( const Vector* vectorArray, int begin, int end, Vector& sum, int stride )
+{
+	for( int i = begin; i < end; i++ )
+		sum.Add( At( vectorArray, i, stride ) );
+}
+
+static void MinMaxScalar( const Vector* vectorArray, int begin, int end, Vector& min, Vector& max, int stride )
+{
+	for( int i = begin; i < end; i++ )
+	{
+		const Vector& vector = At( vectorArray, i, stride );
+		min.Min( min, vector );
+		max.Max( max, vector );
+	}
+}
+
+#if defined _3DMATH_X86
+
+//---------------------------------------------------------------------
+//                                 AVX2
+//---------------------------------------------------------------------
+
+// Packed arrays are transposed four Vectors at a time; the kernels return how many they handled
+// so that the caller can finish the remainder with the scalar loops.
+
+_3DMATH_TARGET_AVX2 static int DotAVX2( const Vector* vectorArrayA, const Vector* vectorArrayB, double* dotArray, int arraySize )
+{
+	const double* a = &vectorArrayA[0].x;
+	const double* b = &vectorArrayB[0].x;
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4, a += 12, b += 12 )
+	{
+		__m256d ax, ay, az, bx, by, bz;
+		LoadPackedVectors( a, ax, ay, az );
+		LoadPackedVectors( b, bx, by, bz );
+		_mm256_storeu_pd( dotArray + i, _mm256_fmadd_pd( ax, bx, _mm256_fmadd_pd( ay, by, _mm256_mul_pd( az, bz ) ) ) );
+	}
+
+	return i;
+}
+
+_3DMATH_TARGET_AVX2 static int CrossAVX2( const Vector* vectorArrayA, const Vector* vectorArrayB, Vector* crossArray, int arraySize )
+{
+	const double* a = &vectorArrayA[0].x;
+	const double* b = &vectorArrayB[0].x;
+	double* c = &crossArray[0].x;
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4, a += 12, b += 12, c += 12 )
+	{
+		__m256d ax, ay, az, bx, by, bz;
+		LoadPackedVectors( a, ax, ay, az );
+		LoadPackedVectors( b, bx, by, bz );
+
+		__m256d cx = _mm256_fmsub_pd( ay, bz, _mm256_mul_pd( az, by ) );
+		__m256d cy = _mm256_fmsub_pd( az, bx, _mm256_mul_pd( ax, bz ) );
+		__m256d cz = _mm256_fmsub_pd( ax, by, _mm256_mul_pd( ay, bx ) );
+		StorePackedVectors( c, cx, cy, cz );
+	}
+
+	return i;
+}
+
+// Lerp and AddScale are component-wise, so the arrays are simply treated as flat runs of doubles.
+_3DMATH_TARGET_AVX2 static int LerpAVX2( const Vector* vectorArrayA, const Vector* vectorArrayB, Vector* lerpArray, double lambda, int arraySize )
+{
+	const double* a = &vectorArrayA[0].x;
+	const double* b = &vectorArrayB[0].x;
+	double* c = &lerpArray[0].x;
+
+	__m256d scaleA = _mm256_set1_pd( 1.0 - lambda );
+	__m256d scaleB = _mm256_set1_pd( lambda );
+
+	int count = arraySize * 3;
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+		_mm256_storeu_pd( c + i, _mm256_fmadd_pd( _mm256_loadu_pd( a + i ), scaleA, _mm256_mul_pd( _mm256_loadu_pd( b + i ), scaleB ) ) );
+
+	for( ; i < count; i++ )
+		c[i] = a[i] * ( 1.0 - lambda ) + b[i] * lambda;
+
+	return arraySize;
+}
+
+_3DMATH_TARGET_AVX2 static int AddScaleAVX2( Vector* vectorArray, const Vector* addArray, double scale, int arraySize )
+{
+	double* a = &vectorArray[0].x;
+	const double* b = &addArray[0].x;
+
+	__m256d scaleB = _mm256_set1_pd( scale );
+
+	int count = arraySize * 3;
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+		_mm256_storeu_pd( a + i, _mm256_fmadd_pd( _mm256_loadu_pd( b + i ), scaleB, _mm256_loadu_pd( a + i ) ) );
+
+	for( ; i < count; i++ )
+		a[i] += b[i] * scale;
+
+	return arraySize;
+}
+
+// Strided arrays are read with gathers, which take their offsets in bytes here.
+_3DMATH_TARGET_AVX2 static inline void LoadVectors( const Vector* vectorArray, int i, int stride, __m256i offsets, __m256d& x, __m256d& y, __m256d& z )
+{
+	const double* base = &At( vectorArray, i, stride ).x;
+	if( stride == sizeof( Vector ) )
+		LoadPackedVectors( base, x, y, z );
+	else
+	{
+		x = _mm256_i64gather_pd( base, offsets, 1 );
+		y = _mm256_i64gather_pd( base + 1, offsets, 1 );
+		z = _mm256_i64gather_pd( base + 2, offsets, 1 );
+	}
+}
+
+_3DMATH_TARGET_AVX2 static inline __m256i StrideOffsets( int stride )
+{
+	return _mm256_set_epi64x( 3 * ( long long )stride, 2 * ( long long )stride, stride, 0 );
+}
+
+_3DMATH_TARGET_AVX2 static int LengthAVX2( const Vector* vectorArray, double* lengthArray, int arraySize, int stride )
+{
+	__m256i offsets = StrideOffsets( stride );
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4 )
+	{
+		__m256d x, y, z;
+		LoadVectors( vectorArray, i, stride, offsets, x, y, z );
+		_mm256_storeu_pd( lengthArray + i, _mm256_sqrt_pd( _mm256_fmadd_pd( x, x, _mm256_fmadd_pd( y, y, _mm256_mul_pd( z, z ) ) ) ) );
+	}
+
+	return i;
+}
+
+_3DMATH_TARGET_AVX2 static int NormalizeAVX2( Vector* vectorArray, int arraySize, int stride )
+{
+	__m256i offsets = StrideOffsets( stride );
+	__m256d zero = _mm256_setzero_pd();
+	__m256d one = _mm256_set1_pd( 1.0 );
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4 )
+	{
+		__m256d x, y, z;
+		LoadVectors( vectorArray, i, stride, offsets, x, y, z );
+
+		__m256d length = _mm256_sqrt_pd( _mm256_fmadd_pd( x, x, _mm256_fmadd_pd( y, y, _mm256_mul_pd( z, z ) ) ) );
+		__m256d scale = _mm256_div_pd( one, length );
+		scale = _mm256_blendv_pd( scale, one, _mm256_cmp_pd( length, zero, _CMP_EQ_OQ ) );
+
+		x = _mm256_mul_pd( x, scale );
+		y = _mm256_mul_pd( y, scale );
+		z = _mm256_mul_pd( z, scale );
+
+		if( stride == sizeof( Vector ) )
+			StorePackedVectors( &vectorArray[i].x, x, y, z );
+		else
+		{
+			// AVX2 has no scatter, so the lanes are written back one Vector at a time.
+			alignas( 32 ) double component[3][4];
+			_mm256_store_pd( component[0], x );
+			_mm256_store_pd( component[1], y );
+			_mm256_store_pd( component[2], z );
+
+			for( int j = 0; j < 4; j++ )
+				At( vectorArray, i + j, stride ).Set( component[0][j], component[1][j], component[2][j] );
+		}
+	}
+
+	return i;
+}
+
+// Three consecutive registers over a packed array hold x y z x | y z x y | z x y z, so summing
+// runs of twelve doubles needs no shuffling until the end.
+_3DMATH_TARGET_AVX2 static int SumAVX2( const Vector* vectorArray, int arraySize, Vector& sum, int stride )
+{
+	int i = 0;
+
+	if( stride == sizeof( Vector ) )
+	{
+		const double* data = &vectorArray[0].x;
+		__m256d a = _mm256_setzero_pd();
+		__m256d b = _mm256_setzero_pd();
+		__m256d c = _mm256_setzero_pd();
+
+		for( ; i + 4 <= arraySize; i += 4, data += 12 )
+		{
+			a = _mm256_add_pd( a, _mm256_loadu_pd( data ) );
+			b = _mm256_add_pd( b, _mm256_loadu_pd( data + 4 ) );
+			c = _mm256_add_pd( c, _mm256_loadu_pd( data + 8 ) );
+		}
+
+		alignas( 32 ) double lane[3][4];
+		_mm256_store_pd( lane[0], a );
+		_mm256_store_pd( lane[1], b );
+		_mm256_store_pd( lane[2], c );
+
+		sum.x += lane[0][0] + lane[0][3] + lane[1][2] + lane[2][1];
+		sum.y += lane[0][1] + lane[1][0] + lane[1][3] + lane[2][2];
+		sum.z += lane[0][2] + lane[1][1] + lane[2][0] + lane[2][3];
+	}
+	else
+	{
+		__m256d total = _mm256_setzero_pd();
+		for( ; i < arraySize; i++ )
+			total = _mm256_add_pd( total, LoadVector( &At( vectorArray, i, stride ).x ) );
+
+		alignas( 32 ) double lane[4];
+		_mm256_store_pd( lane, total );
+		sum.x += lane[0];
+		sum.y += lane[1];
+		sum.z += lane[2];
+	}
+
+	return i;
+}
+
+_3DMATH_TARGET_AVX2 static int WeightedSumAVX2( const Vector* vectorArray, const double* weightArray, int arraySize, Vector& sum )
+{
+	const double* data = &vectorArray[0].x;
+	__m256d sumX = _mm256_setzero_pd();
+	__m256d sumY = _mm256_setzero_pd();
+	__m256d sumZ = _mm256_setzero_pd();
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4, data += 12 )
+	{
+		__m256d x, y, z;
+		LoadPackedVectors( data, x, y, z );
+
+		__m256d weight = _mm256_loadu_pd( weightArray + i );
+		sumX = _mm256_fmadd_pd( x, weight, sumX );
+		sumY = _mm256_fmadd_pd( y, weight, sumY );
+		sumZ = _mm256_fmadd_pd( z, weight, sumZ );
+	}
+
+	sum.x += HorizontalSum( sumX );
+	sum.y += HorizontalSum( sumY );
+	sum.z += HorizontalSum( sumZ );
+	return i;
+}
+
+// Same layout trick as SumAVX2.  Masked loads leave the unused lane at zero, but it's never read.
+_3DMATH_TARGET_AVX2 static int MinMaxAVX2( const Vector* vectorArray, int arraySize, Vector& min, Vector& max, int stride )
+{
+	int i = 0;
+
+	if( stride == sizeof( Vector ) )
+	{
+		const double* data = &vectorArray[0].x;
+		__m256d minA = _mm256_set_pd( min.x, min.z, min.y, min.x ), maxA = _mm256_set_pd( max.x, max.z, max.y, max.x );
+		__m256d minB = _mm256_set_pd( min.y, min.x, min.z, min.y ), maxB = _mm256_set_pd( max.y, max.x, max.z, max.y );
+		__m256d minC = _mm256_set_pd( min.z, min.y, min.x, min.z ), maxC = _mm256_set_pd( max.z, max.y, max.x, max.z );
+
+		for( ; i + 4 <= arraySize; i += 4, data += 12 )
+		{
+			__m256d a = _mm256_loadu_pd( data );
+			__m256d b = _mm256_loadu_pd( data + 4 );
+			__m256d c = _mm256_loadu_pd( data + 8 );
+
+			minA = _mm256_min_pd( minA, a );
+			minB = _mm256_min_pd( minB, b );
+			minC = _mm256_min_pd( minC, c );
+			maxA = _mm256_max_pd( maxA, a );
+			maxB = _mm256_max_pd( maxB, b );
+			maxC = _mm256_max_pd( maxC, c );
+		}
+
+		alignas( 32 ) double lane[6][4];
+		_mm256_store_pd( lane[0], minA );
+		_mm256_store_pd( lane[1], minB );
+		_mm256_store_pd( lane[2], minC );
+		_mm256_store_pd( lane[3], maxA );
+		_mm256_store_pd( lane[4], maxB );
+		_mm256_store_pd( lane[5], maxC );
+
+		min.x = MIN( MIN( lane[0][0], lane[0][3] ), MIN( lane[1][2], lane[2][1] ) );
+		min.y = MIN( MIN( lane[0][1], lane[1][0] ), MIN( lane[1][3], lane[2][2] ) );
+		min.z = MIN( MIN( lane[0][2], lane[1][1] ), MIN( lane[2][0], lane[2][3] ) );
+		max.x = MAX( MAX( lane[3][0], lane[3][3] ), MAX( lane[4][2], lane[5][1] ) );
+		max.y = MAX( MAX( lane[3][1], lane[4][0] ), MAX( lane[4][3], lane[5][2] ) );
+		max.z = MAX( MAX( lane[3][2], lane[4][1] ), MAX( lane[5][0], lane[5][3] ) );
+	}
+	else
+	{
+		__m256d minimum = LoadVector( &min.x );
+		__m256d maximum = LoadVector( &max.x );
+
+		for( ; i < arraySize; i++ )
+		{
+			__m256d vector = LoadVector( &At( vectorArray, i, stride ).x );
+			minimum = _mm256_min_pd( minimum, vector );
+			maximum = _mm256_max_pd( maximum, vector );
+		}
+
+		StoreVector( &min.x, minimum );
+		StoreVector( &max.x, maximum );
+	}
+
+	return i;
+}
+
+_3DMATH_TARGET_AVX2 static int PrefixSumAVX2( Vector* vectorArray, int arraySize )
+{
+	__m256d total = _mm256_setzero_pd();
+	for( int i = 0; i < arraySize; i++ )
+	{
+		total = _mm256_add_pd( total, LoadVector( &vectorArray[i].x ) );
+		StoreVector( &vectorArray[i].x, total );
+	}
+
+	return arraySize;
+}
+
+// Each block of four is scanned in-register by two shift-and-add steps, then offset by the running total.
+_3DMATH_TARGET_AVX2 static int PrefixSumAVX2( double* valueArray, int arraySize )
+{
+	__m256d zero = _mm256_setzero_pd();
+	__m256d total = zero;
+
+	int i = 0;
+	for( ; i + 4 <= arraySize; i += 4 )
+	{
+		__m256d value = _mm256_loadu_pd( valueArray + i );
+		value = _mm256_add_pd( value, _mm256_blend_pd( _mm256_permute4x64_pd( value, 0x90 ), zero, 0x1 ) );
+		value = _mm256_add_pd( value, _mm256_blend_pd( _mm256_permute4x64_pd( value, 0x40 ), zero, 0x3 ) );
+		value = _mm256_add_pd( value, total );
+		_mm256_storeu_pd( valueArray + i, value );
+		total = _mm256_permute4x64_pd( value, 0xFF );
+	}
+
+	return i;
+}
+
+#endif //_3DMATH_X86
+
+//---------------------------------------------------------------------
+//                               Dispatch
+//---------------------------------------------------------------------
+
+/*static*/ void VectorKernels::Dot( const Vector* vectorArrayA, const Vector* vectorArrayB, double* dotArray, int arraySize )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = DotAVX2( vectorArrayA, vectorArrayB, dotArray, arraySize );
+#endif
+	DotScalar( vectorArrayA, vectorArrayB, dotArray, i, arraySize );
+}
+
+/*static*/ void VectorKernels::Cross( const Vector* vectorArrayA, const Vector* vectorArrayB, Vector* crossArray, int arraySize )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = CrossAVX2( vectorArrayA, vectorArrayB, crossArray, arraySize );
+#endif
+	CrossScalar( vectorArrayA, vectorArrayB, crossArray, i, arraySize );
+}
+
+/*static*/ void VectorKernels::Lerp( const Vector* vectorArrayA, const Vector* vectorArrayB, Vector* lerpArray, double lambda, int arraySize )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = LerpAVX2( vectorArrayA, vectorArrayB, lerpArray, lambda, arraySize );
+#endif
+	for( ; i < arraySize; i++ )
+		lerpArray[i].Lerp( vectorArrayA[i], vectorArrayB[i], lambda );
+}
+
+/*static*/ void VectorKernels::AddScale( Vector* vectorArray, const Vector* addArray, double scale, int arraySize )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = AddScaleAVX2( vectorArray, addArray, scale, arraySize );
+#endif
+	for( ; i < arraySize; i++ )
+		vectorArray[i].AddScale( addArray[i], scale );
+}
+
+/*static*/ void VectorKernels::Length( const Vector* vectorArray, double* lengthArray, int arraySize, int stride /*= sizeof( Vector )*/ )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = LengthAVX2( vectorArray, lengthArray, arraySize, stride );
+#endif
+	LengthScalar( vectorArray, lengthArray, i, arraySize, stride );
+}
+
+/*static*/ void VectorKernels::Normalize( Vector* vectorArray, int arraySize, int stride /*= sizeof( Vector )*/ )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = NormalizeAVX2( vectorArray, arraySize, stride );
+#endif
+	NormalizeScalar( vectorArray, i, arraySize, stride );
+}
+
+/*static*/ void VectorKernels::Fill( Vector* vectorArray, const Vector& vector, int arraySize, int stride /*= sizeof( Vector )*/ )
+{
+	// This is bound by memory, not arithmetic, so the plain loop is as fast as anything.
+	for( int i = 0; i < arraySize; i++ )
+		At( vectorArray, i, stride ) = vector;
+}
+
+/*static*/ void VectorKernels::Sum( const Vector* vectorArray, int arraySize, Vector& sum, int stride /*= sizeof( Vector )*/ )
+{
+	sum.Set( 0.0, 0.0, 0.0 );
+
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = SumAVX2( vectorArray, arraySize, sum, stride );
+#endif
+	SumScalar( vectorArray, i, arraySize, sum, stride );
+}
+
+/*static*/ void VectorKernels::WeightedSum( const Vector* vectorArray, const double* weightArray, int arraySize, Vector& sum )
+{
+	sum.Set( 0.0, 0.0, 0.0 );
+
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = WeightedSumAVX2( vectorArray, weightArray, arraySize, sum );
+#endif
+	for( ; i < arraySize; i++ )
+		sum.AddScale( vectorArray[i], weightArray[i] );
+}
+
+/*static*/ bool VectorKernels::MinMax( const Vector* vectorArray, int arraySize, Vector& min, Vector& max, int stride /*= sizeof( Vector )*/ )
+{
+	if( arraySize <= 0 )
+		return false;
+
+	min = vectorArray[0];
+	max = vectorArray[0];
+
+	int i = 1;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i += MinMaxAVX2( &At( vectorArray, 1, stride ), arraySize - 1, min, max, stride );
+#endif
+	MinMaxScalar( vectorArray, i, arraySize, min, max, stride );
+	return true;
+}
+
+/*static*/ void VectorKernels::PrefixSum( Vector* vectorArray, int arraySize )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = PrefixSumAVX2( vectorArray, arraySize );
+#endif
+	for( i = MAX( i, 1 ); i < arraySize; i++ )
+		vectorArray[i].Add( vectorArray[ i - 1 ] );
+}
+
+/*static*/ void VectorKernels::PrefixSum( double* valueArray, int arraySize )
+{
+	int i = 0;
+#if defined _3DMATH_X86
+	if( UseAVX2() )
+		i = PrefixSumAVX2( valueArray, arraySize );
+#endif
+	for( i = MAX( i, 1 ); i < arraySize; i++ )
+		valueArray[i] += valueArray[ i - 1 ];
+}
+
+// VectorKernels.cpp
@@ -0,0 +1,47 @@
+// VectorKernels.h
+
+#pragma once
+
+#include "Defines.h"
+#include "Vector.h"
+
+namespace _3DMath
+{
+	class VectorKernels;
+}
+
+// These apply the common Vector operations across whole arrays, using AVX2 when the processor
+// supports it (see BatchTransform::GetSupportedInstructions) and plain loops otherwise.  Where a
+// stride is taken, it is in bytes, so that a field of a larger structure, such as the positions
+// of a Vertex array, can be processed in place.  Sums may differ from a sequential loop in the
+// last few bits, since the wide kernels accumulate in a different order.
+class _3DMATH_API _3DMath::VectorKernels
+{
+public:
+
+	static void Dot( const Vector* vectorArrayA, const Vector* vectorArrayB, double* dotArray, int arraySize );
+	static void Cross( const Vector* vectorArrayA, const Vector* vectorArrayB, Vector* crossArray, int arraySize );
+	static void Lerp( const Vector* vectorArrayA, const Vector* vectorArrayB, Vector* lerpArray, double lambda, int arraySize );
+
+	// This adds the scaled second array into the first.
+	static void AddScale( Vector* vectorArray, const Vector* addArray, double scale, int arraySize );
+
+	static void Length( const Vector* vectorArray, double* lengthArray, int arraySize, int stride = sizeof( Vector ) );
+
+	// Zero vectors are left alone.
+	static void Normalize( Vector* vectorArray, int arraySize, int stride = sizeof( Vector ) );
+
+	static void Fill( Vector* vectorArray, const Vector& vector, int arraySize, int stride = sizeof( Vector ) );
+
+	static void Sum( const Vector* vectorArray, int arraySize, Vector& sum, int stride = sizeof( Vector ) );
+	static void WeightedSum( const Vector* vectorArray, const double* weightArray, int arraySize, Vector& sum );
+
+	// Component-wise extremes; false is returned for an empty array.
+	static bool MinMax( const Vector* vectorArray, int arraySize, Vector& min, Vector& max, int stride = sizeof( Vector ) );
+
+	// These are inclusive scans, done in place.
+	static void PrefixSum( Vector* vectorArray, int arraySize );
+	static void PrefixSum( double* valueArray, int arraySize );
+};
+
+// VectorKernels.h